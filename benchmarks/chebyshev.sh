@@ -0,0 +1,28 @@
+# Compare the sweeps and time to convergence of Jacobi, Chebyshev accelerated Jacobi and red-black SOR.
+# Run from the directory containing the poisson executable, optionally passing the precision and thread count:
+#   ./benchmarks/chebyshev.sh 1e-6 16
+precision=${1:-1e-6}
+threads=${2:-$(nproc)}
+
+rm -f chebyshev.dat
+touch chebyshev.dat
+
+for size in 32 64 96
+do
+    for method in Jacobi Chebyshev Red-Black-SOR
+    do
+        output=chebyshev_${size}_${method}
+
+        # Small output through a single plane so the execution time is almost all solving.
+        ./poisson --$method -w 1.9 -d $precision -r $size -c $size -t $size -j $threads --select plane=z:$((size/2)) -o $output > /dev/null
+
+        # Append the size, method, number of sweeps and execution time to the collated data file.
+        printf "%s %s " $size $method >> chebyshev.dat
+        awk '/^(Number-of-iterations-until-convergence:|Time-take-to-execute\(s\):) /{printf "%s ", $(NF)}' $output/results.txt >> chebyshev.dat
+        printf "\n" >> chebyshev.dat
+
+        rm -rf $output
+    done
+done
+
+cat chebyshev.dat
@@ -0,0 +1,35 @@
+# Compare the kernels specialised for fixed lattice sizes with the generic kernels.
+# Run from the directory containing the poisson executable, optionally passing the sweeps and thread count:
+#   ./benchmarks/fixedSizeKernels.sh 200 16
+sweeps=${1:-200}
+threads=${2:-$(nproc)}
+
+rm -f fixedSizeKernels.dat
+touch fixedSizeKernels.dat
+
+for size in 64 128 256
+do
+    for method in Jacobi Red-Black-SOR
+    do
+        for kernels in fixed generic
+        do
+            output=fixedSizeKernels_${size}_${method}_${kernels}
+            flag=""
+            if [ "$kernels" = "generic" ]
+            then
+                flag="--no-fixed-size-kernels"
+            fi
+
+            # A tiny precision and a fixed number of sweeps so every run does the same amount of work.
+            ./poisson --$method -w 1.9 -d 1e-300 -m $sweeps -r $size -c $size -t $size -j $threads $flag -o $output > /dev/null
+
+            # Append the size, method, kernels and execution time to the collated data file.
+            printf "%s %s %s " $size $method $kernels >> fixedSizeKernels.dat
+            awk '/^(Time-take-to-execute\(s\):) /{print $(NF)}' $output/results.txt >> fixedSizeKernels.dat
+
+            rm -rf $output
+        done
+    done
+done
+
+cat fixedSizeKernels.dat
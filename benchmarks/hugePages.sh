@@ -0,0 +1,42 @@
+# Compare lattice memory backed by normal pages, transparent huge pages and explicit (hugetlbfs) huge pages.
+# Run from the directory containing the poisson executable, optionally passing the lattice size and thread count:
+#   ./benchmarks/hugePages.sh 300 16
+# Explicit huge pages need a reserved pool, e.g. echo 2048 > /proc/sys/vm/nr_hugepages, or they fall back to
+# transparent huge pages. dTLB misses are counted with perf when it is installed.
+size=${1:-300}
+threads=${2:-$(nproc)}
+
+rm -f hugePages.dat
+touch hugePages.dat
+
+for method in Jacobi Red-Black-SOR
+do
+    for pages in none transparent explicit
+    do
+        output=hugePages_${method}_${pages}
+        command="./poisson --$method -w 1.9 -r $size -c $size -t $size -j $threads --huge-pages $pages -o $output"
+
+        if command -v perf > /dev/null
+        then
+            perf stat -x ' ' -e dTLB-load-misses,dTLB-store-misses -o $output.perf $command > /dev/null
+        else
+            $command > /dev/null
+        fi
+
+        # Append the method, huge page mode and execution time to the collated data file.
+        printf "%s %s " $method $pages >> hugePages.dat
+        awk '/^(Time-take-to-execute\(s\):) /{printf "%s", $(NF)}' $output/results.txt >> hugePages.dat
+
+        # Followed by the dTLB load and store misses if they were counted.
+        if [ -f $output.perf ]
+        then
+            awk '/dTLB/{printf " %s", $1}' $output.perf >> hugePages.dat
+            rm -f $output.perf
+        fi
+        printf "\n" >> hugePages.dat
+
+        rm -rf $output
+    done
+done
+
+cat hugePages.dat
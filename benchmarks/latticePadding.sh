@@ -0,0 +1,31 @@
+# Compare the contiguous lattice layout with aligned rows and with padded rows and planes, at power of two sizes
+# where the neighbours of a site a row or a plane away map to the same cache sets, and at a size in between.
+# Run from the directory containing the poisson executable, optionally passing the sweeps and thread count:
+#   ./benchmarks/latticePadding.sh 200 16
+sweeps=${1:-200}
+threads=${2:-$(nproc)}
+
+rm -f latticePadding.dat
+touch latticePadding.dat
+
+for size in 64 128 200 256
+do
+    for method in Jacobi Red-Black-SOR
+    do
+        for padding in none 0,0 8,1
+        do
+            output=latticePadding_${size}_${method}_${padding}
+
+            # A tiny precision and a fixed number of sweeps so every run does the same amount of work.
+            ./poisson --$method -w 1.9 -d 1e-300 -m $sweeps -r $size -c $size -t $size -j $threads --lattice-padding $padding -o $output > /dev/null
+
+            # Append the size, method, padding and execution time to the collated data file.
+            printf "%s %s %s " $size $method $padding >> latticePadding.dat
+            awk '/^(Time-take-to-execute\(s\):) /{print $(NF)}' $output/results.txt >> latticePadding.dat
+
+            rm -rf $output
+        done
+    done
+done
+
+cat latticePadding.dat
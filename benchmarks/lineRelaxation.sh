@@ -0,0 +1,42 @@
+# Compare the sweeps and time to convergence of SOR, symmetric SOR, red-black SOR and zebra line SOR, on a
+# uniform grid and on one whose spacing along x is a tenth of the spacing along y and z.
+# Run from the directory containing the poisson executable, optionally passing the precision and thread count:
+#   ./benchmarks/lineRelaxation.sh 1e-6 16
+precision=${1:-1e-6}
+threads=${2:-$(nproc)}
+
+rm -f lineRelaxation.dat
+touch lineRelaxation.dat
+
+for size in 32 64
+do
+    # range-1 spacings along x for the anisotropic grid.
+    awk -v n=$((size-1)) 'BEGIN{for(i = 0; i < n; ++i) print 0.1}' > lineRelaxation_spacing.txt
+
+    for grid in uniform anisotropic
+    do
+        spacing=""
+        if [ "$grid" = "anisotropic" ]
+        then
+            spacing="--spacing x=file:lineRelaxation_spacing.txt"
+        fi
+
+        for method in SOR SSOR Red-Black-SOR Line-SOR
+        do
+            output=lineRelaxation_${size}_${grid}_${method}
+
+            # Small output through a single plane so the execution time is almost all solving.
+            ./poisson --$method -w 1.8 -d $precision -r $size -c $size -t $size -j $threads $spacing --select plane=z:$((size/2)) -o $output > /dev/null
+
+            # Append the size, grid, method, number of sweeps and execution time to the collated data file.
+            printf "%s %s %s " $size $grid $method >> lineRelaxation.dat
+            awk '/^(Number-of-iterations-until-convergence:|Time-take-to-execute\(s\):) /{printf "%s ", $(NF)}' $output/results.txt >> lineRelaxation.dat
+            printf "\n" >> lineRelaxation.dat
+
+            rm -rf $output
+        done
+    done
+done
+
+rm -f lineRelaxation_spacing.txt
+cat lineRelaxation.dat
@@ -0,0 +1,26 @@
+# Compare the NUMA placements of the lattice memory with the parallel solvers.
+# Run from the directory containing the poisson executable, optionally passing the lattice size and thread count:
+#   ./benchmarks/numaPlacement.sh 200 16
+size=${1:-200}
+threads=${2:-$(nproc)}
+
+rm -f numaPlacement.dat
+touch numaPlacement.dat
+
+for method in Jacobi Red-Black-SOR
+do
+    for placement in first-touch interleaved single-node
+    do
+        output=numaPlacement_${method}_${placement}
+
+        ./poisson --$method -w 1.9 -r $size -c $size -t $size -j $threads --affinity scatter --memory-placement $placement -o $output > /dev/null
+
+        # Append the method, placement and execution time to the collated data file.
+        printf "%s %s " $method $placement >> numaPlacement.dat
+        awk '/^(Time-take-to-execute\(s\):) /{print $(NF)}' $output/results.txt >> numaPlacement.dat
+
+        rm -rf $output
+    done
+done
+
+cat numaPlacement.dat
@@ -0,0 +1,45 @@
+# Compare the iostream writer of poissonOutput.dat with the fast text formatting, on one thread and on all of them.
+# Run from the directory containing the poisson executable, optionally passing the thread count:
+#   ./benchmarks/textOutput.sh 16
+threads=${1:-$(nproc)}
+
+rm -f textOutput.dat
+touch textOutput.dat
+
+for size in 64 128 200
+do
+    for writer in stream fast-serial fast-parallel
+    do
+        output=textOutput_${size}_${writer}
+        flag=""
+        writerThreads=$threads
+        if [ "$writer" = "stream" ]
+        then
+            flag="--stream-output"
+        elif [ "$writer" = "fast-serial" ]
+        then
+            writerThreads=1
+        fi
+
+        # A single sweep so the execution time is almost all output.
+        OMP_NUM_THREADS=$writerThreads ./poisson --Jacobi -d 1e-300 -m 1 -r $size -c $size -t $size -j $threads $flag -o $output > /dev/null
+
+        # Append the size, writer and execution time to the collated data file.
+        printf "%s %s " $size $writer >> textOutput.dat
+        awk '/^(Time-take-to-execute\(s\):) /{print $(NF)}' $output/results.txt >> textOutput.dat
+
+        # Every writer has to produce the same file.
+        if [ "$writer" = "stream" ]
+        then
+            mv $output/poissonOutput.dat textOutput_reference.dat
+        elif ! cmp -s $output/poissonOutput.dat textOutput_reference.dat
+        then
+            echo "$writer output differs from the iostream writer for size $size"
+        fi
+
+        rm -rf $output
+    done
+    rm -f textOutput_reference.dat
+done
+
+cat textOutput.dat
@@ -0,0 +1,141 @@
+"""Python bindings for the Poisson solver library through its C interface.
+
+Build the shared library with `make lib` and either run from the directory holding libpoisson.so or set
+POISSON_LIBRARY to its path. The potential and charge density are NumPy views straight onto the lattice
+memory, so nothing is copied in either direction. Running this file solves a 128^3 point charge problem
+and checks the field in memory as a smoke test.
+
+solve_on_server sends a job to a solver started with `poisson --serve path` instead, which needs no library.
+"""
+import ctypes
+import os
+import socket
+
+import numpy as np
+
+_library = ctypes.CDLL(os.environ.get("POISSON_LIBRARY", os.path.join(os.getcwd(), "libpoisson.so")))
+
+_library.poisson_lattice_create.restype = ctypes.c_void_p
+_library.poisson_lattice_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_double]
+_library.poisson_lattice_destroy.restype = None
+_library.poisson_lattice_destroy.argtypes = [ctypes.c_void_p]
+_library.poisson_lattice_set_point_charge.restype = None
+_library.poisson_lattice_set_point_charge.argtypes = [ctypes.c_void_p]
+for _function in (_library.poisson_lattice_potential, _library.poisson_lattice_charge_density):
+    _function.restype = ctypes.POINTER(ctypes.c_double)
+    _function.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int64), ctypes.POINTER(ctypes.c_int64)]
+_library.poisson_solve.restype = ctypes.c_int
+_library.poisson_solve.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_double, ctypes.c_double, ctypes.c_int,
+                                   ctypes.c_int, ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_double)]
+_library.poisson_last_error.restype = ctypes.c_char_p
+_library.poisson_last_error.argtypes = []
+
+JACOBI, GAUSS_SEIDEL, SOR, RED_BLACK_SOR, CHEBYSHEV_JACOBI, SSOR, LINE_SOR = range(7)
+
+
+class Lattice:
+    """Lattice holding the potential and charge density, indexed as [i, j, k] including the zero boundary."""
+
+    def __init__(self, x_range, y_range, z_range, permittivity=1.0, dx=1.0):
+        self._handle = _library.poisson_lattice_create(x_range, y_range, z_range, permittivity, dx)
+        if not self._handle:
+            # A lattice of the wrong shape is refused before anything is allocated.
+            error = _library.poisson_last_error().decode()
+            raise ValueError(error) if error.startswith("Lattice needs") else MemoryError(error)
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            _library.poisson_lattice_destroy(self._handle)
+            self._handle = None
+
+    def _view(self, accessor):
+        shape = (ctypes.c_int64 * 3)()
+        strides = (ctypes.c_int64 * 3)()
+        pointer = accessor(self._handle, shape, strides)
+        # A padded lattice stores more values than it has sites, so the flat array spans every plane.
+        size = strides[2] // ctypes.sizeof(ctypes.c_double) * shape[2]
+        flat = np.ctypeslib.as_array(pointer, shape=(size,))
+        view = np.lib.stride_tricks.as_strided(flat, shape=tuple(shape), strides=tuple(strides))
+        # Keep the lattice alive for as long as the view is.
+        return _LatticeView(view, self)
+
+    @property
+    def potential(self):
+        """Writable view of the potential, valid while the lattice is alive."""
+        return self._view(_library.poisson_lattice_potential)
+
+    @property
+    def charge_density(self):
+        """Writable view of the charge density, valid while the lattice is alive."""
+        return self._view(_library.poisson_lattice_charge_density)
+
+    def set_point_charge(self):
+        _library.poisson_lattice_set_point_charge(self._handle)
+
+    def solve(self, method=RED_BLACK_SOR, sor_parameter=1.9, precision=1e-3, threads=os.cpu_count(), max_iterations=0):
+        """Solves in place, returning the number of sweeps and the final convergence measure."""
+        iterations = ctypes.c_int()
+        convergence = ctypes.c_double()
+        status = _library.poisson_solve(self._handle, method, sor_parameter, precision, threads, max_iterations,
+                                        ctypes.byref(iterations), ctypes.byref(convergence))
+        if status < 0:
+            raise RuntimeError(_library.poisson_last_error().decode())
+        return iterations.value, convergence.value
+
+
+def solve_on_server(socket_path, size, **settings):
+    """Solves a job on a `poisson --serve` server, returning the potential indexed as [i, j, k], the number of
+    sweeps and the final convergence measure. settings are the request settings of SolverServer.hpp with
+    underscores for dashes, and lists for the repeatable ones, e.g. charge=["16,16,16,1", "40,16,16,-1"]."""
+    words = ["size=%d,%d,%d" % tuple(size)]
+    for key, value in settings.items():
+        for item in value if isinstance(value, (list, tuple)) else [value]:
+            words.append("%s=%s" % (key.replace("_", "-"), item))
+
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as connection:
+        connection.connect(socket_path)
+        connection.sendall((" ".join(words) + "\n").encode())
+        stream = connection.makefile("rb")
+        answer = stream.readline().decode().split()
+        if not answer or answer[0] != "ok":
+            raise RuntimeError(" ".join(answer[1:]))
+        fields = dict(word.split("=", 1) for word in answer[1:])
+        payload = stream.read(int(fields["bytes"]))
+
+    # The potential comes back in memory order, x fastest.
+    potential = np.frombuffer(payload, dtype=np.float64).reshape(size[::-1]).transpose() if payload else None
+    return potential, int(fields["iterations"]), float(fields["convergence"])
+
+
+class _LatticeView(np.ndarray):
+    """ndarray onto lattice memory that holds a reference to the lattice it views."""
+
+    def __new__(cls, array, lattice):
+        view = array.view(cls)
+        view._lattice = lattice
+        return view
+
+    def __array_finalize__(self, obj):
+        self._lattice = getattr(obj, "_lattice", None)
+
+
+if __name__ == "__main__":
+    size = 128
+    lattice = Lattice(size, size, size)
+    lattice.set_point_charge()
+
+    iterations, convergence = lattice.solve(precision=1e-2)
+    potential = lattice.potential
+
+    centre = size // 2
+    assert potential.shape == (size, size, size)
+    assert np.all(potential[0, :, :] == 0) and np.all(potential[:, :, -1] == 0)
+    assert potential[centre, centre, centre] == potential.max() > 0
+    assert abs(potential[centre + 1, centre, centre] - potential[centre - 1, centre, centre]) < 1e-3
+
+    # Writes through the view go straight into the lattice.
+    lattice.charge_density[centre, centre, centre] = 2.0
+    assert lattice.charge_density[centre, centre, centre] == 2.0
+
+    print("Solved %d^3 in %d sweeps (convergence %g), centre potential %g" %
+          (size, iterations, convergence, potential[centre, centre, centre]))
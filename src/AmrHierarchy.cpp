@@ -0,0 +1,517 @@
+#include "AmrHierarchy.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include "BoundaryConditions.hpp"
+#include "ElectricField.hpp"
+
+namespace
+{
+	/**
+	 *\brief interpolates values of a parent lattice multilinearly onto a site of a patch.
+	 *
+	 * Site f of the patch lies at parent coordinate origin + f/2 along each axis, so it is either on a parent
+	 * site or halfway between two.
+	 *
+	 *\param parent lattice the values belong to.
+	 *\param values potential or charge density of the parent.
+	 *\param origin parent site that site (0,0,0) of the patch lies on.
+	 *\param site coordinates of the site in the patch.
+	 *\return interpolated value.
+	 */
+	double interpolate(const PoissonLattice &parent, const double *values, const std::array<int,3> &origin,
+					   const std::array<int,3> &site)
+	{
+		const int strides[3] = {1, parent.xPitch(), parent.planeSize()};
+
+		int base = 0;
+		int odd[3];
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			int half = 2*origin[axis] + site[axis];
+			base += (half/2) * strides[axis];
+			odd[axis] = half & 1;
+		}
+
+		// Average the corners of the parent cell along the axes the site is halfway along.
+		double sum = 0;
+		int corners = 0;
+		for(int corner = 0; corner < 8; ++corner)
+		{
+			int index = base;
+			bool valid = true;
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				if(corner & (1 << axis))
+				{
+					valid = valid && odd[axis];
+					index += strides[axis];
+				}
+			}
+
+			if(valid)
+			{
+				sum += values[index];
+				++corners;
+			}
+		}
+
+		return sum/corners;
+	}
+
+	/**
+	 *\struct Box
+	 *\brief Inclusive range of interior parent sites refined by a patch.
+	 */
+	struct Box
+	{
+		std::array<int,3> lo;
+		std::array<int,3> hi;
+	};
+
+	/**
+	 *\brief checks whether two boxes share a site.
+	 */
+	bool overlap(const Box &a, const Box &b)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			if(a.hi[axis] < b.lo[axis] || b.hi[axis] < a.lo[axis])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+AmrHierarchy::AmrHierarchy(PoissonLattice &base, const Config &config): m_config(config),
+																		m_base(base)
+{
+
+}
+
+PoissonLattice& AmrHierarchy::parentOf(const Patch &patch)
+{
+	return patch.parent < 0 ? m_base : *m_patches[patch.parent].lattice;
+}
+
+void AmrHierarchy::refine(const PoissonLattice &lattice, int parent, int level)
+{
+	const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
+	const int dimension = lattice.dimension();
+	const int blockSize = std::max(1, m_config.blockSize);
+
+	// Largest charge density and potential difference between neighbouring sites over the interior.
+	double maxCharge = 0;
+	double maxJump = 0;
+	const ElectricField field(lattice);
+	const double *fieldStrength = field.magnitude();
+
+	for(int k = dimension > 2; k < ranges[2] - (dimension > 2); ++k)
+	{
+		for(int j = dimension > 1; j < ranges[1] - (dimension > 1); ++j)
+		{
+			for(int i = 1; i < ranges[0]-1; ++i)
+			{
+				maxJump = std::max(maxJump, lattice.dx() * fieldStrength[lattice.index(i, j, k)]);
+				maxCharge = std::max(maxCharge, std::abs(lattice.getChargeDensity(i, j, k)));
+			}
+		}
+	}
+
+	// Blocks tile the interior along the active axes, the inactive axes are a single block.
+	int blocks[3];
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		blocks[axis] = axis < dimension ? (ranges[axis] - 2 + blockSize - 1)/blockSize : 1;
+	}
+	std::vector<unsigned char> flagged(blocks[0]*blocks[1]*blocks[2], 0);
+
+	// Flag every block within the buffer of a tagged site.
+	for(int k = dimension > 2; k < ranges[2] - (dimension > 2); ++k)
+	{
+		for(int j = dimension > 1; j < ranges[1] - (dimension > 1); ++j)
+		{
+			for(int i = 1; i < ranges[0]-1; ++i)
+			{
+				bool tagged = (maxCharge > 0 && std::abs(lattice.getChargeDensity(i, j, k)) >= m_config.threshold*maxCharge)
+					|| (maxJump > 0 && lattice.dx()*fieldStrength[lattice.index(i, j, k)] >= m_config.threshold*maxJump);
+
+				if(!tagged)
+				{
+					continue;
+				}
+
+				const int site[3] = {i, j, k};
+				int first[3];
+				int last[3];
+				for(int axis = 0; axis < 3; ++axis)
+				{
+					if(axis < dimension)
+					{
+						first[axis] = (std::max(1, site[axis] - m_config.buffer) - 1)/blockSize;
+						last[axis] = (std::min(ranges[axis]-2, site[axis] + m_config.buffer) - 1)/blockSize;
+					}
+					else
+					{
+						first[axis] = last[axis] = 0;
+					}
+				}
+
+				for(int c = first[2]; c <= last[2]; ++c)
+				{
+					for(int b = first[1]; b <= last[1]; ++b)
+					{
+						for(int a = first[0]; a <= last[0]; ++a)
+						{
+							flagged[a + b*blocks[0] + c*blocks[0]*blocks[1]] = 1;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Each face-connected group of flagged blocks becomes the box of sites bounding it.
+	std::vector<Box> boxes;
+	std::vector<int> stack;
+	for(int start = 0; start < static_cast<int>(flagged.size()); ++start)
+	{
+		if(1 != flagged[start])
+		{
+			continue;
+		}
+
+		Box box = {{{blocks[0], blocks[1], blocks[2]}}, {{-1, -1, -1}}};
+		flagged[start] = 2;
+		stack.push_back(start);
+
+		while(!stack.empty())
+		{
+			int block = stack.back();
+			stack.pop_back();
+
+			const int coordinates[3] = {block % blocks[0], (block / blocks[0]) % blocks[1], block / (blocks[0]*blocks[1])};
+			const int strides[3] = {1, blocks[0], blocks[0]*blocks[1]};
+
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				box.lo[axis] = std::min(box.lo[axis], coordinates[axis]);
+				box.hi[axis] = std::max(box.hi[axis], coordinates[axis]);
+
+				if(coordinates[axis] > 0 && 1 == flagged[block - strides[axis]])
+				{
+					flagged[block - strides[axis]] = 2;
+					stack.push_back(block - strides[axis]);
+				}
+				if(coordinates[axis] < blocks[axis]-1 && 1 == flagged[block + strides[axis]])
+				{
+					flagged[block + strides[axis]] = 2;
+					stack.push_back(block + strides[axis]);
+				}
+			}
+		}
+
+		// Convert from blocks to interior sites, the last block along an axis may be cut short.
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			if(axis < dimension)
+			{
+				box.lo[axis] = 1 + box.lo[axis]*blockSize;
+				box.hi[axis] = std::min(ranges[axis]-2, (box.hi[axis]+1)*blockSize);
+			}
+			else
+			{
+				box.lo[axis] = box.hi[axis] = 0;
+			}
+		}
+		boxes.push_back(box);
+	}
+
+	// Bounding boxes of different groups can still overlap, so merge them until none do.
+	for(bool merged = true; merged;)
+	{
+		merged = false;
+		for(std::size_t a = 0; a < boxes.size() && !merged; ++a)
+		{
+			for(std::size_t b = a+1; b < boxes.size() && !merged; ++b)
+			{
+				if(overlap(boxes[a], boxes[b]))
+				{
+					for(int axis = 0; axis < 3; ++axis)
+					{
+						boxes[a].lo[axis] = std::min(boxes[a].lo[axis], boxes[b].lo[axis]);
+						boxes[a].hi[axis] = std::max(boxes[a].hi[axis], boxes[b].hi[axis]);
+					}
+					boxes.erase(boxes.begin() + b);
+					merged = true;
+				}
+			}
+		}
+	}
+
+	BoundaryConditions external;
+	for(int face = 0; face < 6; ++face)
+	{
+		external.set(static_cast<BoundaryConditions::Face>(face), BoundaryConditions::External);
+	}
+
+	for(const Box &box : boxes)
+	{
+		Patch patch;
+		patch.level = level;
+		patch.parent = parent;
+
+		// The halo of the patch lies on the parent sites either side of the box.
+		int fineRanges[3];
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			patch.origin[axis] = axis < dimension ? box.lo[axis]-1 : 0;
+			patch.extent[axis] = axis < dimension ? box.hi[axis] - box.lo[axis] + 2 : 0;
+			fineRanges[axis] = 2*patch.extent[axis] + 1;
+		}
+
+		patch.lattice.reset(new PoissonLattice(fineRanges[0], fineRanges[1], fineRanges[2], lattice.permittivity(), lattice.dx()/2));
+		PoissonLattice &fine = *patch.lattice;
+		fine.setBoundaryConditions(external);
+
+		// Start from the parent's solution and charge density.
+		for(int k = 0; k < fineRanges[2]; ++k)
+		{
+			for(int j = 0; j < fineRanges[1]; ++j)
+			{
+				for(int i = 0; i < fineRanges[0]; ++i)
+				{
+					std::array<int,3> site = {{i, j, k}};
+					fine(i, j, k) = interpolate(lattice, lattice.data(), patch.origin, site);
+					fine.setChargeDensity(i, j, k, interpolate(lattice, lattice.chargeDensityData(), patch.origin, site));
+				}
+			}
+		}
+
+		m_patches.push_back(std::move(patch));
+	}
+}
+
+void AmrHierarchy::interpolateHalo(Patch &patch)
+{
+	PoissonLattice &parent = parentOf(patch);
+	PoissonLattice &fine = *patch.lattice;
+	const int ranges[3] = {fine.xRange(), fine.yRange(), fine.zRange()};
+	const int dimension = fine.dimension();
+
+	for(int k = 0; k < ranges[2]; ++k)
+	{
+		for(int j = 0; j < ranges[1]; ++j)
+		{
+			for(int i = 0; i < ranges[0]; ++i)
+			{
+				const int site[3] = {i, j, k};
+				bool halo = false;
+				for(int axis = 0; axis < dimension; ++axis)
+				{
+					halo = halo || 0 == site[axis] || ranges[axis]-1 == site[axis];
+				}
+
+				if(halo)
+				{
+					fine(i, j, k) = interpolate(parent, parent.data(), patch.origin, {{i, j, k}});
+				}
+			}
+		}
+	}
+}
+
+void AmrHierarchy::coveredSites(const Patch &patch, int first[3], int last[3])
+{
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		first[axis] = patch.extent[axis] > 0 ? patch.origin[axis]+1 : 0;
+		last[axis] = patch.extent[axis] > 0 ? patch.origin[axis] + patch.extent[axis]-1 : 0;
+	}
+}
+
+void AmrHierarchy::inject(Patch &patch)
+{
+	PoissonLattice &parent = parentOf(patch);
+	const PoissonLattice &fine = *patch.lattice;
+	int first[3];
+	int last[3];
+	coveredSites(patch, first, last);
+
+	for(int k = first[2]; k <= last[2]; ++k)
+	{
+		for(int j = first[1]; j <= last[1]; ++j)
+		{
+			for(int i = first[0]; i <= last[0]; ++i)
+			{
+				// Conductors of the parent keep their potential, the patch knows nothing of them.
+				if(!parent.isFixed(i, j, k))
+				{
+					parent(i, j, k) = fine(2*(i - patch.origin[0]), 2*(j - patch.origin[1]), 2*(k - patch.origin[2]));
+				}
+			}
+		}
+	}
+}
+
+void AmrHierarchy::correctChargeDensity(Patch &patch)
+{
+	PoissonLattice &parent = parentOf(patch);
+	const int strides[3] = {1, parent.xPitch(), parent.planeSize()};
+	const double *potential = parent.data();
+	const double scale = parent.permittivity()/std::pow(parent.dx(), 2);
+	int first[3];
+	int last[3];
+	coveredSites(patch, first, last);
+
+	const bool save = patch.parentCharge.empty();
+	for(int k = first[2]; k <= last[2]; ++k)
+	{
+		for(int j = first[1]; j <= last[1]; ++j)
+		{
+			for(int i = first[0]; i <= last[0]; ++i)
+			{
+				if(save)
+				{
+					patch.parentCharge.push_back(parent.getChargeDensity(i, j, k));
+				}
+
+				// The charge density the coarse update needs to give back the injected potential.
+				const int index = parent.index(i, j, k);
+				double laplacian = 0;
+				for(int axis = 0; axis < parent.dimension(); ++axis)
+				{
+					laplacian += potential[index - strides[axis]] + potential[index + strides[axis]] - 2*potential[index];
+				}
+				parent.setChargeDensity(i, j, k, -scale*laplacian);
+			}
+		}
+	}
+}
+
+void AmrHierarchy::restoreChargeDensity(Patch &patch)
+{
+	if(patch.parentCharge.empty())
+	{
+		return;
+	}
+
+	PoissonLattice &parent = parentOf(patch);
+	int first[3];
+	int last[3];
+	coveredSites(patch, first, last);
+
+	std::size_t n = 0;
+	for(int k = first[2]; k <= last[2]; ++k)
+	{
+		for(int j = first[1]; j <= last[1]; ++j)
+		{
+			for(int i = first[0]; i <= last[0]; ++i, ++n)
+			{
+				parent.setChargeDensity(i, j, k, patch.parentCharge[n]);
+			}
+		}
+	}
+	patch.parentCharge.clear();
+}
+
+PoissonSolver::Result AmrHierarchy::solve(const PoissonSolver &solver)
+{
+	m_patches.clear();
+
+	PoissonSolver::Result result = solver.solve(m_base);
+	int iterations = result.iterations;
+	bool converged = result.converged;
+
+	// Place each level on the solution of the one below, patches are only added after the ones being refined.
+	if(m_config.levels > 0)
+	{
+		refine(m_base, -1, 1);
+	}
+	for(std::size_t p = 0; p < m_patches.size(); ++p)
+	{
+		result = solver.solve(*m_patches[p].lattice);
+		iterations += result.iterations;
+		converged = converged && result.converged;
+
+		if(m_patches[p].level < m_config.levels)
+		{
+			refine(*m_patches[p].lattice, static_cast<int>(p), m_patches[p].level + 1);
+		}
+	}
+
+	// Alternate between the levels until, with the fine solutions passed down, the base lattice converges on its
+	// first sweep, so by the solver's own measure the fine solutions no longer move the coarse one.
+	double measure = 0;
+	bool settled = m_patches.empty();
+	for(int cycle = 0; ; ++cycle)
+	{
+		// Finest patches first so each level passes on what it received from above.
+		for(std::size_t p = m_patches.size(); p-- > 0;)
+		{
+			inject(m_patches[p]);
+		}
+
+		if(settled || cycle >= m_config.maxCycles)
+		{
+			break;
+		}
+
+		// Full approximation scheme: the parent sites under a patch keep the fine solution as long as nothing
+		// outside the patch moves, and otherwise carry the correction across it at the coarse spacing.
+		for(Patch &patch : m_patches)
+		{
+			correctChargeDensity(patch);
+		}
+
+		result = solver.solve(m_base);
+		iterations += result.iterations;
+		converged = result.converged;
+		measure = result.convergence;
+		settled = 1 == result.iterations;
+
+		for(Patch &patch : m_patches)
+		{
+			interpolateHalo(patch);
+			result = solver.solve(*patch.lattice);
+			iterations += result.iterations;
+			converged = converged && result.converged;
+		}
+	}
+
+	for(Patch &patch : m_patches)
+	{
+		restoreChargeDensity(patch);
+	}
+
+	result.iterations = iterations;
+	result.convergence = measure;
+	result.converged = converged && settled;
+
+	return result;
+}
+
+int AmrHierarchy::numberOfPatches() const
+{
+	return static_cast<int>(m_patches.size());
+}
+
+void AmrHierarchy::write(const std::string &directory) const
+{
+	std::ofstream index(directory + "/amrPatches.txt");
+	index << "patch level parent origin-x origin-y origin-z dx\n";
+
+	for(std::size_t p = 0; p < m_patches.size(); ++p)
+	{
+		const Patch &patch = m_patches[p];
+
+		index << p << ' ' << patch.level << ' ' << patch.parent << ' ' << patch.origin[0] << ' '
+			  << patch.origin[1] << ' ' << patch.origin[2] << ' ' << patch.lattice->dx() << '\n';
+
+		std::ofstream output(directory + "/amrPatch" + std::to_string(p) + ".dat");
+		output << *patch.lattice;
+	}
+}
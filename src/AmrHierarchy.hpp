@@ -0,0 +1,177 @@
+#ifndef AmrHierarchy_hpp
+#define AmrHierarchy_hpp
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include "PoissonLattice.hpp"
+#include "PoissonSolver.hpp"
+
+/**
+ *\file
+ *\class AmrHierarchy
+ *\brief Block-structured adaptive mesh refinement on top of a base PoissonLattice.
+ *
+ * Refined patches are placed where the charge density or the potential gradient of the level below is large.
+ * Sites are tagged, the lattice is cut into blocks and every block within a few sites of a tag is refined,
+ * with face-connected blocks merged into one patch covering their bounding box. Each patch is a PoissonLattice
+ * with half the spacing of its parent whose sites line up with the parent's sites at even indices, and whose
+ * halo lies on parent sites so it is filled by interpolation at the coarse-fine interface. Patches can be
+ * refined again up to the requested number of levels.
+ *
+ * The composite solve alternates between the levels: the patches are solved with their halo interpolated
+ * from the parent, the fine solution is injected into the parent sites it covers, and the parent is solved
+ * again. This is a full approximation scheme, the covered parent sites are given the charge density for which
+ * the injected potential solves the coarse equation, so the parent keeps the fine solution under a patch and
+ * still carries corrections across it. The cycles stop once the base lattice converges on its first sweep after
+ * the fine solutions have been injected, the same test the solver stops a single lattice with.
+ *
+ * Patches use the permittivity and uniform spacing of the base lattice and the charge density interpolated
+ * from their parent, and the charge density of the covered sites is worked out with that permittivity and
+ * spacing too, so the base lattice needs a uniform permittivity and spacing. Conductors of the base keep their
+ * potential, but a patch solves straight through them, so they don't belong under a patch either.
+ */
+class AmrHierarchy
+{
+public:
+	/**
+	 *\struct Config
+	 *\brief Settings of the refinement.
+	 */
+	struct Config
+	{
+		/// Number of levels of refinement above the base lattice.
+		int levels;
+
+		/// Size in parent sites of the blocks that are refined.
+		int blockSize;
+
+		/// Sites are tagged where the charge density or gradient is at least this fraction of its maximum.
+		double threshold;
+
+		/// Blocks within this many sites of a tagged site are refined.
+		int buffer;
+
+		/// Maximum number of composite cycles.
+		int maxCycles;
+	};
+
+private:
+	/**
+	 *\struct Patch
+	 *\brief A refined lattice and where it sits in its parent.
+	 */
+	struct Patch
+	{
+		/// Level of the patch, 1 for patches on the base lattice.
+		int level;
+
+		/// Index of the parent patch, -1 for the base lattice.
+		int parent;
+
+		/// Parent site that site (0,0,0) of the patch lies on.
+		std::array<int,3> origin;
+
+		/// Number of parent spacings the patch spans along each axis.
+		std::array<int,3> extent;
+
+		/// The refined lattice.
+		std::unique_ptr<PoissonLattice> lattice;
+
+		/// Charge density of the parent sites the patch covers, put back once the composite solve is done.
+		std::vector<double> parentCharge;
+	};
+
+	/// Settings of the refinement.
+	Config m_config;
+
+	/// The base lattice.
+	PoissonLattice &m_base;
+
+	/// Patches ordered by level.
+	std::vector<Patch> m_patches;
+
+	/**
+	 *\brief gets the lattice a patch was refined from.
+	 *\param patch the patch.
+	 *\return the parent lattice.
+	 */
+	PoissonLattice& parentOf(const Patch &patch);
+
+	/**
+	 *\brief places the patches refining a lattice.
+	 *\param lattice lattice to refine, which has been solved.
+	 *\param parent index of the lattice in m_patches, -1 for the base lattice.
+	 *\param level level of the new patches.
+	 */
+	void refine(const PoissonLattice &lattice, int parent, int level);
+
+	/**
+	 *\brief fills the halo of a patch by interpolating the potential of its parent.
+	 *\param patch patch to fill.
+	 */
+	void interpolateHalo(Patch &patch);
+
+	/**
+	 *\brief gets the inclusive range of parent sites covered by the interior of a patch.
+	 *\param patch the patch.
+	 *\param first first covered parent site along each axis.
+	 *\param last last covered parent site along each axis.
+	 */
+	static void coveredSites(const Patch &patch, int first[3], int last[3]);
+
+	/**
+	 *\brief copies the potential of a patch onto the parent sites it covers.
+	 *\param patch patch to inject.
+	 */
+	void inject(Patch &patch);
+
+	/**
+	 *\brief sets the charge density of the parent sites a patch covers to the one the injected potential solves.
+	 *
+	 * The charge density the parent had there is saved in the patch the first time.
+	 *
+	 *\param patch patch that has been injected.
+	 */
+	void correctChargeDensity(Patch &patch);
+
+	/**
+	 *\brief puts back the charge density of the parent sites a patch covers.
+	 *\param patch patch whose parent charge density was corrected.
+	 */
+	void restoreChargeDensity(Patch &patch);
+
+public:
+	/**
+	 *\brief Constructs a hierarchy with no patches yet, they are placed by solve.
+	 *\param base base lattice holding the charge density, holds the coarse solution afterwards.
+	 *\param config settings of the refinement.
+	 */
+	AmrHierarchy(PoissonLattice &base, const Config &config);
+
+	/**
+	 *\brief solves the base lattice, places the patches level by level and does composite cycles until converged.
+	 *\param solver solver used for every lattice, its precision also decides when the composite cycles stop.
+	 *\return total number of sweeps over every lattice, the convergence measure of the last base sweep, and
+	 * whether the composite solve converged.
+	 */
+	PoissonSolver::Result solve(const PoissonSolver &solver);
+
+	/**
+	 *\brief gets the number of patches.
+	 *\return number of patches over every level.
+	 */
+	int numberOfPatches() const;
+
+	/**
+	 *\brief writes each patch in the same format as the base lattice, plus an index of where the patches are.
+	 *
+	 * Patch n goes into amrPatch<n>.dat and amrPatches.txt lists the level, parent, origin in parent sites and
+	 * spacing of each patch.
+	 *
+	 *\param directory directory to write the files into.
+	 */
+	void write(const std::string &directory) const;
+};
+
+#endif /* AmrHierarchy_hpp */
@@ -0,0 +1,181 @@
+#include "BoundaryConditions.hpp"
+#include <cstddef>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	/// Names of the faces in the order of BoundaryConditions::Face.
+	const char *faceNames[6] = {"x-low", "x-high", "y-low", "y-high", "z-low", "z-high"};
+
+	/// Names of the types in the order of BoundaryConditions::Type.
+	const char *typeNames[4] = {"dirichlet", "neumann", "periodic", "external"};
+}
+
+BoundaryConditions::BoundaryConditions()
+{
+	Condition zeroPotential = {Dirichlet, 0.0};
+	m_conditions.fill(zeroPotential);
+}
+
+const BoundaryConditions::Condition& BoundaryConditions::operator[](Face face) const
+{
+	return m_conditions[face];
+}
+
+void BoundaryConditions::set(Face face, Type type, double value)
+{
+	Condition condition = {type, value};
+	m_conditions[face] = condition;
+}
+
+void BoundaryConditions::set(const std::string &specification)
+{
+	std::size_t equals = specification.find('=');
+	if(std::string::npos == equals)
+	{
+		throw std::invalid_argument("Boundary condition needs the form faces=type[:value]: " + specification);
+	}
+
+	std::string faces = specification.substr(0, equals);
+	std::string condition = specification.substr(equals+1);
+
+	// Split off the optional value.
+	double value = 0;
+	std::size_t colon = condition.find(':');
+	if(std::string::npos != colon)
+	{
+		value = std::stod(condition.substr(colon+1));
+		condition = condition.substr(0, colon);
+	}
+
+	int type = -1;
+	for(int t = 0; t < 4; ++t)
+	{
+		if(condition == typeNames[t])
+		{
+			type = t;
+		}
+	}
+
+	// Work out which faces the condition applies to.
+	std::vector<Face> selected;
+	for(int f = 0; f < 6; ++f)
+	{
+		if("all" == faces || faces == faceNames[f] || (1 == faces.size() && faces[0] == faceNames[f][0]))
+		{
+			selected.push_back(static_cast<Face>(f));
+		}
+	}
+
+	if(type < 0 || selected.empty())
+	{
+		throw std::invalid_argument("Unknown boundary condition: " + specification);
+	}
+
+	// Nothing outside the program fills an external halo, so it would keep whatever the lattice started with.
+	if(External == type)
+	{
+		throw std::invalid_argument("External faces are only set by the solver itself, for the patches of a refined mesh: " + specification);
+	}
+
+	for(std::size_t f = 0; f < selected.size(); ++f)
+	{
+		set(selected[f], static_cast<Type>(type), value);
+	}
+}
+
+void BoundaryConditions::validate() const
+{
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		if((Periodic == m_conditions[2*axis].type) != (Periodic == m_conditions[2*axis+1].type))
+		{
+			throw std::invalid_argument(std::string("Both faces of an axis have to be periodic: ") + faceNames[2*axis] + " and " + faceNames[2*axis+1]);
+		}
+	}
+}
+
+bool BoundaryConditions::periodic(int axis) const
+{
+	return Periodic == m_conditions[2*axis].type && Periodic == m_conditions[2*axis+1].type;
+}
+
+void BoundaryConditions::apply(double *potential, const std::array<int,3> &ranges, const std::array<std::ptrdiff_t,3> &strides,
+							   int dimension, const std::array<double,6> &spacings, bool lowLayerIsBoundary,
+							   bool highLayerIsBoundary) const
+{
+	for(int axis = 0; axis < dimension; ++axis)
+	{
+		// The other two axes span the face.
+		int first = (axis+1)%3;
+		int second = (axis+2)%3;
+		int range = ranges[axis];
+
+		for(int side = 0; side < 2; ++side)
+		{
+			const Condition &condition = m_conditions[2*axis + side];
+			bool outermost = (axis == dimension-1);
+
+			// The ends of the outermost axis of a slab may be halo layers filled by the decomposition.
+			if(outermost && ((0 == side && !lowLayerIsBoundary) || (1 == side && !highLayerIsBoundary)))
+			{
+				continue;
+			}
+			if(outermost && Periodic == condition.type && !(lowLayerIsBoundary && highLayerIsBoundary))
+			{
+				continue;
+			}
+
+			// Offsets along the axis of the halo site, its interior neighbour and the site it wraps round to.
+			std::ptrdiff_t halo = (0 == side ? 0 : range-1) * strides[axis];
+			std::ptrdiff_t inner = (0 == side ? 1 : range-2) * strides[axis];
+			std::ptrdiff_t wrapped = (0 == side ? range-2 : 1) * strides[axis];
+
+			for(int v = 0; v < ranges[second]; ++v)
+			{
+				for(int u = 0; u < ranges[first]; ++u)
+				{
+					double *site = potential + u*strides[first] + v*strides[second];
+
+					switch(condition.type)
+					{
+						case Dirichlet:
+							site[halo] = condition.value;
+							break;
+
+						// Ghost site chosen so the one sided difference across the face is the outward flux.
+						case Neumann:
+							site[halo] = site[inner] + condition.value*spacings[2*axis + side];
+							break;
+
+						case Periodic:
+							site[halo] = site[wrapped];
+							break;
+
+						case External:
+							break;
+					}
+				}
+			}
+		}
+	}
+}
+
+std::ostream& operator<<(std::ostream &out, const BoundaryConditions &conditions)
+{
+	int outputColumnWidth = 30;
+	for(int f = 0; f < 6; ++f)
+	{
+		const BoundaryConditions::Condition &condition = conditions.m_conditions[f];
+		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Boundary-" + std::string(faceNames[f]) + ": "
+			<< std::right << typeNames[condition.type];
+		if(BoundaryConditions::Dirichlet == condition.type || BoundaryConditions::Neumann == condition.type)
+		{
+			out << ' ' << condition.value;
+		}
+		out << '\n';
+	}
+	return out;
+}
@@ -0,0 +1,141 @@
+#ifndef BoundaryConditions_hpp
+#define BoundaryConditions_hpp
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+/**
+ *\file
+ *\class BoundaryConditions
+ *\brief Boundary condition on each face of the lattice, imposed by filling the halo before every sweep.
+ *
+ * The halo sites at index 0 and range-1 along each axis are not updated by the sweeps. Filling them from
+ * the boundary conditions once per sweep means the sweep kernels treat every site the same way and need no
+ * branches. A Dirichlet face holds the halo at a fixed potential, a Neumann face sets it so the outward
+ * normal derivative of the potential is the given flux, and a periodic face copies the interior sites from
+ * the opposite side of the lattice, so the period is range-2. Periodic faces come in pairs. Jacobi and the
+ * red-black and line methods only read sites from the last sweep or half sweep, which is what the halo holds.
+ * A lexicographic sweep has to read the sites it has already updated at the other end of a periodic axis, so
+ * it copies them into the halo again as it goes, otherwise the wrap would lag a sweep behind and SOR would
+ * diverge at large omega. An external face is left alone so its owner can set it, such as the coarse-fine
+ * interface of a refined patch. By default every face is Dirichlet with a potential of zero.
+ */
+class BoundaryConditions
+{
+public:
+	/**
+	 *\enum Type of condition imposed on a face.
+	 */
+	enum Type
+	{
+		Dirichlet,
+		Neumann,
+		Periodic,
+		External
+	};
+
+	/**
+	 *\enum Face of the lattice, the low face of an axis is at index 0 and the high face at range-1.
+	 */
+	enum Face
+	{
+		XLow,
+		XHigh,
+		YLow,
+		YHigh,
+		ZLow,
+		ZHigh
+	};
+
+	/**
+	 *\struct Condition
+	 *\brief Condition imposed on a single face.
+	 */
+	struct Condition
+	{
+		/// Type of the condition.
+		Type type;
+
+		/// Potential for a Dirichlet face or outward normal derivative for a Neumann face.
+		double value;
+	};
+
+private:
+	/// Condition on each face, indexed by Face.
+	std::array<Condition,6> m_conditions;
+
+public:
+	/**
+	 *\brief Constructs boundary conditions with every face held at zero potential.
+	 */
+	BoundaryConditions();
+
+	/**
+	 *\brief gets the condition on a face.
+	 *\param face face of the lattice.
+	 *\return the condition.
+	 */
+	const Condition& operator[](Face face) const;
+
+	/**
+	 *\brief sets the condition on a face.
+	 *\param face face of the lattice.
+	 *\param type type of the condition.
+	 *\param value potential for a Dirichlet face or outward normal derivative for a Neumann face.
+	 */
+	void set(Face face, Type type, double value = 0);
+
+	/**
+	 *\brief sets conditions from a command line specification of the form faces=type[:value].
+	 *
+	 * faces is a single face (x-low, x-high, y-low, y-high, z-low or z-high), an axis (x, y or z) for both of
+	 * its faces, or all. type is dirichlet, neumann or periodic and value defaults to zero, for example
+	 * z=periodic, x-low=dirichlet:1 or all=neumann:0.5. External faces are refused, they can only be set
+	 * face by face by the code that fills their halo.
+	 *
+	 *\param specification the specification, throws std::invalid_argument if it can't be parsed.
+	 */
+	void set(const std::string &specification);
+
+	/**
+	 *\brief checks that periodic faces come in pairs, throws std::invalid_argument if they don't.
+	 */
+	void validate() const;
+
+	/**
+	 *\brief checks whether an axis is periodic.
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\return whether both faces of the axis are periodic.
+	 */
+	bool periodic(int axis) const;
+
+	/**
+	 *\brief fills the halo of a lattice.
+	 *
+	 * Only axes within the dimension of the lattice have a halo. The lowest and highest layers along the
+	 * outermost axis are only filled if they are part of the boundary rather than the halo of a slab, and a
+	 * periodic outermost axis is only filled if the lattice holds both ends of it, otherwise the halo exchange
+	 * of the decomposition takes care of it.
+	 *
+	 *\param potential pointer to site (0,0,0) of the lattice, stored with x fastest, then y, then z.
+	 *\param ranges range of x, y and z values of the lattice.
+	 *\param strides distance between neighbouring sites along x, y and z, including any padding.
+	 *\param dimension number of dimensions of the lattice.
+	 *\param spacings distance between the halo and the first interior site at each face, indexed by Face.
+	 *\param lowLayerIsBoundary whether layer 0 along the outermost axis is part of the boundary.
+	 *\param highLayerIsBoundary whether the last layer along the outermost axis is part of the boundary.
+	 */
+	void apply(double *potential, const std::array<int,3> &ranges, const std::array<std::ptrdiff_t,3> &strides, int dimension,
+			   const std::array<double,6> &spacings, bool lowLayerIsBoundary, bool highLayerIsBoundary) const;
+
+	/**
+	 *\brief operator<< overload for outputting the conditions in the same format as the input parameters.
+	 *\param out std::ostream reference that is the stream being outputted to.
+	 *\param conditions boundary conditions to be output.
+	 *\return std::ostream reference so the operator can be chained.
+	 */
+	friend std::ostream& operator<<(std::ostream &out, const BoundaryConditions &conditions);
+};
+
+#endif /* BoundaryConditions_hpp */
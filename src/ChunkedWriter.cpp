@@ -0,0 +1,196 @@
+#include "ChunkedWriter.hpp"
+#include "TextFormat.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <omp.h>
+
+namespace
+{
+	/// Number of sites each thread formats in a round, roughly 25MB of text.
+	const int chunkSites = 1 << 18;
+
+	/**
+	 *\brief formats whole planes of a lattice into a buffer in the text layout of writeLattice.
+	 *\param buffer replaced with the text, its capacity is reused.
+	 *\param lattice Poisson lattice to print from.
+	 *\param field electric field of the lattice.
+	 *\param first first z index.
+	 *\param last one past the last z index.
+	 */
+	void formatPlanes(std::string &buffer, const PoissonLattice &lattice, const ElectricField &field, int first, int last)
+	{
+		TextFormat::formatLattice(buffer, lattice, field, {{0, 0, first}}, {{lattice.xRange()-1, lattice.yRange()-1, last-1}});
+	}
+}
+
+ChunkedWriter::ChunkedWriter(const std::string &fileName) : m_fileName(fileName),
+	m_descriptor(open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644))
+{
+	if(m_descriptor < 0)
+	{
+		throw std::runtime_error(fileName + " can't be opened for writing: " + std::strerror(errno));
+	}
+}
+
+ChunkedWriter::~ChunkedWriter()
+{
+	close(m_descriptor);
+}
+
+void ChunkedWriter::write(const char *bytes, std::size_t size, std::uint64_t offset)
+{
+	// pwrite may write less than asked for, so keep going from where it stopped.
+	while(size > 0)
+	{
+		ssize_t written = pwrite(m_descriptor, bytes, size, static_cast<off_t>(offset));
+		if(written < 0)
+		{
+			if(EINTR == errno)
+			{
+				continue;
+			}
+			throw std::runtime_error(m_fileName + " can't be written: " + std::strerror(errno));
+		}
+		bytes += written;
+		size -= written;
+		offset += written;
+	}
+}
+
+void ChunkedWriter::writeValues(const double *values, std::size_t count, std::uint64_t offset)
+{
+	// Exceptions can't leave a parallel region, so the first one is kept and thrown afterwards.
+	std::string error;
+
+	#pragma omp parallel
+	{
+		const std::size_t threads = omp_get_num_threads();
+		const std::size_t thread = omp_get_thread_num();
+		const std::size_t first = count*thread/threads;
+		const std::size_t last = count*(thread + 1)/threads;
+
+		try
+		{
+			write(reinterpret_cast<const char*>(values + first), (last - first)*sizeof(double), offset + first*sizeof(double));
+		}
+		catch(const std::exception &exception)
+		{
+			#pragma omp critical
+			error = exception.what();
+		}
+	}
+
+	if(!error.empty())
+	{
+		throw std::runtime_error(error);
+	}
+}
+
+void ChunkedWriter::writePlanes(const PoissonLattice &lattice, const double *values, std::uint64_t offset)
+{
+	const std::size_t planeSites = static_cast<std::size_t>(lattice.xRange())*lattice.yRange();
+	if(!lattice.padded())
+	{
+		writeValues(values, planeSites*lattice.zRange(), offset);
+		return;
+	}
+
+	std::string error;
+
+	#pragma omp parallel
+	{
+		std::vector<double> plane(planeSites);
+
+		#pragma omp for schedule(static)
+		for(int k = 0; k < lattice.zRange(); ++k)
+		{
+			lattice.packPlanes(values, plane.data(), k, k+1);
+
+			try
+			{
+				write(reinterpret_cast<const char*>(plane.data()), planeSites*sizeof(double), offset + k*planeSites*sizeof(double));
+			}
+			catch(const std::exception &exception)
+			{
+				#pragma omp critical
+				error = exception.what();
+			}
+		}
+	}
+
+	if(!error.empty())
+	{
+		throw std::runtime_error(error);
+	}
+}
+
+void ChunkedWriter::writeLattice(const PoissonLattice &lattice, const ElectricField &field)
+{
+	const int zRange = lattice.zRange();
+	const int planesPerChunk = std::max(1, chunkSites/(lattice.xRange()*lattice.yRange()));
+
+	// Size of each thread's chunk in the current round, and where the round starts in the file.
+	std::vector<std::size_t> sizes(omp_get_max_threads());
+	std::uint64_t roundOffset = 0;
+	std::string error;
+
+	#pragma omp parallel
+	{
+		const int threads = omp_get_num_threads();
+		const int thread = omp_get_thread_num();
+		std::string buffer;
+
+		// Every thread goes round the same number of times so they all meet at the barriers.
+		for(int round = 0; round < zRange; round += threads*planesPerChunk)
+		{
+			int first = std::min(zRange, round + thread*planesPerChunk);
+			int last = std::min(zRange, first + planesPerChunk);
+
+			buffer.clear();
+			if(first < last)
+			{
+				formatPlanes(buffer, lattice, field, first, last);
+			}
+			sizes[thread] = buffer.size();
+
+			#pragma omp barrier
+
+			// A chunk starts where the chunks before it in the round end.
+			std::uint64_t offset = roundOffset;
+			for(int t = 0; t < thread; ++t)
+			{
+				offset += sizes[t];
+			}
+
+			try
+			{
+				write(buffer.data(), buffer.size(), offset);
+			}
+			catch(const std::exception &exception)
+			{
+				#pragma omp critical
+				error = exception.what();
+			}
+
+			#pragma omp barrier
+
+			#pragma omp single
+			{
+				for(int t = 0; t < threads; ++t)
+				{
+					roundOffset += sizes[t];
+				}
+			}
+		}
+	}
+
+	if(!error.empty())
+	{
+		throw std::runtime_error(error);
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef ChunkedWriter_hpp
+#define ChunkedWriter_hpp
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "PoissonLattice.hpp"
+#include "ElectricField.hpp"
+
+/**
+ *\file
+ *\class ChunkedWriter
+ *\brief A file that several threads write into at once, each at its own offset with pwrite.
+ *
+ * Large outputs are cut into chunks of whole planes. Every thread formats or encodes its chunk into its own
+ * buffer, and once the byte size of each chunk is known the offsets follow from a running sum, so the chunks
+ * are written side by side rather than one after another through a single stream. For text the lattice is
+ * written in rounds of one chunk per thread so only a round of text is held in memory at once; binary
+ * arrays are written straight from memory at offsets known up front.
+ */
+class ChunkedWriter
+{
+private:
+	/// Name of the file, for error messages.
+	std::string m_fileName;
+
+	/// Descriptor of the open file.
+	int m_descriptor;
+
+public:
+	/**
+	 *\brief opens a file for writing, creating it or truncating it.
+	 *\param fileName name of the file, throws std::runtime_error if it can't be opened.
+	 */
+	explicit ChunkedWriter(const std::string &fileName);
+
+	/**
+	 *\brief closes the file.
+	 */
+	~ChunkedWriter();
+
+	ChunkedWriter(const ChunkedWriter&) = delete;
+	ChunkedWriter& operator=(const ChunkedWriter&) = delete;
+
+	/**
+	 *\brief writes bytes at an offset, safe to call from several threads at once.
+	 *\param bytes the bytes.
+	 *\param size number of bytes.
+	 *\param offset offset into the file, throws std::runtime_error if the bytes can't be written.
+	 */
+	void write(const char *bytes, std::size_t size, std::uint64_t offset);
+
+	/**
+	 *\brief writes an array of doubles at an offset, each thread writing a contiguous share of it.
+	 *\param values the values.
+	 *\param count number of values.
+	 *\param offset offset into the file of the first value.
+	 */
+	void writeValues(const double *values, std::size_t count, std::uint64_t offset);
+
+	/**
+	 *\brief writes an array held in the layout of a lattice as contiguous doubles, x fastest, then y, then z.
+	 *
+	 * An unpadded array is written straight from memory like writeValues, while each thread packs the planes
+	 * of a padded one into its own buffer first.
+	 *
+	 *\param lattice lattice whose layout the array is in.
+	 *\param values the array, e.g. the potential or a component of the electric field.
+	 *\param offset offset into the file of the first value.
+	 */
+	void writePlanes(const PoissonLattice &lattice, const double *values, std::uint64_t offset);
+
+	/**
+	 *\brief writes a lattice in the same text layout as writeLattice, with each thread formatting its own planes.
+	 *\param lattice Poisson lattice to print from.
+	 *\param field electric field of the lattice.
+	 */
+	void writeLattice(const PoissonLattice &lattice, const ElectricField &field);
+};
+
+#endif /* ChunkedWriter_hpp */
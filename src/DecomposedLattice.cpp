@@ -0,0 +1,135 @@
+#include "DecomposedLattice.hpp"
+#include <algorithm>
+
+DecomposedLattice::DecomposedLattice(const PoissonLattice &lattice, int numberOfSlabs)
+{
+	// Layers 0 and layers()-1 are the boundary so only the layers in between are shared out.
+	int interiorLayers = lattice.layers() - 2;
+	numberOfSlabs = std::max(1, std::min(numberOfSlabs, interiorLayers));
+
+	// Share the layers out as evenly as possible, the first slabs get one extra layer if they don't divide.
+	m_begin.resize(numberOfSlabs + 1);
+	for(int s = 0; s <= numberOfSlabs; ++s)
+	{
+		m_begin[s] = 1 + s*(interiorLayers/numberOfSlabs) + std::min(s, interiorLayers%numberOfSlabs);
+	}
+
+	m_slabs.resize(numberOfSlabs);
+	m_updatedSlabs.resize(numberOfSlabs);
+
+	// Each thread constructs the slab it owns so its memory is first touched by that thread.
+	#pragma omp parallel for schedule(static) num_threads(numberOfSlabs)
+	for(int s = 0; s < numberOfSlabs; ++s)
+	{
+		m_slabs[s].reset(new PoissonLattice(lattice, m_begin[s], m_begin[s+1]));
+		m_updatedSlabs[s].reset(new PoissonLattice(*m_slabs[s]));
+	}
+}
+
+int DecomposedLattice::numberOfSlabs() const
+{
+	return static_cast<int>(m_slabs.size());
+}
+
+void DecomposedLattice::pullHalo(int slab)
+{
+	PoissonLattice &lattice = *m_slabs[slab];
+	int layerSize = lattice.layerSize();
+
+	// A periodic outermost axis wraps round so the first and last slabs are neighbours, a single slab wraps itself.
+	bool periodic = lattice.boundaryConditions().periodic(lattice.dimension()-1) && numberOfSlabs() > 1;
+
+	// The lower halo is the last owned layer of the slab below.
+	if(slab > 0 || periodic)
+	{
+		const PoissonLattice &below = *m_slabs[slab > 0 ? slab-1 : numberOfSlabs()-1];
+		std::copy(below.layer(below.layers()-2), below.layer(below.layers()-2) + layerSize, lattice.layer(0));
+	}
+
+	// The upper halo is the first owned layer of the slab above.
+	if(slab < numberOfSlabs()-1 || periodic)
+	{
+		const PoissonLattice &above = *m_slabs[slab < numberOfSlabs()-1 ? slab+1 : 0];
+		std::copy(above.layer(1), above.layer(1) + layerSize, lattice.layer(lattice.layers()-1));
+	}
+}
+
+double DecomposedLattice::jacobiUpdate()
+{
+	return chebyshevJacobiUpdate(1.0);
+}
+
+double DecomposedLattice::chebyshevJacobiUpdate(double weight)
+{
+	double convergenceMeasure = 0;
+	int slabs = numberOfSlabs();
+
+	#pragma omp parallel num_threads(slabs) reduction(+:convergenceMeasure)
+	{
+		#pragma omp for schedule(static)
+		for(int s = 0; s < slabs; ++s)
+		{
+			convergenceMeasure += ::chebyshevJacobiUpdate(weight, *m_slabs[s], *m_updatedSlabs[s]);
+
+			// The updated slab becomes the current one, its halo is stale until the exchange below.
+			std::swap(m_slabs[s], m_updatedSlabs[s]);
+		}
+
+		// The implicit barrier above guarantees every slab has been swept before the halos are exchanged.
+		#pragma omp for schedule(static)
+		for(int s = 0; s < slabs; ++s)
+		{
+			pullHalo(s);
+		}
+	}
+
+	return convergenceMeasure;
+}
+
+template<typename HalfSweep>
+double DecomposedLattice::colourUpdate(HalfSweep halfSweep)
+{
+	double convergenceMeasure = 0;
+	int slabs = numberOfSlabs();
+
+	#pragma omp parallel num_threads(slabs) reduction(+:convergenceMeasure)
+	{
+		for(int colour = 0; colour < 2; ++colour)
+		{
+			#pragma omp for schedule(static)
+			for(int s = 0; s < slabs; ++s)
+			{
+				convergenceMeasure += halfSweep(*m_slabs[s], colour);
+			}
+
+			// The other colour needs the sites just updated in neighbouring slabs.
+			#pragma omp for schedule(static)
+			for(int s = 0; s < slabs; ++s)
+			{
+				pullHalo(s);
+			}
+		}
+	}
+
+	return convergenceMeasure;
+}
+
+double DecomposedLattice::redBlackSorUpdate(double sorParameter)
+{
+	return colourUpdate([sorParameter](PoissonLattice &slab, int colour) { return ::redBlackSorUpdate(sorParameter, slab, colour); });
+}
+
+double DecomposedLattice::lineSorUpdate(double sorParameter)
+{
+	return colourUpdate([sorParameter](PoissonLattice &slab, int colour) { return ::lineSorUpdate(sorParameter, slab, colour); });
+}
+
+void DecomposedLattice::gather(PoissonLattice &lattice) const
+{
+	#pragma omp parallel for schedule(static) num_threads(numberOfSlabs())
+	for(int s = 0; s < numberOfSlabs(); ++s)
+	{
+		const PoissonLattice &slab = *m_slabs[s];
+		std::copy(slab.layer(1), slab.layer(slab.layers()-1), lattice.layer(m_begin[s]));
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef DecomposedLattice_hpp
+#define DecomposedLattice_hpp
+#include <vector>
+#include <memory>
+#include "PoissonLattice.hpp"
+
+/**
+ *\file
+ *\class DecomposedLattice
+ *\brief PoissonLattice split into slabs of layers with one slab owned by each thread.
+ *
+ * A layer is a z plane of a 3D lattice or a row of a 2D lattice. Every slab is a PoissonLattice in its own
+ * right with a halo layer either side of the layers it owns. A slab is allocated and initialised by the
+ * thread that owns it, so its pages are placed on that thread's
+ * NUMA node by first touch, and threads never write to the same cache lines during a sweep. The halo layers
+ * are exchanged between neighbouring slabs only at the end of a sweep (or half sweep for red-black SOR).
+ */
+class DecomposedLattice
+{
+private:
+	/// The slabs holding the current state of the potential, slab s is owned by thread s.
+	std::vector<std::unique_ptr<PoissonLattice> > m_slabs;
+
+	/// Second copy of each slab for the Jacobi algorithm to update into.
+	std::vector<std::unique_ptr<PoissonLattice> > m_updatedSlabs;
+
+	/// First layer of the global lattice owned by each slab.
+	std::vector<int> m_begin;
+
+	/**
+	 *\brief copies the halo layers of a slab from the boundary layers of its neighbouring slabs.
+	 *\param slab index of the slab whose halo is to be filled.
+	 */
+	void pullHalo(int slab);
+
+	/**
+	 *\brief does a half sweep of each colour on every slab in parallel, exchanging the halos after each colour.
+	 *\param halfSweep callable updating one colour of a slab and returning its convergence measure.
+	 *\return floating point representing how close old lattice was to updated one.
+	 */
+	template<typename HalfSweep>
+	double colourUpdate(HalfSweep halfSweep);
+
+public:
+	/**
+	 *\brief Constructs a decomposition of a lattice into slabs of roughly equal numbers of layers.
+	 *\param lattice lattice to decompose, which is left unchanged.
+	 *\param numberOfSlabs number of slabs and hence threads, limited to the number of non-boundary layers.
+	 */
+	DecomposedLattice(const PoissonLattice &lattice, int numberOfSlabs);
+
+	/**
+	 *\brief gets the number of slabs in the decomposition.
+	 *\return number of slabs.
+	 */
+	int numberOfSlabs() const;
+
+	/**
+	 *\brief updates every slab with the Jacobi algorithm in parallel and exchanges the halos.
+	 *\return floating point representing how close old lattice was to updated one.
+	 */
+	double jacobiUpdate();
+
+	/**
+	 *\brief does a step of Chebyshev accelerated Jacobi on every slab in parallel and exchanges the halos.
+	 *\param weight weight of the step, 1 for the first step which is a plain Jacobi sweep.
+	 *\return floating point representing how far the Jacobi update is from the current iterate.
+	 */
+	double chebyshevJacobiUpdate(double weight);
+
+	/**
+	 *\brief does a full red-black SOR sweep in parallel, exchanging the halos after each colour.
+	 *\param sorParameter floating point value representing the SOR-parameter omega.
+	 *\return floating point representing how close old lattice was to updated one.
+	 */
+	double redBlackSorUpdate(double sorParameter);
+
+	/**
+	 *\brief does a full zebra line SOR sweep in parallel, exchanging the halos after each colour of lines.
+	 *
+	 * The slabs of a 1D lattice cut its only line into pieces relaxed independently, so a 1D lattice has to be
+	 * decomposed into a single slab for this to converge.
+	 *
+	 *\param sorParameter floating point value representing the SOR-parameter omega.
+	 *\return floating point representing how close old lattice was to updated one.
+	 */
+	double lineSorUpdate(double sorParameter);
+
+	/**
+	 *\brief copies the potential owned by each slab back into a lattice of the original size.
+	 *\param lattice lattice to copy into.
+	 */
+	void gather(PoissonLattice &lattice) const;
+};
+
+#endif /* DecomposedLattice_hpp */
@@ -0,0 +1,253 @@
+#include "DerivedQuantities.hpp"
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	/**
+	 *\brief checks whether a site is inside a box.
+	 *\param box lower then upper corner of the box, inclusive.
+	 *\param site global coordinates of the site.
+	 *\return whether the site is inside.
+	 */
+	bool inside(const std::array<int,6> &box, const int site[3])
+	{
+		return site[0] >= box[0] && site[1] >= box[1] && site[2] >= box[2]
+			&& site[0] <= box[3] && site[1] <= box[4] && site[2] <= box[5];
+	}
+}
+
+DerivedQuantities::DerivedQuantities(const Config &config, const RegionGeometry &conductors): m_config(config),
+																							  m_conductors(conductors)
+{
+
+}
+
+std::array<int,6> DerivedQuantities::parseBox(const std::string &specification)
+{
+	std::array<int,6> box;
+	std::istringstream stream(specification);
+	std::string number;
+	std::size_t n = 0;
+	while(std::getline(stream, number, ','))
+	{
+		if(n >= box.size())
+		{
+			throw std::invalid_argument("Flux box needs the form x0,y0,z0,x1,y1,z1: " + specification);
+		}
+		box[n++] = std::stoi(number);
+	}
+
+	if(n != box.size())
+	{
+		throw std::invalid_argument("Flux box needs the form x0,y0,z0,x1,y1,z1: " + specification);
+	}
+
+	return box;
+}
+
+bool DerivedQuantities::empty() const
+{
+	return !m_config.energy && !m_config.capacitance && m_config.fluxBoxes.empty();
+}
+
+DerivedQuantities::Result DerivedQuantities::compute(const PoissonLattice &lattice) const
+{
+	if(empty())
+	{
+		return Result{0, std::vector<double>(), std::vector<double>()};
+	}
+
+	const int dimension = lattice.dimension();
+	const int outer = dimension-1;
+	const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
+	const int strides[3] = {1, lattice.xPitch(), lattice.planeSize()};
+	const std::size_t sites = lattice.storageSize();
+	const double *potential = lattice.data();
+
+	// On a periodic axis the face from halo 0 to site 1 is the face from site range-2 to halo range-1, so it is
+	// only summed from the high end, where the halo stands for site 1. The outer axis of a slab only has ends
+	// where its layers are the boundary of the whole lattice.
+	bool lowWraps[3] = {false, false, false};
+	bool highWraps[3] = {false, false, false};
+	for(int axis = 0; axis < dimension; ++axis)
+	{
+		const bool periodic = lattice.boundaryConditions().periodic(axis);
+		lowWraps[axis] = periodic && (axis != outer || lattice.lowLayerIsBoundary());
+		highWraps[axis] = periodic && (axis != outer || lattice.highLayerIsBoundary());
+	}
+
+	const int boxes = static_cast<int>(m_config.fluxBoxes.size());
+	const int conductors = m_config.capacitance ? m_conductors.size() : 0;
+
+	// Mean of the spacings either side of each interior site, so a face's area is the product along the other axes.
+	std::array<std::vector<double>,3> meanSpacings;
+	for(int axis = 0; axis < dimension; ++axis)
+	{
+		meanSpacings[axis].assign(ranges[axis], 0.0);
+		for(int n = 1; n < ranges[axis]-1; ++n)
+		{
+			meanSpacings[axis][n] = 0.5*(lattice.spacing(axis, n-1) + lattice.spacing(axis, n));
+		}
+	}
+
+	// Conductor each site is inside, the geometry is in global coordinates which differ along the outer axis.
+	std::vector<int> regions;
+	if(conductors > 0)
+	{
+		regions.assign(sites, -1);
+
+		#pragma omp parallel for schedule(static)
+		for(int k = 0; k < ranges[2]; ++k)
+		{
+			for(int j = 0; j < ranges[1]; ++j)
+			{
+				for(int i = 0; i < ranges[0]; ++i)
+				{
+					int global[3] = {i, j, k};
+					global[outer] += lattice.layerOffset();
+					regions[i + j*strides[1] + k*strides[2]] = m_conductors.find(global[0], global[1], global[2]);
+				}
+			}
+		}
+	}
+
+	Result result = {0, std::vector<double>(boxes, 0.0), std::vector<double>(conductors, 0.0)};
+	double energy = 0;
+
+	#pragma omp parallel
+	{
+		std::vector<double> fluxes(boxes, 0.0);
+		std::vector<double> charges(conductors, 0.0);
+
+		#pragma omp for schedule(static) reduction(+:energy)
+		for(int k = 0; k < ranges[2]; ++k)
+		{
+			for(int j = 0; j < ranges[1]; ++j)
+			{
+				for(int i = 0; i < ranges[0]; ++i)
+				{
+					const int site[3] = {i, j, k};
+					const int n = i + j*strides[1] + k*strides[2];
+
+					// Each face is visited from the site below it.
+					for(int axis = 0; axis < dimension; ++axis)
+					{
+						// The stencil only couples faces whose other coordinates are in the interior.
+						bool coupled = site[axis]+1 < ranges[axis];
+						for(int other = 0; other < dimension; ++other)
+						{
+							coupled = coupled && (other == axis || (site[other] > 0 && site[other] < ranges[other]-1));
+						}
+
+						// A slab owns the outer faces below its layers, and the one to the halo above only at the top.
+						if(axis == outer && site[axis]+1 == ranges[axis]-1 && !lattice.highLayerIsBoundary())
+						{
+							coupled = false;
+						}
+
+						if(!coupled || (lowWraps[axis] && 0 == site[axis]))
+						{
+							continue;
+						}
+
+						const bool wraps = highWraps[axis] && site[axis]+2 == ranges[axis];
+
+						double area = 1;
+						for(int other = 0; other < dimension; ++other)
+						{
+							area *= other == axis ? 1.0 : meanSpacings[other][site[other]];
+						}
+
+						const int m = n + strides[axis];
+						const double difference = potential[n] - potential[m];
+						const double flux = lattice.facePermittivity(axis, m) * area * difference / lattice.spacing(axis, site[axis]);
+
+						energy += 0.5*flux*difference;
+
+						int lower[3] = {i, j, k};
+						lower[outer] += lattice.layerOffset();
+						int upper[3] = {lower[0], lower[1], lower[2]};
+						upper[axis] = wraps ? 1 : upper[axis]+1;
+
+						for(int b = 0; b < boxes; ++b)
+						{
+							bool lowerInside = inside(m_config.fluxBoxes[b], lower);
+							if(lowerInside != inside(m_config.fluxBoxes[b], upper))
+							{
+								fluxes[b] += lowerInside ? flux : -flux;
+							}
+						}
+
+						// The wrapped site may be on another slab, so its conductor is looked up from the geometry.
+						const int upperRegion = conductors > 0 ? (wraps ? m_conductors.find(upper[0], upper[1], upper[2]) : regions[m]) : -1;
+						if(conductors > 0 && regions[n] != upperRegion)
+						{
+							if(regions[n] >= 0)
+							{
+								charges[regions[n]] += flux;
+							}
+							if(upperRegion >= 0)
+							{
+								charges[upperRegion] -= flux;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		#pragma omp critical
+		{
+			for(int b = 0; b < boxes; ++b)
+			{
+				result.fluxes[b] += fluxes[b];
+			}
+			for(int c = 0; c < conductors; ++c)
+			{
+				result.charges[c] += charges[c];
+			}
+		}
+	}
+
+	result.energy = m_config.energy ? energy : 0;
+
+	return result;
+}
+
+void DerivedQuantities::print(std::ostream &out, const Result &result) const
+{
+	int outputColumnWidth = 30;
+
+	if(m_config.energy)
+	{
+		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Electrostatic-energy: " << std::right << result.energy << std::endl;
+	}
+
+	for(std::size_t b = 0; b < result.fluxes.size(); ++b)
+	{
+		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Flux-" + std::to_string(b) + ": " << std::right << result.fluxes[b] << std::endl;
+	}
+
+	for(std::size_t c = 0; c < result.charges.size(); ++c)
+	{
+		const std::string name = "Conductor-" + std::to_string(c);
+		const double potential = m_conductors.value(static_cast<int>(c));
+
+		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << name + "-charge: " << std::right << result.charges[c] << std::endl;
+
+		// Capacitance to everything else, which is taken to be at zero potential.
+		if(0 != potential)
+		{
+			out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << name + "-capacitance: " << std::right << result.charges[c]/potential << std::endl;
+		}
+	}
+
+	// Two conductors at different potentials form a capacitor, with half the difference of their charges on each plate.
+	if(2 == result.charges.size() && m_conductors.value(0) != m_conductors.value(1))
+	{
+		double capacitance = 0.5*(result.charges[0] - result.charges[1])/(m_conductors.value(0) - m_conductors.value(1));
+		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Mutual-capacitance: " << std::right << capacitance << std::endl;
+	}
+}
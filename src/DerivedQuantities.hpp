@@ -0,0 +1,105 @@
+#ifndef DerivedQuantities_hpp
+#define DerivedQuantities_hpp
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "PoissonLattice.hpp"
+#include "RegionGeometry.hpp"
+
+/**
+ *\file
+ *\class DerivedQuantities
+ *\brief Integrals of a solved lattice: the electrostatic energy, the flux through closed surfaces and the
+ * charge and capacitance of conductors.
+ *
+ * Every quantity is a sum over the faces between neighbouring sites that the stencil couples, each face
+ * carrying the displacement flux eps*A*(phi_n - phi_m)/h from site n to site m, where eps is the permittivity
+ * of the face, h the spacing across it and A its area. The energy is half the sum of flux times potential
+ * difference over every face. The flux through a box of sites is the sum over the faces leaving it, which by
+ * Gauss's law is the charge inside. The charge on a conductor is the flux leaving its sites, and its
+ * capacitance is that charge over its potential, with the boundary and any other conductors held where they are.
+ *
+ * All the quantities are reduced in one parallel pass over the faces. On a slab of a distributed lattice
+ * only the faces the slab owns are summed, so adding the results of every slab gives those of the whole lattice.
+ */
+class DerivedQuantities
+{
+public:
+	/**
+	 *\struct Config
+	 *\brief Which quantities to compute.
+	 */
+	struct Config
+	{
+		/// Whether to compute the electrostatic energy.
+		bool energy;
+
+		/// Whether to compute the charge and capacitance of each conductor.
+		bool capacitance;
+
+		/// Boxes of sites, lower then upper corner inclusive, to compute the flux out of.
+		std::vector<std::array<int,6> > fluxBoxes;
+	};
+
+	/**
+	 *\struct Result
+	 *\brief Values of the quantities asked for.
+	 */
+	struct Result
+	{
+		/// Electrostatic energy.
+		double energy;
+
+		/// Flux out of each box.
+		std::vector<double> fluxes;
+
+		/// Charge on each conductor.
+		std::vector<double> charges;
+	};
+
+private:
+	/// Which quantities to compute.
+	Config m_config;
+
+	/// Conductors to find the charge on.
+	const RegionGeometry &m_conductors;
+
+public:
+	/**
+	 *\brief Constructs the reductions.
+	 *\param config which quantities to compute.
+	 *\param conductors the conductors of the lattice, used for the capacitance.
+	 */
+	DerivedQuantities(const Config &config, const RegionGeometry &conductors);
+
+	/**
+	 *\brief parses a box to compute the flux out of.
+	 *\param specification x0,y0,z0,x1,y1,z1 in lattice indices, throws std::invalid_argument if it can't be parsed.
+	 *\return lower then upper corner of the box.
+	 */
+	static std::array<int,6> parseBox(const std::string &specification);
+
+	/**
+	 *\brief checks whether no quantity was asked for, in which case nothing is summed.
+	 *\return whether there is nothing to compute.
+	 */
+	bool empty() const;
+
+	/**
+	 *\brief sums the quantities over the faces owned by a lattice or slab.
+	 *\param lattice solved lattice with its halo filled.
+	 *\return the quantities asked for, the others are left zero or empty, without a pass over the lattice if
+	 * nothing was asked for.
+	 */
+	Result compute(const PoissonLattice &lattice) const;
+
+	/**
+	 *\brief prints the quantities in the same table form as the results file.
+	 *\param out output stream reference to stream to.
+	 *\param result quantities to print.
+	 */
+	void print(std::ostream &out, const Result &result) const;
+};
+
+#endif /* DerivedQuantities_hpp */
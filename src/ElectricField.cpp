@@ -0,0 +1,126 @@
+#include "ElectricField.hpp"
+#include <algorithm>
+#include <cmath>
+
+ElectricField::ElectricField(const PoissonLattice &lattice): m_xRange(lattice.xRange()),
+															 m_yRange(lattice.yRange()),
+															 m_zRange(lattice.zRange()),
+															 m_yStride(lattice.xPitch()),
+															 m_zStride(lattice.planeSize())
+{
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		m_components[axis].resize(lattice.storageSize());
+	}
+	m_magnitude.resize(lattice.storageSize());
+
+	compute(lattice);
+}
+
+namespace
+{
+	/**
+	 *\brief works out the field along the interior of one row, components beyond the dimension are zero.
+	 *\param site potential at the start of the row.
+	 *\param distances distance between the two x neighbours of each site in the row.
+	 *\param yDistance distance between the two y neighbours of the row.
+	 *\param zDistance distance between the two z neighbours of the row.
+	 */
+	template<int Dimension>
+	void fieldRow(const double *site, int xRange, int yStride, int zStride, const double *distances, double yDistance,
+				  double zDistance, double *x, double *y, double *z, double *magnitude)
+	{
+		#pragma omp simd
+		for(int i = 1; i < xRange-1; ++i)
+		{
+			double ex = -(site[i+1] - site[i-1])/distances[i];
+			double ey = Dimension > 1 ? -(site[i+yStride] - site[i-yStride])/yDistance : 0.0;
+			double ez = Dimension > 2 ? -(site[i+zStride] - site[i-zStride])/zDistance : 0.0;
+
+			x[i] = ex;
+			y[i] = ey;
+			z[i] = ez;
+			magnitude[i] = std::sqrt(ex*ex + ey*ey + ez*ez);
+		}
+	}
+}
+
+void ElectricField::compute(const PoissonLattice &lattice)
+{
+	const int dimension = lattice.dimension();
+	const int ranges[3] = {m_xRange, m_yRange, m_zRange};
+	const int yStride = m_yStride;
+	const int zStride = m_zStride;
+
+	// Distance between the two neighbours of each interior site along each active axis, 2dx on a uniform grid.
+	std::array<std::vector<double>,3> distances;
+	for(int axis = 0; axis < dimension; ++axis)
+	{
+		distances[axis].assign(ranges[axis], 0.0);
+		for(int n = 1; n < ranges[axis]-1; ++n)
+		{
+			distances[axis][n] = lattice.spacing(axis, n-1) + lattice.spacing(axis, n);
+		}
+	}
+
+	const double *potential = lattice.data();
+
+	#pragma omp parallel for schedule(static)
+	for(int k = 0; k < m_zRange; ++k)
+	{
+		for(int j = 0; j < m_yRange; ++j)
+		{
+			const int row = j*yStride + k*zStride;
+			double *x = &m_components[0][row];
+			double *y = &m_components[1][row];
+			double *z = &m_components[2][row];
+			double *size = &m_magnitude[row];
+
+			// The field is zero on the halo, which is the whole row on the y and z halo.
+			bool halo = (dimension > 1 && (0 == j || m_yRange-1 == j)) || (dimension > 2 && (0 == k || m_zRange-1 == k));
+			if(halo)
+			{
+				std::fill(x, x + m_xRange, 0.0);
+				std::fill(y, y + m_xRange, 0.0);
+				std::fill(z, z + m_xRange, 0.0);
+				std::fill(size, size + m_xRange, 0.0);
+				continue;
+			}
+
+			x[0] = y[0] = z[0] = size[0] = 0;
+			x[m_xRange-1] = y[m_xRange-1] = z[m_xRange-1] = size[m_xRange-1] = 0;
+
+			switch(dimension)
+			{
+				case 1:
+					fieldRow<1>(potential + row, m_xRange, yStride, zStride, distances[0].data(), 0, 0, x, y, z, size);
+					break;
+
+				case 2:
+					fieldRow<2>(potential + row, m_xRange, yStride, zStride, distances[0].data(), distances[1][j], 0, x, y, z, size);
+					break;
+
+				default:
+					fieldRow<3>(potential + row, m_xRange, yStride, zStride, distances[0].data(), distances[1][j],
+								distances[2][k], x, y, z, size);
+					break;
+			}
+		}
+	}
+}
+
+const double* ElectricField::component(int axis) const
+{
+	return m_components[axis].data();
+}
+
+const double* ElectricField::magnitude() const
+{
+	return m_magnitude.data();
+}
+
+std::array<double,3> ElectricField::operator()(int i, int j, int k) const
+{
+	const int index = i + j*m_yStride + k*m_zStride;
+	return std::array<double,3>{{m_components[0][index], m_components[1][index], m_components[2][index]}};
+}
@@ -0,0 +1,76 @@
+#ifndef ElectricField_hpp
+#define ElectricField_hpp
+#include "PoissonLattice.hpp"
+
+/**
+ *\file
+ *\class ElectricField
+ *\brief Electric field E = -grad(phi) of a solved lattice, worked out for every site in one pass.
+ *
+ * The components and the magnitude are held in separate arrays in the same order as the potential, padding
+ * included, so the output formats read them straight out rather than working out the field site by site while
+ * writing. The pass is split over the threads by layer and the rows are swept in memory order with no branches,
+ * so the x loop vectorises. The field is zero on the halo, and components along axes beyond the dimension of the
+ * lattice are zero.
+ */
+class ElectricField
+{
+private:
+	/// Range of x values.
+	int m_xRange;
+
+	/// Range of y values.
+	int m_yRange;
+
+	/// Range of z values.
+	int m_zRange;
+
+	/// Distance between the starts of consecutive rows.
+	int m_yStride;
+
+	/// Distance between the starts of consecutive z planes.
+	int m_zStride;
+
+	/// x, y and z components of the field.
+	std::array<PoissonLattice::LatticeVector,3> m_components;
+
+	/// Magnitude of the field.
+	PoissonLattice::LatticeVector m_magnitude;
+
+public:
+	/**
+	 *\brief Constructs the field of a lattice from central differences of its potential.
+	 *\param lattice lattice to take the field of, its halo has to hold the boundary conditions.
+	 */
+	explicit ElectricField(const PoissonLattice &lattice);
+
+	/**
+	 *\brief works the field out again, e.g. after the lattice has been solved further.
+	 *\param lattice lattice of the same size as the one the field was constructed from.
+	 */
+	void compute(const PoissonLattice &lattice);
+
+	/**
+	 *\brief gives direct access to one component of the field, stored in the same order as the potential.
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\return pointer to the component at site (0,0,0).
+	 */
+	const double* component(int axis) const;
+
+	/**
+	 *\brief gives direct access to the magnitude of the field, stored in the same order as the potential.
+	 *\return pointer to the magnitude at site (0,0,0).
+	 */
+	const double* magnitude() const;
+
+	/**
+	 *\brief gets the field at a site.
+	 *\param i x coordinate of point.
+	 *\param j y coordinate of point.
+	 *\param k z coordinate of point.
+	 *\return array of the x, y and z components.
+	 */
+	std::array<double,3> operator()(int i, int j, int k) const;
+};
+
+#endif /* ElectricField_hpp */
@@ -0,0 +1,101 @@
+#include "FixedSizeKernels.hpp"
+#include "StencilKernels.hpp"
+
+namespace
+{
+	/// Whether the lookups hand out the specialised kernels.
+	bool kernelsEnabled = true;
+
+	/// Padding of the padded kernels, a cache line on each row and a row on each plane.
+	const int rowPadding = 8;
+	const int planePadding = 1;
+
+	template<int XRange, int YRange, int XPitch, int YPitch>
+	double jacobiKernel(const double *current, double *updated, const double *chargeDensity, int zRange, double chargeFactor)
+	{
+		return jacobiSweep<3>(FixedExtents<XRange,YRange,XPitch,YPitch>(), zRange, current, updated, chargeDensity, chargeFactor);
+	}
+
+	template<int XRange, int YRange, int XPitch, int YPitch>
+	double redBlackKernel(double *potential, const double *chargeDensity, int zRange, int zOffset,
+						  double chargeFactor, double sorParameter, int colour)
+	{
+		return redBlackSweep<3>(FixedExtents<XRange,YRange,XPitch,YPitch>(), zRange, potential, chargeDensity, chargeFactor,
+								sorParameter, zOffset, colour);
+	}
+
+	/**
+	 *\brief picks the unpadded or padded instance of a kernel for a lattice of Range sites along x and y.
+	 *\return the kernel, or nullptr if the lattice has some other padding.
+	 */
+	template<typename Kernel, int Range>
+	Kernel kernelForPitch(int xPitch, int yPitch, Kernel unpadded, Kernel padded)
+	{
+		if(Range == xPitch && Range == yPitch)
+		{
+			return unpadded;
+		}
+		if(Range + rowPadding == xPitch && Range + planePadding == yPitch)
+		{
+			return padded;
+		}
+		return nullptr;
+	}
+}
+
+FixedSizeJacobiKernel fixedSizeJacobiKernel(int xRange, int yRange, int xPitch, int yPitch)
+{
+	if(!kernelsEnabled || xRange != yRange)
+	{
+		return nullptr;
+	}
+
+	switch(xRange)
+	{
+		case 64:
+			return kernelForPitch<FixedSizeJacobiKernel,64>(xPitch, yPitch, &jacobiKernel<64,64,64,64>,
+															&jacobiKernel<64,64,64+rowPadding,64+planePadding>);
+
+		case 128:
+			return kernelForPitch<FixedSizeJacobiKernel,128>(xPitch, yPitch, &jacobiKernel<128,128,128,128>,
+															 &jacobiKernel<128,128,128+rowPadding,128+planePadding>);
+
+		case 256:
+			return kernelForPitch<FixedSizeJacobiKernel,256>(xPitch, yPitch, &jacobiKernel<256,256,256,256>,
+															 &jacobiKernel<256,256,256+rowPadding,256+planePadding>);
+
+		default:
+			return nullptr;
+	}
+}
+
+FixedSizeRedBlackKernel fixedSizeRedBlackKernel(int xRange, int yRange, int xPitch, int yPitch)
+{
+	if(!kernelsEnabled || xRange != yRange)
+	{
+		return nullptr;
+	}
+
+	switch(xRange)
+	{
+		case 64:
+			return kernelForPitch<FixedSizeRedBlackKernel,64>(xPitch, yPitch, &redBlackKernel<64,64,64,64>,
+															  &redBlackKernel<64,64,64+rowPadding,64+planePadding>);
+
+		case 128:
+			return kernelForPitch<FixedSizeRedBlackKernel,128>(xPitch, yPitch, &redBlackKernel<128,128,128,128>,
+															   &redBlackKernel<128,128,128+rowPadding,128+planePadding>);
+
+		case 256:
+			return kernelForPitch<FixedSizeRedBlackKernel,256>(xPitch, yPitch, &redBlackKernel<256,256,256,256>,
+															   &redBlackKernel<256,256,256+rowPadding,256+planePadding>);
+
+		default:
+			return nullptr;
+	}
+}
+
+void setFixedSizeKernelsEnabled(bool enabled)
+{
+	kernelsEnabled = enabled;
+}
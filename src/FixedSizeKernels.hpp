@@ -0,0 +1,52 @@
+#ifndef FixedSizeKernels_hpp
+#define FixedSizeKernels_hpp
+
+/**
+ *\file
+ *\brief Sweep kernels specialised at compile time for the lattice sizes used by most runs.
+ *
+ * The x and y ranges of the lattice fix the strides between neighbouring sites, so with them as template
+ * parameters every index calculation becomes a constant offset and the inner loop has a known trip count,
+ * which lets the compiler unroll and vectorise the sweeps. The z range only bounds the outer loop so it stays
+ * a runtime value, meaning the same kernels also serve the slabs of a decomposed lattice. Kernels exist for
+ * 64, 128 and 256 sites along x and y, either unpadded or with the padding of --lattice-padding 8,1, which
+ * adds a cache line to each row and a row to each plane, and are looked up at runtime, with the generic update
+ * functions in PoissonLattice used for any other size or padding. The kernels are the 3D instances of those
+ * in StencilKernels.hpp.
+ */
+
+/// Jacobi sweep of planes 1 to zRange-2 from current into updated, returning the convergence measure.
+typedef double (*FixedSizeJacobiKernel)(const double *current, double *updated, const double *chargeDensity,
+										int zRange, double chargeFactor);
+
+/// Red-black SOR sweep of one colour of planes 1 to zRange-2, returning the convergence measure.
+typedef double (*FixedSizeRedBlackKernel)(double *potential, const double *chargeDensity, int zRange, int zOffset,
+										  double chargeFactor, double sorParameter, int colour);
+
+/**
+ *\brief looks up the Jacobi kernel specialised for a lattice size.
+ *\param xRange range of x values in the lattice.
+ *\param yRange range of y values in the lattice.
+ *\param xPitch distance between the starts of consecutive rows.
+ *\param yPitch number of rows between the starts of consecutive planes.
+ *\return the kernel, or nullptr if there isn't one for this size and padding or they have been disabled.
+ */
+FixedSizeJacobiKernel fixedSizeJacobiKernel(int xRange, int yRange, int xPitch, int yPitch);
+
+/**
+ *\brief looks up the red-black SOR kernel specialised for a lattice size.
+ *\param xRange range of x values in the lattice.
+ *\param yRange range of y values in the lattice.
+ *\param xPitch distance between the starts of consecutive rows.
+ *\param yPitch number of rows between the starts of consecutive planes.
+ *\return the kernel, or nullptr if there isn't one for this size and padding or they have been disabled.
+ */
+FixedSizeRedBlackKernel fixedSizeRedBlackKernel(int xRange, int yRange, int xPitch, int yPitch);
+
+/**
+ *\brief turns the specialised kernels on or off, they are on by default.
+ *\param enabled whether to use the specialised kernels where they exist.
+ */
+void setFixedSizeKernelsEnabled(bool enabled);
+
+#endif /* FixedSizeKernels_hpp */
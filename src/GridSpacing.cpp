@@ -0,0 +1,125 @@
+#include "GridSpacing.hpp"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+GridSpacing::GridSpacing(int xRange, int yRange, int zRange, double dx): m_dx(dx)
+{
+	const int ranges[3] = {xRange, yRange, zRange};
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		m_positions[axis].resize(ranges[axis]);
+		for(int n = 0; n < ranges[axis]; ++n)
+		{
+			m_positions[axis][n] = n*dx;
+		}
+		m_descriptions[axis] = "uniform";
+	}
+}
+
+void GridSpacing::stretch(int axis, double ratio)
+{
+	std::vector<double> &positions = m_positions[axis];
+	int centre = static_cast<int>(positions.size())/2;
+
+	// Spacing n is between sites n and n+1, count how many spacings it is away from the centre.
+	for(int n = 1; n < static_cast<int>(positions.size()); ++n)
+	{
+		int distance = n-1 < centre ? centre - n : n-1 - centre;
+		positions[n] = positions[n-1] + m_dx*std::pow(ratio, distance);
+	}
+
+	std::ostringstream description;
+	description << "stretch " << ratio;
+	m_descriptions[axis] = description.str();
+}
+
+void GridSpacing::load(int axis, const std::string &fileName)
+{
+	std::vector<double> &positions = m_positions[axis];
+	std::ifstream file(fileName);
+
+	for(std::size_t n = 1; n < positions.size(); ++n)
+	{
+		double spacing;
+		if(!(file >> spacing) || spacing <= 0)
+		{
+			throw std::runtime_error("Spacing file " + fileName + " needs one positive spacing per pair of neighbouring sites.");
+		}
+		positions[n] = positions[n-1] + spacing;
+	}
+
+	m_descriptions[axis] = "file " + fileName;
+}
+
+void GridSpacing::set(const std::string &specification)
+{
+	std::size_t equals = specification.find('=');
+	std::size_t colon = specification.find(':', equals);
+	if(std::string::npos == equals || std::string::npos == colon)
+	{
+		throw std::invalid_argument("Spacing needs the form axes=stretch:ratio or axes=file:name: " + specification);
+	}
+
+	std::string axes = specification.substr(0, equals);
+	std::string kind = specification.substr(equals+1, colon-equals-1);
+	std::string argument = specification.substr(colon+1);
+
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		if("all" != axes && (1 != axes.size() || axes[0] != 'x' + axis))
+		{
+			continue;
+		}
+
+		// Axes beyond the dimension of the domain only have a single site.
+		if(m_positions[axis].size() < 2)
+		{
+			continue;
+		}
+
+		if("stretch" == kind)
+		{
+			stretch(axis, std::stod(argument));
+		}
+		else if("file" == kind)
+		{
+			load(axis, argument);
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown spacing: " + specification);
+		}
+	}
+}
+
+bool GridSpacing::uniform() const
+{
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		if("uniform" != m_descriptions[axis])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+const std::vector<double>& GridSpacing::positions(int axis) const
+{
+	return m_positions[axis];
+}
+
+std::ostream& operator<<(std::ostream &out, const GridSpacing &spacing)
+{
+	int outputColumnWidth = 30;
+	const char *names[3] = {"Spacing-x: ", "Spacing-y: ", "Spacing-z: "};
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << names[axis] << std::right
+			<< spacing.m_descriptions[axis] << '\n';
+	}
+	return out;
+}
@@ -0,0 +1,85 @@
+#ifndef GridSpacing_hpp
+#define GridSpacing_hpp
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ *\file
+ *\class GridSpacing
+ *\brief Positions of the lattice sites along each axis, so the spacing can vary from site to site.
+ *
+ * Every axis starts out uniform with the spacing dx. An axis can instead be stretched geometrically away from
+ * the centre of the lattice, where setPointChargeDist puts the charge, so the resolution is concentrated where
+ * the field varies fastest, or read from a file of spacings. Positions cover the global lattice including the
+ * halo.
+ */
+class GridSpacing
+{
+private:
+	/// Position of every site along each axis.
+	std::array<std::vector<double>,3> m_positions;
+
+	/// How each axis was set, for printing.
+	std::array<std::string,3> m_descriptions;
+
+	/// Spacing of the uniform grid.
+	double m_dx;
+
+public:
+	/**
+	 *\brief Constructs a uniform grid.
+	 *\param xRange range of x values of the global lattice.
+	 *\param yRange range of y values of the global lattice.
+	 *\param zRange range of z values of the global lattice.
+	 *\param dx spacing along every axis.
+	 */
+	GridSpacing(int xRange, int yRange, int zRange, double dx);
+
+	/**
+	 *\brief stretches an axis so the spacing grows by a constant ratio from site to site away from the centre.
+	 *
+	 * The two spacings either side of the centre site range/2 are dx, the next ones dx*ratio and so on.
+	 *
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\param ratio ratio of neighbouring spacings, at least 1.
+	 */
+	void stretch(int axis, double ratio);
+
+	/**
+	 *\brief reads the spacings along an axis from a file.
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\param fileName text file holding range-1 spacings, throws std::runtime_error if it can't be read.
+	 */
+	void load(int axis, const std::string &fileName);
+
+	/**
+	 *\brief sets an axis from a command line specification of the form axes=stretch:ratio or axes=file:name.
+	 *\param specification the specification, axes is x, y, z or all, throws std::invalid_argument if it can't be parsed.
+	 */
+	void set(const std::string &specification);
+
+	/**
+	 *\brief checks whether every axis has the uniform spacing dx.
+	 *\return whether the grid is uniform.
+	 */
+	bool uniform() const;
+
+	/**
+	 *\brief gets the positions of the sites along an axis.
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\return position of every site of the global lattice along the axis.
+	 */
+	const std::vector<double>& positions(int axis) const;
+
+	/**
+	 *\brief operator<< overload for outputting the spacing in the same format as the input parameters.
+	 *\param out std::ostream reference that is the stream being outputted to.
+	 *\param spacing grid spacing to be output.
+	 *\return std::ostream reference so the operator can be chained.
+	 */
+	friend std::ostream& operator<<(std::ostream &out, const GridSpacing &spacing);
+};
+
+#endif /* GridSpacing_hpp */
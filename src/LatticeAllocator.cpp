@@ -0,0 +1,433 @@
+#include "LatticeAllocator.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <numa.h>
+
+namespace
+{
+	/// Buffers smaller than this come from the heap rather than being mapped from the operating system.
+	const std::size_t mappingThreshold = 1 << 16;
+
+	/// Alignment of heap buffers, a cache line so padded rows start on a cache line whatever the lattice size.
+	const std::size_t heapAlignment = 64;
+
+	/// Size of a huge page on x86-64, buffers at least this big are aligned to it.
+	const std::size_t hugePageSize = 1 << 21;
+
+	/// Policy used for every lattice buffer allocated without an explicit policy.
+	LatticeMemory::Policy currentDefaultPolicy = {LatticeMemory::FirstTouch, 0, LatticeMemory::NoHugePages};
+
+	/// Number of explicit huge page allocations that had to fall back to normal pages.
+	std::atomic<int> hugePageFallbacks(0);
+
+	/**
+	 *\brief gets the size of the mapping backing a buffer, which only depends on the size of the buffer so
+	 * deallocation does not need to know how the buffer was allocated.
+	 *\param bytes size of the buffer.
+	 *\return size of the mapping.
+	 */
+	std::size_t mappingSize(std::size_t bytes)
+	{
+		return bytes < hugePageSize ? bytes : (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+	}
+
+	/**
+	 *\brief maps anonymous memory aligned to a huge page if it is at least one huge page in size.
+	 *\param bytes size of the mapping.
+	 *\return pointer to the mapping or MAP_FAILED.
+	 */
+	void* mapAligned(std::size_t bytes)
+	{
+		if(bytes < hugePageSize)
+		{
+			return mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+
+		// Map an extra huge page and unmap whatever sticks out either side of the aligned region.
+		void *pointer = mmap(nullptr, bytes + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(MAP_FAILED == pointer)
+		{
+			return pointer;
+		}
+
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(pointer);
+		std::uintptr_t aligned = (start + hugePageSize - 1) / hugePageSize * hugePageSize;
+		if(aligned > start)
+		{
+			munmap(pointer, aligned - start);
+		}
+		munmap(reinterpret_cast<void*>(aligned + bytes), start + hugePageSize - aligned);
+
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	/**
+	 *\brief maps a buffer with the huge pages and placement of a policy, without touching it.
+	 *\param bytes size of the mapping, a whole number of huge pages if it is at least one.
+	 *\param policy policy to place the pages of the buffer with.
+	 *\return pointer to the buffer, throws std::bad_alloc on failure.
+	 */
+	void* mapBuffer(std::size_t bytes, const LatticeMemory::Policy &policy)
+	{
+		bool hugeEnough = bytes >= hugePageSize && LatticeMemory::NoHugePages != policy.hugePages;
+
+		// Anonymous mappings are only backed by physical pages once they are written to.
+		void *pointer = MAP_FAILED;
+		if(hugeEnough && LatticeMemory::ExplicitHugePages == policy.hugePages)
+		{
+			pointer = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+			// The hugetlbfs pool is empty or not configured, carry on with transparent huge pages instead.
+			if(MAP_FAILED == pointer)
+			{
+				++hugePageFallbacks;
+			}
+		}
+
+		if(MAP_FAILED == pointer)
+		{
+			pointer = mapAligned(bytes);
+			if(MAP_FAILED == pointer)
+			{
+				throw std::bad_alloc();
+			}
+
+			// Only a hint, it is ignored if transparent huge pages are disabled.
+			if(hugeEnough)
+			{
+				madvise(pointer, bytes, MADV_HUGEPAGE);
+			}
+		}
+
+		// The memory policy only matters on NUMA machines, elsewhere every placement is the same.
+		if(numa_available() >= 0)
+		{
+			switch(policy.placement)
+			{
+				case LatticeMemory::Interleaved:
+					numa_interleave_memory(pointer, bytes, numa_all_nodes_ptr);
+					break;
+
+				case LatticeMemory::SingleNode:
+					numa_tonode_memory(pointer, bytes, policy.node);
+					break;
+
+				// First touch is the default policy of the kernel.
+				default:
+					break;
+			}
+		}
+
+		return pointer;
+	}
+
+	/**
+	 *\brief rounds the size of a mapping up to its size class in the pool, one of eight per power of two.
+	 *\param bytes size of the mapping.
+	 *\return size of the class, still a whole number of huge pages if the mapping was.
+	 */
+	std::size_t sizeClass(std::size_t bytes)
+	{
+		std::size_t power = 1;
+		while(power <= bytes/2)
+		{
+			power *= 2;
+		}
+		std::size_t step = std::max<std::size_t>(power/8, 4096);
+		return (bytes + step - 1)/step*step;
+	}
+
+	/**
+	 *\struct PoolKey
+	 *\brief Size class and policy a pooled buffer can be reused for.
+	 */
+	struct PoolKey
+	{
+		std::size_t bytes;
+		int placement;
+		int node;
+		int hugePages;
+
+		bool operator<(const PoolKey &other) const
+		{
+			return std::tie(bytes, placement, node, hugePages) < std::tie(other.bytes, other.placement, other.node, other.hugePages);
+		}
+	};
+
+	/**
+	 *\struct PoolBuffers
+	 *\brief Idle buffers of one key and how they have been used.
+	 */
+	struct PoolBuffers
+	{
+		std::vector<void*> idle;
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+		std::size_t inUse = 0;
+		std::size_t peakInUse = 0;
+	};
+
+	/**
+	 *\struct Pool
+	 *\brief Every buffer the pool has handed out, idle or not, guarded by one mutex.
+	 */
+	struct Pool
+	{
+		std::mutex mutex;
+		std::size_t limit = 0;
+		std::map<PoolKey, PoolBuffers> buffers;
+
+		/// Key of every buffer mapped for the pool, so freeing finds it whether or not the pool is still enabled.
+		std::unordered_map<void*, PoolKey> keys;
+
+		std::size_t bytesInUse = 0;
+		std::size_t peakBytesInUse = 0;
+		std::size_t bytesIdle = 0;
+		std::size_t discards = 0;
+	};
+
+	Pool pool;
+
+	/**
+	 *\brief gets the key of a buffer in the pool.
+	 */
+	PoolKey poolKey(std::size_t bytes, const LatticeMemory::Policy &policy)
+	{
+		PoolKey key = {sizeClass(mappingSize(bytes)), policy.placement, policy.node, policy.hugePages};
+		return key;
+	}
+
+	/**
+	 *\brief unmaps the idle buffers above a limit, the caller holds the pool's mutex.
+	 */
+	void trimPool(std::size_t limit)
+	{
+		for(auto &entry : pool.buffers)
+		{
+			while(pool.bytesIdle > limit && !entry.second.idle.empty())
+			{
+				void *pointer = entry.second.idle.back();
+				entry.second.idle.pop_back();
+				pool.keys.erase(pointer);
+				pool.bytesIdle -= entry.first.bytes;
+				munmap(pointer, entry.first.bytes);
+			}
+		}
+	}
+}
+
+LatticeMemory::Policy LatticeMemory::defaultPolicy()
+{
+	return currentDefaultPolicy;
+}
+
+void LatticeMemory::setDefaultPolicy(const Policy &policy)
+{
+	currentDefaultPolicy = policy;
+}
+
+LatticeMemory::Placement LatticeMemory::placementFromString(const std::string &name)
+{
+	if("first-touch" == name)
+	{
+		return FirstTouch;
+	}
+	else if("interleaved" == name)
+	{
+		return Interleaved;
+	}
+	else if("single-node" == name)
+	{
+		return SingleNode;
+	}
+
+	throw std::invalid_argument("Unknown memory placement: " + name);
+}
+
+LatticeMemory::HugePages LatticeMemory::hugePagesFromString(const std::string &name)
+{
+	if("none" == name)
+	{
+		return NoHugePages;
+	}
+	else if("transparent" == name)
+	{
+		return TransparentHugePages;
+	}
+	else if("explicit" == name)
+	{
+		return ExplicitHugePages;
+	}
+
+	throw std::invalid_argument("Unknown huge page mode: " + name);
+}
+
+int LatticeMemory::explicitHugePageFallbacks()
+{
+	return hugePageFallbacks;
+}
+
+void LatticeMemory::setPoolLimit(std::size_t limit)
+{
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	pool.limit = limit;
+	trimPool(limit);
+}
+
+void LatticeMemory::prewarmPool(std::size_t bytes, int count, const Policy &policy)
+{
+	if(bytes < mappingThreshold)
+	{
+		return;
+	}
+
+	const PoolKey key = poolKey(bytes, policy);
+	for(int n = 0; n < count; ++n)
+	{
+		void *pointer = mapBuffer(key.bytes, policy);
+
+		// Fault the pages in now, split between the threads like the layers of a lattice so first touch places them alike.
+		char *bytePointer = static_cast<char*>(pointer);
+		const long pages = static_cast<long>(key.bytes/4096);
+		#pragma omp parallel for schedule(static)
+		for(long page = 0; page < pages; ++page)
+		{
+			bytePointer[page*4096] = 0;
+		}
+
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		if(pool.bytesIdle + key.bytes > pool.limit)
+		{
+			munmap(pointer, key.bytes);
+			break;
+		}
+		pool.keys[pointer] = key;
+		pool.buffers[key].idle.push_back(pointer);
+		pool.bytesIdle += key.bytes;
+	}
+}
+
+LatticeMemory::PoolStatistics LatticeMemory::poolStatistics()
+{
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	PoolStatistics statistics = {pool.limit > 0, pool.limit, pool.bytesInUse, pool.peakBytesInUse, pool.bytesIdle, pool.discards, {}};
+
+	// Buckets with several policies are reported once per size.
+	for(const auto &entry : pool.buffers)
+	{
+		if(statistics.buckets.empty() || statistics.buckets.back().bytes != entry.first.bytes)
+		{
+			PoolBucket bucket = {entry.first.bytes, 0, 0, 0, 0};
+			statistics.buckets.push_back(bucket);
+		}
+		PoolBucket &bucket = statistics.buckets.back();
+		bucket.hits += entry.second.hits;
+		bucket.misses += entry.second.misses;
+		bucket.peakInUse += entry.second.peakInUse;
+		bucket.idle += entry.second.idle.size();
+	}
+	return statistics;
+}
+
+std::ostream& operator<<(std::ostream &out, const LatticeMemory::PoolStatistics &statistics)
+{
+	int outputColumnWidth = 30;
+	out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Pool-limit(bytes): " << std::right << statistics.limit << std::endl;
+	out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Pool-peak-bytes-in-use: " << std::right << statistics.peakBytesInUse << std::endl;
+	out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Pool-bytes-idle: " << std::right << statistics.bytesIdle << std::endl;
+	out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Pool-discards: " << std::right << statistics.discards << std::endl;
+	for(const LatticeMemory::PoolBucket &bucket : statistics.buckets)
+	{
+		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Pool-bucket-" + std::to_string(bucket.bytes) + ": " << std::right
+			<< "hits " << bucket.hits << " misses " << bucket.misses << " peak-in-use " << bucket.peakInUse << " idle " << bucket.idle << std::endl;
+	}
+	return out;
+}
+
+void* LatticeMemory::allocate(std::size_t bytes, const Policy &policy)
+{
+	if(bytes < mappingThreshold)
+	{
+		void *pointer;
+		if(0 != posix_memalign(&pointer, heapAlignment, std::max<std::size_t>(bytes, 1)))
+		{
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		if(pool.limit > 0)
+		{
+			const PoolKey key = poolKey(bytes, policy);
+			PoolBuffers &buffers = pool.buffers[key];
+
+			void *pointer;
+			if(buffers.idle.empty())
+			{
+				pointer = mapBuffer(key.bytes, policy);
+				pool.keys[pointer] = key;
+				++buffers.misses;
+			}
+			else
+			{
+				pointer = buffers.idle.back();
+				buffers.idle.pop_back();
+				pool.bytesIdle -= key.bytes;
+				++buffers.hits;
+			}
+
+			buffers.peakInUse = std::max(buffers.peakInUse, ++buffers.inUse);
+			pool.bytesInUse += key.bytes;
+			pool.peakBytesInUse = std::max(pool.peakBytesInUse, pool.bytesInUse);
+			return pointer;
+		}
+	}
+
+	return mapBuffer(mappingSize(bytes), policy);
+}
+
+void LatticeMemory::deallocate(void *pointer, std::size_t bytes)
+{
+	if(bytes < mappingThreshold)
+	{
+		std::free(pointer);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		auto found = pool.keys.find(pointer);
+		if(pool.keys.end() != found)
+		{
+			const PoolKey key = found->second;
+			--pool.buffers[key].inUse;
+			pool.bytesInUse -= key.bytes;
+
+			if(pool.bytesIdle + key.bytes <= pool.limit)
+			{
+				pool.buffers[key].idle.push_back(pointer);
+				pool.bytesIdle += key.bytes;
+			}
+			else
+			{
+				++pool.discards;
+				pool.keys.erase(found);
+				munmap(pointer, key.bytes);
+			}
+			return;
+		}
+	}
+
+	munmap(pointer, mappingSize(bytes));
+}
@@ -0,0 +1,275 @@
+#ifndef LatticeAllocator_hpp
+#define LatticeAllocator_hpp
+#include <cstddef>
+#include <iostream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ *\file
+ *\class LatticeMemory
+ *\brief Allocation of large lattice buffers with control over which NUMA nodes their pages are placed on.
+ *
+ * Large buffers are mapped directly from the operating system and are never written to when they are
+ * allocated, so with first-touch placement each page ends up on the node of the thread that first writes
+ * to it. The placement can instead be interleaved over every node or bound to a single node. Small buffers
+ * come from the normal heap since they would waste most of a page, aligned to a 64 byte cache line.
+ *
+ * Buffers of at least one huge page are aligned to a huge page boundary and can be backed by huge pages,
+ * either transparent huge pages requested with madvise or explicit pages from the hugetlbfs pool. If the
+ * explicit pool is empty the allocation falls back to transparent huge pages.
+ */
+class LatticeMemory
+{
+public:
+	/**
+	 *\enum Placement of the pages of a buffer on the NUMA nodes of the machine.
+	 */
+	enum Placement
+	{
+		FirstTouch,
+		Interleaved,
+		SingleNode
+	};
+
+	/**
+	 *\enum HugePages to back large buffers with.
+	 */
+	enum HugePages
+	{
+		NoHugePages,
+		TransparentHugePages,
+		ExplicitHugePages
+	};
+
+	/**
+	 *\struct Policy
+	 *\brief How lattice buffers should be allocated.
+	 */
+	struct Policy
+	{
+		/// Placement of the pages on the NUMA nodes.
+		Placement placement;
+
+		/// Node to place every page on for SingleNode placement.
+		int node;
+
+		/// Huge pages to back buffers of at least one huge page with.
+		HugePages hugePages;
+	};
+
+	/**
+	 *\brief gets the policy lattice buffers are currently allocated with.
+	 *\return the default policy.
+	 */
+	static Policy defaultPolicy();
+
+	/**
+	 *\brief sets the policy every lattice buffer allocated from now on will use.
+	 *\param policy the new default policy.
+	 */
+	static void setDefaultPolicy(const Policy &policy);
+
+	/**
+	 *\brief converts the name of a placement used on the command line to the placement.
+	 *\param name one of first-touch, interleaved or single-node.
+	 *\return the placement, throws std::invalid_argument if the name is not recognised.
+	 */
+	static Placement placementFromString(const std::string &name);
+
+	/**
+	 *\brief converts the name of a huge page mode used on the command line to the mode.
+	 *\param name one of none, transparent or explicit.
+	 *\return the huge page mode, throws std::invalid_argument if the name is not recognised.
+	 */
+	static HugePages hugePagesFromString(const std::string &name);
+
+	/**
+	 *\brief gets how many buffers asked for explicit huge pages but fell back to transparent huge pages.
+	 *\return number of fallbacks since the program started.
+	 */
+	static int explicitHugePageFallbacks();
+
+	/**
+	 *\struct PoolBucket
+	 *\brief Use of one size class of the buffer pool.
+	 */
+	struct PoolBucket
+	{
+		/// Size of the buffers of the class in bytes.
+		std::size_t bytes;
+
+		/// Allocations served by a recycled buffer.
+		std::size_t hits;
+
+		/// Allocations that had to map a new buffer.
+		std::size_t misses;
+
+		/// Most buffers of the class in use at once.
+		std::size_t peakInUse;
+
+		/// Buffers of the class currently kept idle.
+		std::size_t idle;
+	};
+
+	/**
+	 *\struct PoolStatistics
+	 *\brief Use of the buffer pool since it was enabled, to size its limit and pre-warming with.
+	 */
+	struct PoolStatistics
+	{
+		/// Whether large buffers go through the pool.
+		bool enabled;
+
+		/// Largest number of idle bytes kept.
+		std::size_t limit;
+
+		/// Bytes of pool buffers currently in use.
+		std::size_t bytesInUse;
+
+		/// Most bytes of pool buffers in use at once.
+		std::size_t peakBytesInUse;
+
+		/// Bytes of buffers currently kept idle.
+		std::size_t bytesIdle;
+
+		/// Freed buffers that were unmapped because keeping them would have exceeded the limit.
+		std::size_t discards;
+
+		/// Use of each size class, smallest first.
+		std::vector<PoolBucket> buckets;
+
+		/**
+		 *\brief operator<< overload for outputting the statistics in the same form as the results.
+		 *\param out std::ostream reference that is the stream being outputted to.
+		 *\param statistics the statistics.
+		 *\return std::ostream reference so the operator can be chained.
+		 */
+		friend std::ostream& operator<<(std::ostream &out, const PoolStatistics &statistics);
+	};
+
+	/**
+	 *\brief sends large buffers through the buffer pool from now on, or stops doing so.
+	 *\param limit most idle bytes to keep, zero to stop pooling and unmap the idle buffers.
+	 */
+	static void setPoolLimit(std::size_t limit);
+
+	/**
+	 *\brief maps buffers into the pool ahead of use and writes to them so their pages are already there.
+	 *\param bytes size of each buffer.
+	 *\param count number of buffers.
+	 *\param policy policy to place the pages of the buffers with.
+	 */
+	static void prewarmPool(std::size_t bytes, int count, const Policy &policy);
+
+	/**
+	 *\brief gets the use of the buffer pool.
+	 *\return the statistics.
+	 */
+	static PoolStatistics poolStatistics();
+
+	/**
+	 *\brief allocates memory without touching it, or a recycled buffer from the pool if it is enabled.
+	 *\param bytes size of the buffer in bytes.
+	 *\param policy policy to place the pages of the buffer with.
+	 *\return pointer to the buffer, throws std::bad_alloc on failure.
+	 */
+	static void* allocate(std::size_t bytes, const Policy &policy);
+
+	/**
+	 *\brief frees memory from allocate, keeping buffers from the pool for reuse while under its limit.
+	 *\param pointer pointer returned from allocate.
+	 *\param bytes size the buffer was allocated with.
+	 */
+	static void deallocate(void *pointer, std::size_t bytes);
+};
+
+/**
+ *\class LatticeAllocator
+ *\brief Standard library allocator that gets its memory from LatticeMemory.
+ *
+ * Value-initialising construction (as done by std::vector<T>(n)) is replaced by default initialisation so
+ * creating a container does not write to the memory. The owner is then responsible for writing every element
+ * from the threads that should own the pages.
+ */
+template<typename T>
+class LatticeAllocator
+{
+private:
+	/// Policy buffers from this allocator are allocated with.
+	LatticeMemory::Policy m_policy;
+
+	template<typename U> friend class LatticeAllocator;
+
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef LatticeAllocator<U> other;
+	};
+
+	/**
+	 *\brief Constructs an allocator with the current default policy.
+	 */
+	LatticeAllocator() : m_policy(LatticeMemory::defaultPolicy()) {}
+
+	/**
+	 *\brief Constructs an allocator with the specified policy.
+	 *\param policy policy to allocate buffers with.
+	 */
+	explicit LatticeAllocator(const LatticeMemory::Policy &policy) : m_policy(policy) {}
+
+	template<typename U>
+	LatticeAllocator(const LatticeAllocator<U> &other) : m_policy(other.m_policy) {}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(LatticeMemory::allocate(n*sizeof(T), m_policy));
+	}
+
+	void deallocate(T *pointer, std::size_t n)
+	{
+		LatticeMemory::deallocate(pointer, n*sizeof(T));
+	}
+
+	/// Default initialise rather than value initialise so that no memory is touched.
+	template<typename U>
+	void construct(U *pointer)
+	{
+		::new(static_cast<void*>(pointer)) U;
+	}
+
+	template<typename U, typename... Args>
+	void construct(U *pointer, Args&&... args)
+	{
+		::new(static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+	}
+
+	const LatticeMemory::Policy& policy() const
+	{
+		return m_policy;
+	}
+};
+
+template<typename T, typename U>
+bool operator==(const LatticeAllocator<T>&, const LatticeAllocator<U>&)
+{
+	// Any allocator can free memory from any other since deallocation does not depend on the policy.
+	return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const LatticeAllocator<T> &a, const LatticeAllocator<U> &b)
+{
+	return !(a == b);
+}
+
+#endif /* LatticeAllocator_hpp */
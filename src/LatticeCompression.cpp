@@ -0,0 +1,259 @@
+#include "LatticeCompression.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace
+{
+	/// Number of values a chunk is aimed at, it is rounded to whole layers.
+	const int chunkTarget = 1 << 20;
+
+	/**
+	 *\brief puts byte b of every 8 byte word together, for b from 0 to 7.
+	 *\param words words to shuffle.
+	 *\param count number of words.
+	 *\param shuffled 8*count bytes to shuffle into.
+	 */
+	void shuffle(const unsigned char *words, std::size_t count, unsigned char *shuffled)
+	{
+		for(int b = 0; b < 8; ++b)
+		{
+			for(std::size_t n = 0; n < count; ++n)
+			{
+				shuffled[b*count + n] = words[n*8 + b];
+			}
+		}
+	}
+
+	/**
+	 *\brief undoes shuffle.
+	 *\param shuffled shuffled bytes.
+	 *\param count number of words.
+	 *\param words 8*count bytes to put the words into.
+	 */
+	void unshuffle(const unsigned char *shuffled, std::size_t count, unsigned char *words)
+	{
+		for(int b = 0; b < 8; ++b)
+		{
+			for(std::size_t n = 0; n < count; ++n)
+			{
+				words[n*8 + b] = shuffled[b*count + n];
+			}
+		}
+	}
+
+	/**
+	 *\brief compresses one chunk.
+	 */
+	LatticeCompression::Chunk compressChunk(const double *values, std::size_t count, LatticeCompression::Mode mode, double tolerance)
+	{
+		std::vector<std::uint64_t> words(count);
+		if(LatticeCompression::Lossless == mode)
+		{
+			std::memcpy(words.data(), values, count*sizeof(double));
+		}
+		else
+		{
+			// Differences of neighbouring quantised values are small, zigzag encoding keeps them small when negative.
+			const double step = 2*tolerance;
+			std::int64_t previous = 0;
+			for(std::size_t n = 0; n < count; ++n)
+			{
+				std::int64_t quantised = std::llround(values[n]/step);
+				std::int64_t difference = quantised - previous;
+				words[n] = (static_cast<std::uint64_t>(difference) << 1) ^ static_cast<std::uint64_t>(difference >> 63);
+				previous = quantised;
+			}
+		}
+
+		std::vector<unsigned char> shuffled(count*8);
+		shuffle(reinterpret_cast<const unsigned char*>(words.data()), count, shuffled.data());
+
+		LatticeCompression::Chunk chunk;
+		chunk.values = static_cast<std::int64_t>(count);
+
+		uLongf length = compressBound(shuffled.size());
+		chunk.bytes.resize(length);
+		if(Z_OK != compress2(chunk.bytes.data(), &length, shuffled.data(), shuffled.size(), Z_BEST_SPEED))
+		{
+			throw std::runtime_error("Compression of a lattice chunk failed.");
+		}
+		chunk.bytes.resize(length);
+
+		return chunk;
+	}
+}
+
+LatticeCompression::Mode LatticeCompression::modeFromString(const std::string &name)
+{
+	if("lossless" == name)
+	{
+		return Lossless;
+	}
+	else if("lossy" == name)
+	{
+		return Lossy;
+	}
+
+	throw std::invalid_argument("Unknown compression: " + name);
+}
+
+LatticeCompression::Header LatticeCompression::header(int xRange, int yRange, int zRange, double dx, Mode mode, double tolerance,
+													  std::int64_t chunks)
+{
+	Header header = {{'P', 'C', 'L', 'A', 'T', 'T', '1', '\0'}, mode, {xRange, yRange, zRange}, dx,
+					 Lossy == mode ? tolerance : 0.0, chunks};
+	return header;
+}
+
+std::vector<LatticeCompression::Chunk> LatticeCompression::compress(const double *values, int layers, int layerSize, Mode mode,
+																	double tolerance)
+{
+	if(Lossy == mode && !(tolerance > 0))
+	{
+		throw std::invalid_argument("Lossy compression needs a positive tolerance.");
+	}
+
+	const int layersPerChunk = std::max(1, chunkTarget/layerSize);
+	const int chunks = (layers + layersPerChunk - 1)/layersPerChunk;
+	std::vector<Chunk> compressed(chunks);
+
+	#pragma omp parallel for schedule(dynamic)
+	for(int c = 0; c < chunks; ++c)
+	{
+		int first = c*layersPerChunk;
+		int last = std::min(layers, first + layersPerChunk);
+		compressed[c] = compressChunk(values + static_cast<std::size_t>(first)*layerSize,
+									  static_cast<std::size_t>(last - first)*layerSize, mode, tolerance);
+	}
+
+	return compressed;
+}
+
+void LatticeCompression::decompress(const Chunk &chunk, Mode mode, double tolerance, double *values)
+{
+	const std::size_t count = static_cast<std::size_t>(chunk.values);
+	std::vector<unsigned char> shuffled(count*8);
+
+	uLongf length = shuffled.size();
+	if(Z_OK != uncompress(shuffled.data(), &length, chunk.bytes.data(), chunk.bytes.size()) || length != shuffled.size())
+	{
+		throw std::runtime_error("A lattice chunk is corrupt.");
+	}
+
+	std::vector<std::uint64_t> words(count);
+	unshuffle(shuffled.data(), count, reinterpret_cast<unsigned char*>(words.data()));
+
+	if(Lossless == mode)
+	{
+		std::memcpy(values, words.data(), count*sizeof(double));
+	}
+	else
+	{
+		const double step = 2*tolerance;
+		std::int64_t quantised = 0;
+		for(std::size_t n = 0; n < count; ++n)
+		{
+			std::int64_t difference = static_cast<std::int64_t>(words[n] >> 1) ^ -static_cast<std::int64_t>(words[n] & 1);
+			quantised += difference;
+			values[n] = quantised*step;
+		}
+	}
+}
+
+void LatticeCompression::write(const std::string &fileName, const PoissonLattice &lattice, Mode mode, double tolerance)
+{
+	const std::size_t sites = static_cast<std::size_t>(lattice.xRange())*lattice.yRange()*lattice.zRange();
+
+	// The file holds the sites contiguously, so a padded lattice is packed first.
+	std::vector<double> packed;
+	const double *values = lattice.data();
+	if(lattice.padded())
+	{
+		packed.resize(sites);
+		lattice.packPlanes(lattice.data(), packed.data(), 0, lattice.zRange());
+		values = packed.data();
+	}
+
+	std::vector<Chunk> chunks = compress(values, lattice.layers(), static_cast<int>(sites/lattice.layers()), mode, tolerance);
+	Header fileHeader = header(lattice.xRange(), lattice.yRange(), lattice.zRange(), lattice.dx(), mode, tolerance,
+							   static_cast<std::int64_t>(chunks.size()));
+
+	std::ofstream file(fileName, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+	for(const Chunk &chunk : chunks)
+	{
+		std::int64_t sizes[2] = {chunk.values, static_cast<std::int64_t>(chunk.bytes.size())};
+		file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+	}
+	for(const Chunk &chunk : chunks)
+	{
+		file.write(reinterpret_cast<const char*>(chunk.bytes.data()), chunk.bytes.size());
+	}
+
+	if(!file)
+	{
+		throw std::runtime_error("Compressed lattice " + fileName + " can't be written.");
+	}
+}
+
+std::vector<double> LatticeCompression::read(const std::string &fileName, Header &header)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if(!file || 0 != std::memcmp(header.magic, "PCLATT1", 8) || header.chunks < 0)
+	{
+		throw std::runtime_error(fileName + " isn't a compressed lattice.");
+	}
+
+	std::vector<Chunk> chunks(header.chunks);
+	std::vector<std::size_t> offsets(header.chunks + 1, 0);
+	for(std::int64_t c = 0; c < header.chunks; ++c)
+	{
+		std::int64_t sizes[2];
+		file.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+		chunks[c].values = sizes[0];
+		chunks[c].bytes.resize(sizes[1]);
+		offsets[c+1] = offsets[c] + sizes[0];
+	}
+	for(Chunk &chunk : chunks)
+	{
+		file.read(reinterpret_cast<char*>(chunk.bytes.data()), chunk.bytes.size());
+	}
+
+	const std::size_t sites = static_cast<std::size_t>(header.ranges[0])*header.ranges[1]*header.ranges[2];
+	if(!file || offsets.back() != sites)
+	{
+		throw std::runtime_error(fileName + " is truncated or doesn't match the size of its lattice.");
+	}
+
+	std::vector<double> values(sites);
+	const Mode mode = static_cast<Mode>(header.mode);
+
+	// Exceptions can't leave a parallel region so note a corrupt chunk and throw afterwards.
+	bool corrupt = false;
+
+	#pragma omp parallel for schedule(dynamic)
+	for(std::int64_t c = 0; c < header.chunks; ++c)
+	{
+		try
+		{
+			decompress(chunks[c], mode, header.tolerance, values.data() + offsets[c]);
+		}
+		catch(const std::runtime_error&)
+		{
+			#pragma omp atomic write
+			corrupt = true;
+		}
+	}
+
+	if(corrupt)
+	{
+		throw std::runtime_error(fileName + " has a corrupt chunk.");
+	}
+
+	return values;
+}
@@ -0,0 +1,133 @@
+#ifndef LatticeCompression_hpp
+#define LatticeCompression_hpp
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PoissonLattice.hpp"
+
+/**
+ *\file
+ *\class LatticeCompression
+ *\brief Compressed files of the potential of a lattice, either lossless or with a bounded absolute error.
+ *
+ * The potential is cut into chunks of whole layers which are compressed independently on separate threads,
+ * so a distributed lattice can compress its own layers and the chunks are simply written one after another.
+ * Lossless chunks are byte shuffled, putting the nth byte of every double together so the slowly varying
+ * sign and exponent bytes form long runs, then deflated with zlib. Lossy chunks are quantised to multiples
+ * of twice the tolerance, so no value moves by more than the tolerance, and the differences between
+ * neighbouring quantised values along x are zigzag encoded, shuffled and deflated.
+ *
+ * A file is a Header, a table of the number of values and compressed bytes of each chunk, and then the
+ * chunks in order. The values are the whole lattice including the halo in memory order, the same as the
+ * binary output of the MPI backend.
+ */
+class LatticeCompression
+{
+public:
+	/**
+	 *\enum Mode of compression.
+	 */
+	enum Mode
+	{
+		Lossless,
+		Lossy
+	};
+
+	/**
+	 *\struct Header
+	 *\brief Start of a compressed file.
+	 */
+	struct Header
+	{
+		/// Identifies the file, "PCLATT1" with a terminating zero.
+		char magic[8];
+
+		/// Mode the chunks were compressed with.
+		std::int32_t mode;
+
+		/// Range of x, y and z values of the lattice.
+		std::int32_t ranges[3];
+
+		/// Spatial discretisation step of the lattice.
+		double dx;
+
+		/// Largest absolute error of a lossy file, zero for a lossless one.
+		double tolerance;
+
+		/// Number of chunks.
+		std::int64_t chunks;
+	};
+
+	/**
+	 *\struct Chunk
+	 *\brief A compressed run of values.
+	 */
+	struct Chunk
+	{
+		/// Number of values in the chunk.
+		std::int64_t values;
+
+		/// Compressed bytes.
+		std::vector<unsigned char> bytes;
+	};
+
+	/**
+	 *\brief converts the name of a mode used on the command line to the mode.
+	 *\param name lossless or lossy.
+	 *\return the mode, throws std::invalid_argument if the name is not recognised.
+	 */
+	static Mode modeFromString(const std::string &name);
+
+	/**
+	 *\brief gets a header describing a lattice.
+	 *\param xRange range of x values.
+	 *\param yRange range of y values.
+	 *\param zRange range of z values.
+	 *\param dx spatial discretisation step.
+	 *\param mode mode of compression.
+	 *\param tolerance largest absolute error of lossy compression.
+	 *\param chunks number of chunks.
+	 *\return the header.
+	 */
+	static Header header(int xRange, int yRange, int zRange, double dx, Mode mode, double tolerance, std::int64_t chunks);
+
+	/**
+	 *\brief compresses layers of values, each chunk on its own thread.
+	 *\param values the values.
+	 *\param layers number of layers.
+	 *\param layerSize number of values in a layer.
+	 *\param mode mode of compression.
+	 *\param tolerance largest absolute error of lossy compression.
+	 *\return the chunks in order.
+	 */
+	static std::vector<Chunk> compress(const double *values, int layers, int layerSize, Mode mode, double tolerance);
+
+	/**
+	 *\brief decompresses one chunk.
+	 *\param chunk the chunk.
+	 *\param mode mode it was compressed with.
+	 *\param tolerance tolerance it was compressed with.
+	 *\param values where to put the chunk's values, throws std::runtime_error if the chunk is corrupt.
+	 */
+	static void decompress(const Chunk &chunk, Mode mode, double tolerance, double *values);
+
+	/**
+	 *\brief compresses the potential of a lattice into a file.
+	 *\param fileName name of the file to write.
+	 *\param lattice the lattice.
+	 *\param mode mode of compression.
+	 *\param tolerance largest absolute error of lossy compression.
+	 */
+	static void write(const std::string &fileName, const PoissonLattice &lattice, Mode mode, double tolerance);
+
+	/**
+	 *\brief reads and decompresses a file, each chunk on its own thread.
+	 *\param fileName name of the file to read.
+	 *\param header set to the header of the file.
+	 *\return the potential of the whole lattice, throws std::runtime_error if the file can't be read.
+	 */
+	static std::vector<double> read(const std::string &fileName, Header &header);
+};
+
+#endif /* LatticeCompression_hpp */
@@ -0,0 +1,286 @@
+#include "MpiLattice.hpp"
+#ifdef POISSON_MPI
+#include <algorithm>
+
+int MpiLattice::firstPlane(int zRange, int size, int rank)
+{
+	// Planes 0 and zRange-1 are the boundary so only the planes in between are shared out.
+	int interiorPlanes = zRange - 2;
+	return 1 + rank*(interiorPlanes/size) + std::min(rank, interiorPlanes%size);
+}
+
+MpiLattice::MpiLattice(int xRange, int yRange, int zRange, double permittivity, double dx, MPI_Comm comm): m_comm(comm),
+																										  m_rank(0),
+																										  m_size(1),
+																										  m_xRange(xRange),
+																										  m_yRange(yRange),
+																										  m_zRange(zRange),
+																										  m_kBegin(0),
+																										  m_kEnd(0),
+																										  m_lattice(1, 1, 1, permittivity, dx),
+																										  m_updatedLattice(1, 1, 1, permittivity, dx)
+{
+	MPI_Comm_rank(m_comm, &m_rank);
+	MPI_Comm_size(m_comm, &m_size);
+
+	m_kBegin = firstPlane(m_zRange, m_size, m_rank);
+	m_kEnd = firstPlane(m_zRange, m_size, m_rank+1);
+
+	// Only allocate the owned planes and their halo, plane 0 of the slab is global plane m_kBegin-1.
+	m_lattice = PoissonLattice(m_xRange, m_yRange, m_kEnd - m_kBegin + 2, permittivity, dx, m_kBegin - 1);
+	m_updatedLattice = m_lattice;
+}
+
+void MpiLattice::initialise(double initialValue, double noise, std::default_random_engine &generator)
+{
+	m_lattice.initialise(initialValue, noise, generator);
+	exchangeHalos();
+	m_updatedLattice = m_lattice;
+}
+
+void MpiLattice::setBoundaryConditions(const BoundaryConditions &conditions)
+{
+	// Only the first and last ranks hold the z boundary, the other halo planes come from the neighbours.
+	m_lattice.setBoundaryConditions(conditions, 0 == m_rank, m_size-1 == m_rank);
+	m_updatedLattice.setBoundaryConditions(conditions, 0 == m_rank, m_size-1 == m_rank);
+	exchangeHalos();
+}
+
+void MpiLattice::fillHalo()
+{
+	m_lattice.fillHalo();
+}
+
+void MpiLattice::setConductors(const RegionGeometry &geometry)
+{
+	m_lattice.setConductors(geometry);
+	m_updatedLattice.setConductors(geometry);
+	exchangeHalos();
+}
+
+void MpiLattice::setPermittivity(const RegionGeometry &dielectrics)
+{
+	m_lattice.setPermittivity(dielectrics);
+	m_updatedLattice.setPermittivity(dielectrics);
+}
+
+void MpiLattice::setSpacing(const GridSpacing &spacing)
+{
+	m_lattice.setSpacing(spacing);
+	m_updatedLattice.setSpacing(spacing);
+}
+
+void MpiLattice::setPointChargeDist()
+{
+	// Utilise integer division to find the centre of the global box.
+	int xCentre = m_xRange/2;
+	int yCentre = m_yRange/2;
+	int zCentre = m_zRange/2;
+
+	// Point charge magnitude.
+	double deltaCharge = 1;
+
+	// Only the rank owning the centre plane holds the charge.
+	if(zCentre >= m_kBegin && zCentre < m_kEnd)
+	{
+		m_lattice.setChargeDensity(xCentre, yCentre, zCentre - m_lattice.layerOffset(), deltaCharge);
+		m_updatedLattice.setChargeDensity(xCentre, yCentre, zCentre - m_lattice.layerOffset(), deltaCharge);
+	}
+}
+
+void MpiLattice::exchangeHalos()
+{
+	int planeSize = m_lattice.planeSize();
+	int lastPlane = m_lattice.zRange()-2;
+
+	// Ranks at the ends of the lattice have the boundary in place of a neighbour unless z is periodic.
+	bool periodic = m_lattice.boundaryConditions().periodic(2);
+	int below = m_rank > 0 ? m_rank-1 : (periodic ? m_size-1 : MPI_PROC_NULL);
+	int above = m_rank < m_size-1 ? m_rank+1 : (periodic ? 0 : MPI_PROC_NULL);
+
+	// Send the last owned plane up while receiving the lower halo from below, then the reverse.
+	MPI_Sendrecv(m_lattice.plane(lastPlane), planeSize, MPI_DOUBLE, above, 0,
+				 m_lattice.plane(0), planeSize, MPI_DOUBLE, below, 0, m_comm, MPI_STATUS_IGNORE);
+
+	MPI_Sendrecv(m_lattice.plane(1), planeSize, MPI_DOUBLE, below, 1,
+				 m_lattice.plane(lastPlane+1), planeSize, MPI_DOUBLE, above, 1, m_comm, MPI_STATUS_IGNORE);
+}
+
+double MpiLattice::jacobiUpdate()
+{
+	return chebyshevJacobiUpdate(1.0);
+}
+
+double MpiLattice::chebyshevJacobiUpdate(double weight)
+{
+	double localConvergence = ::chebyshevJacobiUpdate(weight, m_lattice, m_updatedLattice);
+
+	// The updated slab becomes the current one and its halo has to be refreshed.
+	std::swap(m_lattice, m_updatedLattice);
+	exchangeHalos();
+
+	double convergenceMeasure = 0;
+	MPI_Allreduce(&localConvergence, &convergenceMeasure, 1, MPI_DOUBLE, MPI_SUM, m_comm);
+
+	return convergenceMeasure;
+}
+
+double MpiLattice::jacobiSpectralRadius() const
+{
+	return PoissonLattice::jacobiSpectralRadius({{m_xRange, m_yRange, m_zRange}}, m_lattice.dimension(), m_lattice.boundaryConditions());
+}
+
+double MpiLattice::redBlackSorUpdate(double sorParameter)
+{
+	double localConvergence = 0;
+
+	for(int colour = 0; colour < 2; ++colour)
+	{
+		localConvergence += ::redBlackSorUpdate(sorParameter, m_lattice, colour);
+
+		// The other colour needs the sites just updated on the neighbouring ranks.
+		exchangeHalos();
+	}
+
+	double convergenceMeasure = 0;
+	MPI_Allreduce(&localConvergence, &convergenceMeasure, 1, MPI_DOUBLE, MPI_SUM, m_comm);
+
+	return convergenceMeasure;
+}
+
+double MpiLattice::lineSorUpdate(double sorParameter)
+{
+	double localConvergence = 0;
+
+	for(int colour = 0; colour < 2; ++colour)
+	{
+		localConvergence += ::lineSorUpdate(sorParameter, m_lattice, colour);
+
+		// The other colour needs the lines just updated on the neighbouring ranks.
+		exchangeHalos();
+	}
+
+	double convergenceMeasure = 0;
+	MPI_Allreduce(&localConvergence, &convergenceMeasure, 1, MPI_DOUBLE, MPI_SUM, m_comm);
+
+	return convergenceMeasure;
+}
+
+void MpiLattice::writePotential(const std::string &fileName) const
+{
+	// Each rank writes its owned planes, the first and last ranks also write the boundary plane next to them.
+	int firstWritten = m_rank == 0 ? 0 : 1;
+	int lastWritten = m_rank == m_size-1 ? m_lattice.zRange()-1 : m_lattice.zRange()-2;
+
+	// Write whole planes so counts stay within the range of an int for very large lattices, picking the rows
+	// out of a padded plane so the file holds the sites contiguously.
+	MPI_Datatype rowsType;
+	MPI_Type_vector(m_yRange, m_xRange, m_lattice.xPitch(), MPI_DOUBLE, &rowsType);
+	MPI_Datatype planeType;
+	MPI_Type_create_resized(rowsType, 0, static_cast<MPI_Aint>(m_lattice.planeSize())*sizeof(double), &planeType);
+	MPI_Type_commit(&planeType);
+	MPI_Type_free(&rowsType);
+
+	MPI_File file;
+	MPI_File_open(m_comm, fileName.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+	MPI_File_set_size(file, 0);
+
+	MPI_Offset offset = static_cast<MPI_Offset>(m_lattice.layerOffset() + firstWritten) * m_xRange * m_yRange * sizeof(double);
+	MPI_File_write_at_all(file, offset, const_cast<double*>(m_lattice.plane(firstWritten)), lastWritten - firstWritten + 1,
+						  planeType, MPI_STATUS_IGNORE);
+
+	MPI_File_close(&file);
+	MPI_Type_free(&planeType);
+}
+
+void MpiLattice::writeCompressed(const std::string &fileName, LatticeCompression::Mode mode, double tolerance) const
+{
+	int firstWritten = m_rank == 0 ? 0 : 1;
+	int lastWritten = m_rank == m_size-1 ? m_lattice.zRange()-1 : m_lattice.zRange()-2;
+
+	// The file holds the sites contiguously, so a padded slab is packed first.
+	std::vector<double> packed;
+	const double *values = m_lattice.plane(firstWritten);
+	if(m_lattice.padded())
+	{
+		packed.resize(static_cast<std::size_t>(lastWritten - firstWritten + 1)*m_xRange*m_yRange);
+		m_lattice.packPlanes(m_lattice.data(), packed.data(), firstWritten, lastWritten + 1);
+		values = packed.data();
+	}
+
+	std::vector<LatticeCompression::Chunk> chunks = LatticeCompression::compress(values, lastWritten - firstWritten + 1, m_xRange*m_yRange,
+																				 mode, tolerance);
+
+	// Every rank needs the size of every chunk to find where its own chunks go.
+	std::vector<std::int64_t> localSizes;
+	for(const LatticeCompression::Chunk &chunk : chunks)
+	{
+		localSizes.push_back(chunk.values);
+		localSizes.push_back(static_cast<std::int64_t>(chunk.bytes.size()));
+	}
+
+	int localCount = static_cast<int>(localSizes.size());
+	std::vector<int> counts(m_size);
+	MPI_Allgather(&localCount, 1, MPI_INT, counts.data(), 1, MPI_INT, m_comm);
+
+	std::vector<int> displacements(m_size+1, 0);
+	for(int r = 0; r < m_size; ++r)
+	{
+		displacements[r+1] = displacements[r] + counts[r];
+	}
+
+	std::vector<std::int64_t> sizes(displacements[m_size]);
+	MPI_Allgatherv(localSizes.data(), localCount, MPI_INT64_T, sizes.data(), counts.data(), displacements.data(), MPI_INT64_T, m_comm);
+
+	LatticeCompression::Header header = LatticeCompression::header(m_xRange, m_yRange, m_zRange, m_lattice.dx(), mode, tolerance,
+																   static_cast<std::int64_t>(sizes.size()/2));
+
+	// The chunks of lower ranks come first.
+	MPI_Offset offset = sizeof(header) + sizes.size()*sizeof(std::int64_t);
+	for(int n = 1; n < displacements[m_rank]; n += 2)
+	{
+		offset += sizes[n];
+	}
+
+	MPI_File file;
+	MPI_File_open(m_comm, fileName.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+	MPI_File_set_size(file, 0);
+
+	if(0 == m_rank)
+	{
+		MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+		MPI_File_write_at(file, sizeof(header), sizes.data(), static_cast<int>(sizes.size()), MPI_INT64_T, MPI_STATUS_IGNORE);
+	}
+
+	// Write in pieces so counts stay within the range of an int.
+	const std::size_t piece = std::size_t(1) << 30;
+	for(const LatticeCompression::Chunk &chunk : chunks)
+	{
+		for(std::size_t written = 0; written < chunk.bytes.size(); written += piece)
+		{
+			int count = static_cast<int>(std::min(piece, chunk.bytes.size() - written));
+			MPI_File_write_at(file, offset + written, const_cast<unsigned char*>(chunk.bytes.data() + written), count, MPI_BYTE, MPI_STATUS_IGNORE);
+		}
+		offset += chunk.bytes.size();
+	}
+
+	MPI_File_close(&file);
+}
+
+DerivedQuantities::Result MpiLattice::derivedQuantities(const DerivedQuantities &quantities) const
+{
+	// Each slab only sums the faces it owns so the totals are just the sums over the ranks.
+	DerivedQuantities::Result result = quantities.compute(m_lattice);
+	if(quantities.empty())
+	{
+		return result;
+	}
+
+	MPI_Allreduce(MPI_IN_PLACE, &result.energy, 1, MPI_DOUBLE, MPI_SUM, m_comm);
+	MPI_Allreduce(MPI_IN_PLACE, result.fluxes.data(), static_cast<int>(result.fluxes.size()), MPI_DOUBLE, MPI_SUM, m_comm);
+	MPI_Allreduce(MPI_IN_PLACE, result.charges.data(), static_cast<int>(result.charges.size()), MPI_DOUBLE, MPI_SUM, m_comm);
+
+	return result;
+}
+
+#endif /* POISSON_MPI */
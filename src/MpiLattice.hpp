@@ -0,0 +1,186 @@
+#ifndef MpiLattice_hpp
+#define MpiLattice_hpp
+#ifdef POISSON_MPI
+#include <mpi.h>
+#include <random>
+#include <string>
+#include "PoissonLattice.hpp"
+#include "DerivedQuantities.hpp"
+#include "LatticeCompression.hpp"
+
+/**
+ *\file
+ *\class MpiLattice
+ *\brief PoissonLattice distributed across MPI ranks in slabs of z planes.
+ *
+ * Each rank only ever allocates the planes it owns plus a halo plane either side, so the global lattice
+ * never has to fit in the memory of a single node. The halos are exchanged with the neighbouring ranks at
+ * the end of each sweep and the convergence measure is summed over all ranks, so every rank sees the same
+ * value and stops after the same number of iterations. Only available when compiled with POISSON_MPI.
+ */
+class MpiLattice
+{
+private:
+	/// Communicator the lattice is distributed over.
+	MPI_Comm m_comm;
+
+	/// Rank of this process in the communicator.
+	int m_rank;
+
+	/// Number of ranks in the communicator.
+	int m_size;
+
+	/// Range of x-values of the global lattice.
+	int m_xRange;
+
+	/// Range of y-values of the global lattice.
+	int m_yRange;
+
+	/// Range of z-values of the global lattice.
+	int m_zRange;
+
+	/// First global z plane owned by this rank.
+	int m_kBegin;
+
+	/// One past the last global z plane owned by this rank.
+	int m_kEnd;
+
+	/// The planes owned by this rank and their halo.
+	PoissonLattice m_lattice;
+
+	/// Second copy of the slab for the Jacobi algorithm to update into.
+	PoissonLattice m_updatedLattice;
+
+	/**
+	 *\brief gets the first global z plane owned by a rank, planes are shared out as evenly as possible.
+	 *\param zRange range of z-values of the global lattice.
+	 *\param size number of ranks.
+	 *\param rank rank to get the first plane of.
+	 *\return first global z plane owned by the rank.
+	 */
+	static int firstPlane(int zRange, int size, int rank);
+
+	/**
+	 *\brief swaps the halo planes of the current slab with the neighbouring ranks.
+	 */
+	void exchangeHalos();
+
+public:
+	/**
+	 *\brief Constructs this rank's slab of a global lattice of the specified size, permittivity and step size.
+	 *\param xRange range of x values in the global lattice.
+	 *\param yRange range of y values in the global lattice.
+	 *\param zRange range of z values in the global lattice, at least the number of ranks plus two.
+	 *\param permittivity permittivity in Poisson equation.
+	 *\param dx spatial discretisation step size.
+	 *\param comm communicator to distribute the lattice over.
+	 */
+	MpiLattice(int xRange, int yRange, int zRange, double permittivity, double dx, MPI_Comm comm);
+
+	/**
+	 *\brief Initialises the non-boundary entries owned by this rank with a value and uniformly distributed noise.
+	 *\param initialValue floating point representing the initial value at each lattice site.
+	 *\param noise magnitude of random noise.
+	 *\param generator for generating the random numbers, should be seeded differently on each rank.
+	 */
+	void initialise(double initialValue, double noise, std::default_random_engine &generator);
+
+	/**
+	 *\brief sets the boundary conditions of the global lattice, a periodic z axis wraps the last rank round to the first.
+	 *\param conditions conditions on each face of the global lattice.
+	 */
+	void setBoundaryConditions(const BoundaryConditions &conditions);
+
+	/**
+	 *\brief fills the halo of this rank's slab from the boundary conditions.
+	 */
+	void fillHalo();
+
+	/**
+	 *\brief holds the sites of this rank's slab inside conductors at their potential.
+	 *\param geometry conductors in the coordinates of the global lattice.
+	 */
+	void setConductors(const RegionGeometry &geometry);
+
+	/**
+	 *\brief sets the permittivity of the sites of this rank's slab inside dielectrics.
+	 *\param dielectrics regions with their permittivity, in the coordinates of the global lattice.
+	 */
+	void setPermittivity(const RegionGeometry &dielectrics);
+
+	/**
+	 *\brief sets the positions of the sites of this rank's slab.
+	 *\param spacing positions of the sites of the global lattice.
+	 */
+	void setSpacing(const GridSpacing &spacing);
+
+	/**
+	 *\brief sets a unit point charge at the centre of the global lattice on whichever rank owns it.
+	 */
+	void setPointChargeDist();
+
+	/**
+	 *\brief updates the slab with the Jacobi algorithm and exchanges the halos.
+	 *\return convergence measure summed over every rank.
+	 */
+	double jacobiUpdate();
+
+	/**
+	 *\brief does a step of Chebyshev accelerated Jacobi on the slab and exchanges the halos.
+	 *\param weight weight of the step, 1 for the first step which is a plain Jacobi sweep.
+	 *\return convergence measure summed over every rank.
+	 */
+	double chebyshevJacobiUpdate(double weight);
+
+	/**
+	 *\brief works out the spectral radius of the Jacobi iteration on the global lattice from the formula for the box.
+	 *\return the spectral radius, or zero if it has to be estimated from the sweeps.
+	 */
+	double jacobiSpectralRadius() const;
+
+	/**
+	 *\brief does a full red-black SOR sweep, exchanging the halos after each colour.
+	 *\param sorParameter floating point value representing the SOR-parameter omega.
+	 *\return convergence measure summed over every rank.
+	 */
+	double redBlackSorUpdate(double sorParameter);
+
+	/**
+	 *\brief does a full zebra line SOR sweep, exchanging the halos after each colour of lines.
+	 *\param sorParameter floating point value representing the SOR-parameter omega.
+	 *\return convergence measure summed over every rank.
+	 */
+	double lineSorUpdate(double sorParameter);
+
+	/**
+	 *\brief writes the potential of the global lattice to a file in binary with collective MPI-IO.
+	 *
+	 * The file holds xRange*yRange*zRange native doubles in the same order as PoissonLattice stores them
+	 * (x fastest, then y, then z), including the boundary. Every rank has to call this function.
+	 *
+	 *\param fileName name of the file to write.
+	 */
+	void writePotential(const std::string &fileName) const;
+
+	/**
+	 *\brief writes the potential of every rank into a single compressed file, every rank has to call it.
+	 *
+	 * Each rank compresses the same planes it writes into the binary file, and the chunks are placed one
+	 * after another in rank order so the file is the same as one written from the whole lattice.
+	 *
+	 *\param fileName name of the file to write.
+	 *\param mode mode of compression.
+	 *\param tolerance largest absolute error of lossy compression.
+	 */
+	void writeCompressed(const std::string &fileName, LatticeCompression::Mode mode, double tolerance) const;
+
+	/**
+	 *\brief sums derived quantities over every rank, every rank has to call it.
+	 *\param quantities the quantities to compute.
+	 *\return the quantities of the whole lattice, the same on every rank.
+	 */
+	DerivedQuantities::Result derivedQuantities(const DerivedQuantities &quantities) const;
+};
+
+#endif /* POISSON_MPI */
+#endif /* MpiLattice_hpp */
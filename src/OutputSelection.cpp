@@ -0,0 +1,208 @@
+#include "OutputSelection.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	/**
+	 *\brief splits a comma separated list of integers.
+	 *\param list the list.
+	 *\return the integers in order.
+	 */
+	std::vector<int> parseIndices(const std::string &list)
+	{
+		std::vector<int> indices;
+		std::istringstream stream(list);
+		std::string number;
+		while(std::getline(stream, number, ','))
+		{
+			indices.push_back(std::stoi(number));
+		}
+		return indices;
+	}
+
+	/**
+	 *\brief converts an axis name to its index.
+	 *\param name x, y or z.
+	 *\return 0, 1 or 2, or -1 if the name isn't an axis.
+	 */
+	int axisIndex(const std::string &name)
+	{
+		return 1 == name.size() && name[0] >= 'x' && name[0] <= 'z' ? name[0] - 'x' : -1;
+	}
+}
+
+OutputSelection::OutputSelection(int xRange, int yRange, int zRange): m_ranges{{xRange, yRange, zRange}}
+{
+
+}
+
+void OutputSelection::add(const std::string &specification)
+{
+	std::size_t equals = specification.find('=');
+	if(std::string::npos == equals)
+	{
+		throw std::invalid_argument("Output selection needs the form kind=parameters: " + specification);
+	}
+
+	std::string kind = specification.substr(0, equals);
+	std::string parameters = specification.substr(equals+1);
+
+	Selection selection = {specification, {{0, 0, 0}}, {{m_ranges[0]-1, m_ranges[1]-1, m_ranges[2]-1}}, 0};
+
+	if("radial" == kind)
+	{
+		selection.binWidth = std::stod(parameters);
+		if(selection.binWidth <= 0)
+		{
+			throw std::invalid_argument("Radial profile needs a positive bin width: " + specification);
+		}
+		m_selections.push_back(selection);
+		return;
+	}
+
+	std::size_t colon = parameters.find(':');
+	int axis = std::string::npos == colon ? -1 : axisIndex(parameters.substr(0, colon));
+	std::vector<int> indices = parseIndices(std::string::npos == colon ? parameters : parameters.substr(colon+1));
+
+	if("plane" == kind && axis >= 0 && 1 == indices.size())
+	{
+		selection.lower[axis] = selection.upper[axis] = indices[0];
+	}
+	else if("line" == kind && axis >= 0 && 2 == indices.size())
+	{
+		// The other two axes in xyz order take the two indices.
+		for(int other = 0, n = 0; other < 3; ++other)
+		{
+			if(other != axis)
+			{
+				selection.lower[other] = selection.upper[other] = indices[n++];
+			}
+		}
+	}
+	else if("box" == kind && std::string::npos == colon && 6 == indices.size())
+	{
+		for(int a = 0; a < 3; ++a)
+		{
+			selection.lower[a] = indices[a];
+			selection.upper[a] = indices[a+3];
+		}
+	}
+	else
+	{
+		throw std::invalid_argument("Unknown output selection: " + specification);
+	}
+
+	for(int a = 0; a < 3; ++a)
+	{
+		if(selection.lower[a] < 0 || selection.upper[a] >= m_ranges[a] || selection.lower[a] > selection.upper[a])
+		{
+			throw std::invalid_argument("Output selection is outside the lattice: " + specification);
+		}
+	}
+
+	m_selections.push_back(selection);
+}
+
+bool OutputSelection::empty() const
+{
+	return m_selections.empty();
+}
+
+void OutputSelection::write(const std::string &directory, const PoissonLattice &lattice, const ElectricField &field) const
+{
+	for(std::size_t n = 0; n < m_selections.size(); ++n)
+	{
+		const Selection &selection = m_selections[n];
+		std::ofstream output(directory + "/selection" + std::to_string(n) + ".dat");
+		output << "# " << selection.specification << '\n';
+
+		if(selection.binWidth > 0)
+		{
+			writeRadialProfile(output, lattice, field, selection.binWidth);
+		}
+		else
+		{
+			writeLattice(output, lattice, field, selection.lower, selection.upper);
+		}
+	}
+}
+
+void OutputSelection::writeRadialProfile(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field,
+										 double binWidth) const
+{
+	const int dimension = lattice.dimension();
+	const double *potential = lattice.data();
+	const double *fieldStrength = field.magnitude();
+
+	// Distances are measured from the same centre as the full output, the furthest site is a corner.
+	double centre[3];
+	double furthest = 0;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		centre[axis] = m_ranges[axis]/2;
+		furthest += centre[axis]*centre[axis];
+	}
+	const int bins = static_cast<int>(std::sqrt(furthest)/binWidth) + 1;
+
+	std::vector<long long> counts(bins, 0);
+	std::vector<double> potentialSums(bins, 0.0);
+	std::vector<double> minima(bins, std::numeric_limits<double>::max());
+	std::vector<double> maxima(bins, std::numeric_limits<double>::lowest());
+	std::vector<double> fieldSums(bins, 0.0);
+
+	#pragma omp parallel
+	{
+		std::vector<long long> localCounts(bins, 0);
+		std::vector<double> localPotentialSums(bins, 0.0);
+		std::vector<double> localMinima(bins, std::numeric_limits<double>::max());
+		std::vector<double> localMaxima(bins, std::numeric_limits<double>::lowest());
+		std::vector<double> localFieldSums(bins, 0.0);
+
+		#pragma omp for schedule(static)
+		for(int k = interiorBegin(dimension > 2); k < interiorEnd(dimension > 2, m_ranges[2]); ++k)
+		{
+			for(int j = interiorBegin(dimension > 1); j < interiorEnd(dimension > 1, m_ranges[1]); ++j)
+			{
+				for(int i = 1; i < m_ranges[0]-1; ++i)
+				{
+					const int index = lattice.index(i, j, k);
+					const double r = std::sqrt((centre[0]-i)*(centre[0]-i) + (centre[1]-j)*(centre[1]-j) + (centre[2]-k)*(centre[2]-k));
+					const int bin = std::min(bins-1, static_cast<int>(r/binWidth));
+
+					++localCounts[bin];
+					localPotentialSums[bin] += potential[index];
+					localMinima[bin] = std::min(localMinima[bin], potential[index]);
+					localMaxima[bin] = std::max(localMaxima[bin], potential[index]);
+					localFieldSums[bin] += fieldStrength[index];
+				}
+			}
+		}
+
+		#pragma omp critical
+		{
+			for(int b = 0; b < bins; ++b)
+			{
+				counts[b] += localCounts[b];
+				potentialSums[b] += localPotentialSums[b];
+				minima[b] = std::min(minima[b], localMinima[b]);
+				maxima[b] = std::max(maxima[b], localMaxima[b]);
+				fieldSums[b] += localFieldSums[b];
+			}
+		}
+	}
+
+	out << "# r sites phi-mean phi-min phi-max E-mean\n";
+	for(int b = 0; b < bins; ++b)
+	{
+		if(counts[b] > 0)
+		{
+			out << (b + 0.5)*binWidth << ' ' << counts[b] << ' ' << potentialSums[b]/counts[b] << ' ' << minima[b] << ' '
+				<< maxima[b] << ' ' << fieldSums[b]/counts[b] << '\n';
+		}
+	}
+}
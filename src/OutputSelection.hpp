@@ -0,0 +1,94 @@
+#ifndef OutputSelection_hpp
+#define OutputSelection_hpp
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "PoissonLattice.hpp"
+#include "ElectricField.hpp"
+
+/**
+ *\file
+ *\class OutputSelection
+ *\brief Parts of a solved lattice to write out instead of every site.
+ *
+ * Planes through an index, line probes along an axis and sub-boxes are all boxes of sites, and are written
+ * in the same nine column layout as the full output, so the same plotting scripts read them. A radial
+ * profile bins the interior sites by their distance from the centre of the lattice, in the same units as
+ * the radial column of the full output, and writes the number of sites, the mean, minimum and maximum
+ * potential and the mean field strength of each bin.
+ */
+class OutputSelection
+{
+private:
+	/**
+	 *\struct Selection
+	 *\brief One selected part of the lattice.
+	 */
+	struct Selection
+	{
+		/// Specification the selection was made from, written at the top of its file.
+		std::string specification;
+
+		/// Lowest x, y and z indices of a box.
+		std::array<int,3> lower;
+
+		/// Highest x, y and z indices of a box, inclusive.
+		std::array<int,3> upper;
+
+		/// Width of the bins of a radial profile, zero for a box.
+		double binWidth;
+	};
+
+	/// Ranges of the lattice along each axis.
+	std::array<int,3> m_ranges;
+
+	/// Selections in the order they were added.
+	std::vector<Selection> m_selections;
+
+	/**
+	 *\brief writes the binned radial profile of a lattice.
+	 *\param out stream to write to.
+	 *\param lattice lattice to take the profile of.
+	 *\param field electric field of the lattice.
+	 *\param binWidth width of the bins.
+	 */
+	void writeRadialProfile(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field, double binWidth) const;
+
+public:
+	/**
+	 *\brief Constructs an empty selection for a lattice.
+	 *\param xRange range of x values.
+	 *\param yRange range of y values.
+	 *\param zRange range of z values.
+	 */
+	OutputSelection(int xRange, int yRange, int zRange);
+
+	/**
+	 *\brief adds a selection from a command line specification of the form kind=parameters.
+	 *
+	 * plane=axis:index is the plane through index along the axis, e.g. plane=z:50. line=axis:a,b is the line
+	 * along the axis through the other two coordinates in xyz order, e.g. line=x:50,50 is the x axis through
+	 * y=50 and z=50. box=x0,y0,z0,x1,y1,z1 is a box of sites, inclusive. radial=width is the radial profile
+	 * with bins of the given width.
+	 *
+	 *\param specification the specification, throws std::invalid_argument if it can't be parsed or is outside the lattice.
+	 */
+	void add(const std::string &specification);
+
+	/**
+	 *\brief checks whether anything is selected.
+	 *\return whether there are no selections.
+	 */
+	bool empty() const;
+
+	/**
+	 *\brief writes selection n into selection<n>.dat.
+	 *\param directory directory to write the files into.
+	 *\param lattice solved lattice.
+	 *\param field electric field of the lattice.
+	 */
+	void write(const std::string &directory, const PoissonLattice &lattice, const ElectricField &field) const;
+};
+
+#endif /* OutputSelection_hpp */
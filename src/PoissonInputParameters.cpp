@@ -19,6 +19,26 @@ std::ostream& operator<<(std::ostream& out, const PoissonInputParameters& params
             out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "SOR-parameter: " << std::right << params.sorParameter <<'\n';
             break;
 
+        case PoissonInputParameters::RedBlackSOR:
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Solution-method: " << std::right << "Red-Black-SOR" <<'\n';
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "SOR-parameter: " << std::right << params.sorParameter <<'\n';
+            break;
+
+        case PoissonInputParameters::ChebyshevJacobi:
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Solution-method: " << std::right << "Chebyshev-Jacobi" <<'\n';
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Spectral-radius: " << std::right << params.spectralRadius <<'\n';
+            break;
+
+        case PoissonInputParameters::SSOR:
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Solution-method: " << std::right << "SSOR" <<'\n';
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "SOR-parameter: " << std::right << params.sorParameter <<'\n';
+            break;
+
+        case PoissonInputParameters::LineSOR:
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Solution-method: " << std::right << "Line-SOR" <<'\n';
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "SOR-parameter: " << std::right << params.sorParameter <<'\n';
+            break;
+
         default:
             break;
 
@@ -28,9 +48,58 @@ std::ostream& operator<<(std::ostream& out, const PoissonInputParameters& params
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Initial-value: " << std::right << params.initialValue << '\n';
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Initial-noise: " << std::right << params.noise << '\n';
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Convergence-precision: " << std::right << params.precision<< '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Maximum-iterations: " << std::right << params.maxIterations << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Domain-dimension: " << std::right << params.dimension << '\n';
 	out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Domain-x-range: " << std::right << params.xRange<< '\n';
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Domain-y-range: " << std::right << params.yRange << '\n';
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Domain-z-range: " << std::right << params.zRange << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Threads: " << std::right << params.threads << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Memory-placement: " << std::right << params.memoryPlacement << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Huge-pages: " << std::right << params.hugePages << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Lattice-padding: " << std::right << params.latticePadding << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Thread-affinity: " << std::right << params.threadAffinity << '\n';
+    out << params.spacing;
+    out << params.boundaryConditions;
+    for(const std::string &conductor : params.conductors)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Conductor: " << std::right << conductor << '\n';
+    }
+    for(const std::string &dielectric : params.dielectrics)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Dielectric: " << std::right << dielectric << '\n';
+    }
+    if(params.amrLevels > 0)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "AMR-levels: " << std::right << params.amrLevels << '\n';
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "AMR-block-size: " << std::right << params.amrBlockSize << '\n';
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "AMR-threshold: " << std::right << params.amrThreshold << '\n';
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "AMR-buffer: " << std::right << params.amrBuffer << '\n';
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "AMR-cycles: " << std::right << params.amrCycles << '\n';
+    }
+    if(params.energy)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Energy: " << std::right << "yes" << '\n';
+    }
+    for(const std::string &box : params.fluxBoxes)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Flux-box: " << std::right << box << '\n';
+    }
+    if(params.capacitance)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Capacitance: " << std::right << "yes" << '\n';
+    }
+    for(const std::string &selection : params.selections)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Output-selection: " << std::right << selection << '\n';
+    }
+    if("none" != params.compression)
+    {
+        out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Compression: " << std::right << params.compression << '\n';
+        if("lossy" == params.compression)
+        {
+            out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Compression-tolerance: " << std::right << params.compressionTolerance << '\n';
+        }
+    }
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Output-directory: " << std::right << params.outputName << '\n';
     return out;
 }
@@ -2,6 +2,10 @@
 #define PoissonInputParameters_hpp
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <vector>
+#include "BoundaryConditions.hpp"
+#include "GridSpacing.hpp"
 /**
  *\file
  *\class PoissonInputParameters
@@ -16,13 +20,17 @@ class PoissonInputParameters
 public:
 
     /**
-     *\enum to hold the three solution methods we will consider when solving the Poisson equation
+     *\enum to hold the solution methods we will consider when solving the Poisson equation
      */
     enum SolutionMethod
     {
         Jacobi,
         GaussSeidel,
-        SOR
+        SOR,
+        RedBlackSOR,
+        ChebyshevJacobi,
+        SSOR,
+        LineSOR
     };
 
 
@@ -44,6 +52,12 @@ public:
     /// Precision of the final answer in terms of convergence.
     double precision;
 
+    /// Maximum number of sweeps before giving up, zero for no limit.
+    int maxIterations;
+
+    /// Number of dimensions of the lattice domain, 1, 2 or 3.
+    int dimension;
+
     /// Range of x-values lattice domain.
     int xRange;
 
@@ -59,6 +73,69 @@ public:
     /// Successive over relaxation parameter.
     double sorParameter;
 
+    /// Spectral radius of the Jacobi iteration for Chebyshev acceleration, zero to work it out.
+    double spectralRadius;
+
+    /// Number of threads, and hence lattice slabs, used by the parallel solution methods.
+    int threads;
+
+    /// Placement of the lattice memory on the NUMA nodes: first-touch, interleaved or single-node.
+    std::string memoryPlacement;
+
+    /// Huge pages backing the lattice memory: none, transparent or explicit.
+    std::string hugePages;
+
+    /// Padding of the lattice rows and planes: none or x,y.
+    std::string latticePadding;
+
+    /// Pinning of the worker threads to CPUs: none, compact or scatter.
+    std::string threadAffinity;
+
+    /// Conditions on each face of the domain.
+    BoundaryConditions boundaryConditions;
+
+    /// Specifications of the conductors held at fixed potentials inside the domain.
+    std::vector<std::string> conductors;
+
+    /// Specifications of the dielectric regions and their permittivity.
+    std::vector<std::string> dielectrics;
+
+    /// Positions of the sites along each axis.
+    GridSpacing spacing;
+
+    /// Number of levels of mesh refinement, zero for none.
+    int amrLevels;
+
+    /// Size in parent sites of the blocks that are refined.
+    int amrBlockSize;
+
+    /// Fraction of the maximum charge density or gradient at which sites are refined.
+    double amrThreshold;
+
+    /// Number of sites around a refined site that are also refined.
+    int amrBuffer;
+
+    /// Maximum number of cycles between the levels of refinement.
+    int amrCycles;
+
+    /// Whether to compute the electrostatic energy.
+    bool energy;
+
+    /// Boxes to compute the flux out of.
+    std::vector<std::string> fluxBoxes;
+
+    /// Whether to compute the charge and capacitance of the conductors.
+    bool capacitance;
+
+    /// Parts of the lattice to write out.
+    std::vector<std::string> selections;
+
+    /// Compression of the potential output: none, lossless or lossy.
+    std::string compression;
+
+    /// Largest absolute error of lossy compression.
+    double compressionTolerance;
+
     /**
 	 *\brief operator<< overload for outputting the results.
 	 *\param out std::ostream reference that is the stream being outputted to.
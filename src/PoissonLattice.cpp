@@ -1,14 +1,431 @@
 #include "PoissonLattice.hpp"
+#include <algorithm>
+#include "FixedSizeKernels.hpp"
+#include "ElectricField.hpp"
+#include "TextFormat.hpp"
 
-PoissonLattice::PoissonLattice(int xRange, int yRange, int zRange, double permativity, double dx): m_xRange(xRange),
-																								   m_yRange(yRange),
-																								   m_zRange(zRange),
-																								   m_permativity(permativity),
-																								   m_dx(dx),
-																								   m_chargeDensity(xRange * yRange * zRange, 0.0),
-																								   m_potential(xRange*yRange*zRange, 0.0)
+namespace
 {
+	/// Padding of the lattices constructed from now on, none until it is set.
+	PoissonLattice::Padding padding = {false, 0, 0};
 
+	/// Number of doubles in a 64 byte cache line.
+	const int cacheLineValues = 8;
+
+	/**
+	 *\brief rounds a number of values up to whole cache lines.
+	 */
+	int roundToCacheLines(int values)
+	{
+		return (values + cacheLineValues - 1)/cacheLineValues*cacheLineValues;
+	}
+
+	/**
+	 *\brief gets the x pitch of a new lattice, rows are only padded if there is more than one of them.
+	 */
+	int paddedXPitch(int xRange, int yRange, int zRange)
+	{
+		if(zRange < 2 && yRange < 2)
+		{
+			return xRange;
+		}
+		return padding.alignRows ? roundToCacheLines(xRange) + roundToCacheLines(padding.x) : xRange + padding.x;
+	}
+
+	/**
+	 *\brief gets the y pitch of a new lattice, planes are only padded if there is more than one of them.
+	 */
+	int paddedYPitch(int yRange, int zRange)
+	{
+		return zRange > 1 ? yRange + padding.y : yRange;
+	}
+}
+
+PoissonLattice::Padding PoissonLattice::defaultPadding()
+{
+	return padding;
+}
+
+void PoissonLattice::setDefaultPadding(const Padding &newPadding)
+{
+	padding = newPadding;
+}
+
+std::size_t PoissonLattice::paddedSize(int xRange, int yRange, int zRange)
+{
+	return static_cast<std::size_t>(paddedXPitch(xRange, yRange, zRange))*paddedYPitch(yRange, zRange)*zRange;
+}
+
+PoissonLattice::PoissonLattice(int xRange, int yRange, int zRange, double permativity, double dx, int layerOffset): m_xRange(xRange),
+																									   m_yRange(yRange),
+																									   m_zRange(zRange),
+																									   m_xPitch(paddedXPitch(xRange, yRange, zRange)),
+																									   m_yPitch(paddedYPitch(yRange, zRange)),
+																									   m_permativity(permativity),
+																									   m_dx(dx),
+																									   m_dimension(zRange > 1 ? 3 : (yRange > 1 ? 2 : 1)),
+																									   m_layerOffset(layerOffset),
+																									   m_chargeDensity(storageSize()),
+																									   m_potential(storageSize()),
+																									   m_lowLayerIsBoundary(true),
+																									   m_highLayerIsBoundary(true)
+{
+	// The buffers are left untouched on allocation so write the zeros from the threads that own each layer.
+	#pragma omp parallel for schedule(static)
+	for(int n = 0; n < layers(); ++n)
+	{
+		std::fill(m_chargeDensity.begin() + n*layerSize(), m_chargeDensity.begin() + (n+1)*layerSize(), 0.0);
+		std::fill(m_potential.begin() + n*layerSize(), m_potential.begin() + (n+1)*layerSize(), 0.0);
+	}
+}
+
+PoissonLattice::PoissonLattice(const PoissonLattice &lattice, int begin, int end): m_xRange(lattice.m_dimension == 1 ? end - begin + 2 : lattice.m_xRange),
+																				   m_yRange(lattice.m_dimension == 2 ? end - begin + 2 : lattice.m_yRange),
+																				   m_zRange(lattice.m_dimension == 3 ? end - begin + 2 : lattice.m_zRange),
+																				   m_xPitch(lattice.m_dimension == 1 ? m_xRange : lattice.m_xPitch),
+																				   m_yPitch(lattice.m_dimension == 2 ? m_yRange : lattice.m_yPitch),
+																				   m_permativity(lattice.m_permativity),
+																				   m_dx(lattice.m_dx),
+																				   m_dimension(lattice.m_dimension),
+																				   m_layerOffset(lattice.m_layerOffset + begin - 1),
+																				   m_chargeDensity(lattice.m_chargeDensity.begin() + (begin-1)*lattice.layerSize(),
+																								   lattice.m_chargeDensity.begin() + (end+1)*lattice.layerSize()),
+																				   m_potential(lattice.m_potential.begin() + (begin-1)*lattice.layerSize(),
+																							   lattice.m_potential.begin() + (end+1)*lattice.layerSize()),
+																				   m_boundaryConditions(lattice.m_boundaryConditions),
+																				   m_lowLayerIsBoundary(lattice.m_lowLayerIsBoundary && 1 == begin),
+																				   m_highLayerIsBoundary(lattice.m_highLayerIsBoundary && lattice.layers()-1 == end)
+{
+	if(lattice.hasConductors())
+	{
+		m_fixed.assign(lattice.m_fixed.begin() + (begin-1)*lattice.layerSize(), lattice.m_fixed.begin() + (end+1)*lattice.layerSize());
+		buildFreeSpans();
+	}
+
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		if(!lattice.m_faces[axis].empty())
+		{
+			m_faces[axis].assign(lattice.m_faces[axis].begin() + (begin-1)*lattice.layerSize(),
+								 lattice.m_faces[axis].begin() + (end+1)*lattice.layerSize());
+		}
+
+		// Only the outermost axis is cut down to the layers of the slab.
+		if(!lattice.m_positions[axis].empty())
+		{
+			int first = lattice.m_dimension-1 == axis ? begin-1 : 0;
+			int last = lattice.m_dimension-1 == axis ? end+1 : static_cast<int>(lattice.m_positions[axis].size());
+			m_positions[axis].assign(lattice.m_positions[axis].begin() + first, lattice.m_positions[axis].begin() + last);
+		}
+	}
+
+	if(hasVariableCoefficients())
+	{
+		buildAxisWeights();
+	}
+}
+
+double PoissonLattice::chargeFactor() const
+{
+	// With face coefficients the spacing and permittivity are in the weights of the neighbours instead.
+	return hasVariableCoefficients() ? 1.0 : std::pow(m_dx,2)/m_permativity;
+}
+
+double PoissonLattice::spacing(int axis, int n) const
+{
+	return m_positions[axis].empty() ? m_dx : m_positions[axis][n+1] - m_positions[axis][n];
+}
+
+void PoissonLattice::buildAxisWeights()
+{
+	const int ranges[3] = {m_xRange, m_yRange, m_zRange};
+	for(int axis = 0; axis < m_dimension; ++axis)
+	{
+		m_lowerWeights[axis].assign(ranges[axis], 0.0);
+		m_upperWeights[axis].assign(ranges[axis], 0.0);
+
+		// Only interior sites are relaxed so the halo keeps weights of zero.
+		for(int n = 1; n < ranges[axis]-1; ++n)
+		{
+			double below = spacing(axis, n-1);
+			double above = spacing(axis, n);
+			double mean = (below + above)/2;
+
+			m_lowerWeights[axis][n] = 1/(below*mean);
+			m_upperWeights[axis][n] = 1/(above*mean);
+		}
+	}
+}
+
+void PoissonLattice::setBoundaryConditions(const BoundaryConditions &conditions, bool lowLayerIsBoundary,
+										   bool highLayerIsBoundary)
+{
+	m_boundaryConditions = conditions;
+	m_lowLayerIsBoundary = lowLayerIsBoundary;
+	m_highLayerIsBoundary = highLayerIsBoundary;
+	fillHalo();
+}
+
+const BoundaryConditions& PoissonLattice::boundaryConditions() const
+{
+	return m_boundaryConditions;
+}
+
+void PoissonLattice::fillHalo()
+{
+	std::array<int,3> ranges = {m_xRange, m_yRange, m_zRange};
+
+	// Distance from the halo to the first interior site at each face, for the Neumann conditions.
+	std::array<double,6> faceSpacings = {m_dx, m_dx, m_dx, m_dx, m_dx, m_dx};
+	for(int axis = 0; axis < m_dimension; ++axis)
+	{
+		faceSpacings[2*axis] = spacing(axis, 0);
+		faceSpacings[2*axis+1] = spacing(axis, ranges[axis]-2);
+	}
+
+	std::array<std::ptrdiff_t,3> strides = {1, m_xPitch, static_cast<std::ptrdiff_t>(planeSize())};
+	m_boundaryConditions.apply(m_potential.data(), ranges, strides, m_dimension, faceSpacings, m_lowLayerIsBoundary, m_highLayerIsBoundary);
+}
+
+void PoissonLattice::setConductors(const RegionGeometry &geometry)
+{
+	if(geometry.empty())
+	{
+		return;
+	}
+
+	m_fixed.assign(m_potential.size(), 0);
+
+	// Only interior sites can be fixed, the halo already belongs to the boundary conditions.
+	#pragma omp parallel for schedule(static)
+	for(int k = interiorBegin(m_dimension > 2); k < interiorEnd(m_dimension > 2, m_zRange); ++k)
+	{
+		for(int j = interiorBegin(m_dimension > 1); j < interiorEnd(m_dimension > 1, m_yRange); ++j)
+		{
+			for(int i = 1; i < m_xRange-1; ++i)
+			{
+				// The geometry is in global coordinates so shift the outermost axis by the layer offset.
+				double potential;
+				if(geometry.contains(i + (1 == m_dimension ? m_layerOffset : 0),
+									 j + (2 == m_dimension ? m_layerOffset : 0),
+									 k + (3 == m_dimension ? m_layerOffset : 0), potential))
+				{
+					m_fixed[index(i, j, k)] = 1;
+					(*this)(i,j,k) = potential;
+				}
+			}
+		}
+	}
+
+	buildFreeSpans();
+}
+
+void PoissonLattice::setPermittivity(const RegionGeometry &dielectrics)
+{
+	if(dielectrics.empty())
+	{
+		return;
+	}
+
+	// Permittivity of every site including the halo, the background outside the dielectrics.
+	LatticeVector permittivity(m_potential.size());
+	bool uniform = true;
+	for(int k = 0; k < m_zRange; ++k)
+	{
+		for(int j = 0; j < m_yRange; ++j)
+		{
+			for(int i = 0; i < m_xRange; ++i)
+			{
+				// The geometry is in global coordinates so shift the outermost axis by the layer offset.
+				double value = m_permativity;
+				dielectrics.contains(i + (1 == m_dimension ? m_layerOffset : 0), j + (2 == m_dimension ? m_layerOffset : 0),
+									 k + (3 == m_dimension ? m_layerOffset : 0), value);
+
+				permittivity[index(i, j, k)] = value;
+				uniform = uniform && value == permittivity[0];
+			}
+		}
+	}
+
+	// A uniform permittivity keeps the fast constant coefficient kernels, unless the spacing needs face coefficients.
+	if(uniform)
+	{
+		m_permativity = permittivity[0];
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			std::fill(m_faces[axis].begin(), m_faces[axis].end(), m_permativity);
+		}
+		return;
+	}
+
+	// The face between two sites takes the harmonic mean of their permittivities, which keeps the flux
+	// across an interface continuous.
+	const int strides[3] = {1, m_xPitch, planeSize()};
+	for(int axis = 0; axis < m_dimension; ++axis)
+	{
+		m_faces[axis].assign(m_potential.size(), 0.0);
+		for(int k = 0; k < m_zRange; ++k)
+		{
+			for(int j = 0; j < m_yRange; ++j)
+			{
+				for(int i = 0; i < m_xRange; ++i)
+				{
+					const int site[3] = {i, j, k};
+					int n = index(i, j, k);
+
+					// Sites in the first layer along the axis have no face below them.
+					if(site[axis] < 1)
+					{
+						continue;
+					}
+
+					double below = permittivity[n - strides[axis]];
+					double above = permittivity[n];
+					m_faces[axis][n] = 2*below*above/(below + above);
+				}
+			}
+		}
+	}
+
+	buildAxisWeights();
+}
+
+void PoissonLattice::setSpacing(const GridSpacing &spacing)
+{
+	if(spacing.uniform())
+	{
+		return;
+	}
+
+	// The positions are global so the outermost axis of a slab starts at its layer offset.
+	const int ranges[3] = {m_xRange, m_yRange, m_zRange};
+	for(int axis = 0; axis < m_dimension; ++axis)
+	{
+		int first = m_dimension-1 == axis ? m_layerOffset : 0;
+		m_positions[axis].assign(spacing.positions(axis).begin() + first, spacing.positions(axis).begin() + first + ranges[axis]);
+	}
+
+	// The non-uniform stencil needs face coefficients even if the permittivity is the same everywhere.
+	if(!hasVariableCoefficients())
+	{
+		for(int axis = 0; axis < m_dimension; ++axis)
+		{
+			m_faces[axis].assign(m_potential.size(), m_permativity);
+		}
+	}
+
+	buildAxisWeights();
+}
+
+
+
+bool PoissonLattice::hasVariableCoefficients() const
+{
+	return !m_faces[0].empty();
+}
+
+bool PoissonLattice::hasConductors() const
+{
+	return !m_fixed.empty();
+}
+
+double PoissonLattice::jacobiSpectralRadius(const std::array<int,3> &ranges, int dimension, const BoundaryConditions &conditions)
+{
+	double radius = 0;
+	for(int axis = 0; axis < dimension; ++axis)
+	{
+		// Count the faces holding the potential, external faces are given by the parent lattice.
+		int fixedFaces = 0;
+		for(int side = 0; side < 2; ++side)
+		{
+			BoundaryConditions::Type type = conditions[static_cast<BoundaryConditions::Face>(2*axis + side)].type;
+			if(BoundaryConditions::Dirichlet == type || BoundaryConditions::External == type)
+			{
+				++fixedFaces;
+			}
+		}
+
+		if(conditions.periodic(axis) || 0 == fixedFaces)
+		{
+			radius += 1;
+		}
+		else
+		{
+			radius += std::cos(M_PI/(2 == fixedFaces ? ranges[axis] - 1 : 2*ranges[axis] - 3));
+		}
+	}
+
+	radius /= dimension;
+	return radius < 1 ? radius : 0;
+}
+
+double PoissonLattice::jacobiSpectralRadius() const
+{
+	return jacobiSpectralRadius({{m_xRange, m_yRange, m_zRange}}, m_dimension, m_boundaryConditions);
+}
+
+double PoissonLattice::facePermittivity(int axis, int index) const
+{
+	return m_faces[axis].empty() ? m_permativity : m_faces[axis][index];
+}
+
+bool PoissonLattice::lowLayerIsBoundary() const
+{
+	return m_lowLayerIsBoundary;
+}
+
+bool PoissonLattice::highLayerIsBoundary() const
+{
+	return m_highLayerIsBoundary;
+}
+
+bool PoissonLattice::isFixed(int i, int j, int k) const
+{
+	return hasConductors() && m_fixed[index(i, j, k)];
+}
+
+void PoissonLattice::buildFreeSpans()
+{
+	m_spanOffsets.assign(m_yRange*m_zRange + 1, 0);
+	m_freeSpans.clear();
+
+	for(int k = 0; k < m_zRange; ++k)
+	{
+		for(int j = 0; j < m_yRange; ++j)
+		{
+			int row = j + k*m_yRange;
+			m_spanOffsets[row] = static_cast<int>(m_freeSpans.size());
+
+			// Halo rows have no free sites.
+			bool interior = k >= interiorBegin(m_dimension > 2) && k < interiorEnd(m_dimension > 2, m_zRange)
+						 && j >= interiorBegin(m_dimension > 1) && j < interiorEnd(m_dimension > 1, m_yRange);
+			if(!interior)
+			{
+				continue;
+			}
+
+			// Start a span at the first free site after a fixed one and end it at the next fixed site.
+			const unsigned char *fixed = &m_fixed[index(0, j, k)];
+			for(int i = 1; i < m_xRange-1; ++i)
+			{
+				if(!fixed[i] && (1 == i || fixed[i-1]))
+				{
+					m_freeSpans.push_back(RowSpan{i, i+1});
+				}
+				else if(!fixed[i])
+				{
+					++m_freeSpans.back().end;
+				}
+			}
+		}
+	}
+
+	m_spanOffsets[m_yRange*m_zRange] = static_cast<int>(m_freeSpans.size());
+}
+
+MaskedRows PoissonLattice::freeRows() const
+{
+	return MaskedRows{m_spanOffsets.data(), m_freeSpans.data(), m_yRange};
 }
 
 void PoissonLattice::initialise(double initialValue, double noise, std::default_random_engine &generator)
@@ -16,12 +433,17 @@ void PoissonLattice::initialise(double initialValue, double noise, std::default_
 	// Create the uniform distribution for generating the random numbers.
 	std::uniform_real_distribution<double> noiseDistribution(-noise, noise);
 	// Only update from 1 to range-1 since boundaries should be fixed by initial conditions.
-	for(int k = 1; k < m_zRange-1; ++k)
+	for(int k = interiorBegin(m_dimension > 2); k < interiorEnd(m_dimension > 2, m_zRange); ++k)
 	{
-		for(int j = 1; j < m_yRange-1; ++j)
+		for(int j = interiorBegin(m_dimension > 1); j < interiorEnd(m_dimension > 1, m_yRange); ++j)
 		{
 			for(int i = 1; i < m_xRange-1; ++i )
 			{
+				// Conductors keep their fixed potential.
+				if(hasConductors() && m_fixed[index(i, j, k)])
+				{
+					continue;
+				}
 				(*this)(i,j,k) = initialValue + noiseDistribution(generator);
 			}
 		}
@@ -31,136 +453,449 @@ void PoissonLattice::initialise(double initialValue, double noise, std::default_
 
 double& PoissonLattice::operator()(int i, int j, int k)
 {
-	return m_potential[i + j*m_xRange + k*m_xRange*m_yRange];
+	return m_potential[index(i, j, k)];
 }
 
 const double& PoissonLattice::operator()(int i, int j, int k) const
 {
-	return m_potential[i + j*m_xRange + k*m_xRange*m_yRange];
+	return m_potential[index(i, j, k)];
 }
 
-double PoissonLattice::getChargeDensity(int i, int j, int k) const
+int PoissonLattice::xRange() const
 {
-	return m_chargeDensity[i + j*m_xRange + k*m_xRange*m_yRange];
+	return m_xRange;
 }
 
+int PoissonLattice::yRange() const
+{
+	return m_yRange;
+}
 
-void PoissonLattice::setChargeDensity(int i, int j, int k, double charge)
+int PoissonLattice::zRange() const
 {
-	m_chargeDensity[i + j*m_xRange + k*m_xRange*m_yRange] = charge;
+	return m_zRange;
 }
 
-double PoissonLattice::nextValueJacobi(int i, int j, int k) const
+int PoissonLattice::xPitch() const
 {
-	return (((*this)(i+1,j,k) + (*this)(i-1,j,k)
-		         + (*this)(i,j+1,k) + (*this)(i,j-1,k)
-		         + (*this)(i,j,k+1) + (*this)(i,j,k-1) + (std::pow(m_dx,2)/m_permativity) * getChargeDensity(i,j,k))/6.0);
+	return m_xPitch;
+}
 
+int PoissonLattice::yPitch() const
+{
+	return m_yPitch;
 }
 
+int PoissonLattice::index(int i, int j, int k) const
+{
+	return i + j*m_xPitch + k*m_xPitch*m_yPitch;
+}
 
-double jacobiUpdate(PoissonLattice &currentLattice, PoissonLattice &updatedLattice)
+std::size_t PoissonLattice::storageSize() const
 {
-	double convergenceMeasure = 0;
+	return static_cast<std::size_t>(m_xPitch)*m_yPitch*m_zRange;
+}
 
-	// Only need to check from 1 to range-1 since bounaries are fixed.
-	for(int i = 1; i < currentLattice.m_xRange-1; ++i)
+bool PoissonLattice::padded() const
+{
+	return m_xPitch != m_xRange || m_yPitch != m_yRange;
+}
+
+void PoissonLattice::packPlanes(const double *values, double *dense, int first, int last) const
+{
+	#pragma omp parallel for schedule(static)
+	for(int k = first; k < last; ++k)
 	{
-		for(int j = 1; j < currentLattice.m_yRange-1; ++j)
+		for(int j = 0; j < m_yRange; ++j)
 		{
-			for(int k = 1; k < currentLattice.m_zRange-1; ++k)
-			{
-				updatedLattice(i,j,k) = currentLattice.nextValueJacobi(i,j,k);
-
-				convergenceMeasure += std::abs(updatedLattice(i,j,k)-currentLattice(i,j,k));
+			const double *row = values + index(0, j, k);
+			std::copy(row, row + m_xRange, dense + (static_cast<std::size_t>(k - first)*m_yRange + j)*m_xRange);
+		}
+	}
+}
 
-			}
+void PoissonLattice::unpackPlanes(const double *dense, double *values, int first, int last) const
+{
+	#pragma omp parallel for schedule(static)
+	for(int k = first; k < last; ++k)
+	{
+		for(int j = 0; j < m_yRange; ++j)
+		{
+			const double *row = dense + (static_cast<std::size_t>(k - first)*m_yRange + j)*m_xRange;
+			std::copy(row, row + m_xRange, values + index(0, j, k));
 		}
 	}
+}
 
-	return convergenceMeasure;
+int PoissonLattice::dimension() const
+{
+	return m_dimension;
+}
 
+int PoissonLattice::layers() const
+{
+	return 3 == m_dimension ? m_zRange : (2 == m_dimension ? m_yRange : m_xRange);
 }
 
-double gaussSeidelUpdate(PoissonLattice &lattice)
+int PoissonLattice::layerSize() const
 {
-	double convergenceMeasure = 0;
+	return 3 == m_dimension ? m_xPitch*m_yPitch : (2 == m_dimension ? m_xPitch : 1);
+}
 
-	double updatedValue = 0;
-	double currentValue = 0;
+int PoissonLattice::layerOffset() const
+{
+	return m_layerOffset;
+}
 
-	// Only update from 1 to range-1 since boundaries should be fixed by initial conditions.
-	for(int i = 1; i < lattice.m_xRange-1; ++i)
+double PoissonLattice::permittivity() const
+{
+	return m_permativity;
+}
+
+double PoissonLattice::dx() const
+{
+	return m_dx;
+}
+
+double* PoissonLattice::layer(int n)
+{
+	return &m_potential[n*layerSize()];
+}
+
+const double* PoissonLattice::layer(int n) const
+{
+	return &m_potential[n*layerSize()];
+}
+
+int PoissonLattice::planeSize() const
+{
+	return m_xPitch*m_yPitch;
+}
+
+double* PoissonLattice::data()
+{
+	return m_potential.data();
+}
+
+const double* PoissonLattice::data() const
+{
+	return m_potential.data();
+}
+
+double* PoissonLattice::chargeDensityData()
+{
+	return m_chargeDensity.data();
+}
+
+const double* PoissonLattice::chargeDensityData() const
+{
+	return m_chargeDensity.data();
+}
+
+double* PoissonLattice::plane(int k)
+{
+	return &m_potential[k*planeSize()];
+}
+
+const double* PoissonLattice::plane(int k) const
+{
+	return &m_potential[k*planeSize()];
+}
+
+double PoissonLattice::getChargeDensity(int i, int j, int k) const
+{
+	return m_chargeDensity[index(i, j, k)];
+}
+
+
+void PoissonLattice::setChargeDensity(int i, int j, int k, double charge)
+{
+	m_chargeDensity[index(i, j, k)] = charge;
+}
+
+namespace
+{
+	/// Next value of a single site, run by PoissonLattice::dispatch with the right coefficients.
+	struct SiteRelaxation
 	{
-		for(int j = 1; j < lattice.m_yRange-1; ++j)
+		const double *site;
+		double charge;
+		int index;
+		int i;
+		int j;
+		int k;
+		int yStride;
+		int zStride;
+		double chargeFactor;
+
+		template<int Dimension, typename Rows, typename Coefficients>
+		double run(const Rows &, const Coefficients &coefficients) const
 		{
-			for(int k = 1; k < lattice.m_zRange-1; ++k)
-			{
-
-				updatedValue = lattice.nextValueJacobi(i,j,k);
+			return coefficients.relax(site, charge, index, i, j, k, yStride, zStride, chargeFactor);
+		}
+	};
 
-				currentValue = lattice(i,j,k);
+	/// Jacobi sweep from one lattice into another, run by PoissonLattice::dispatch with the right policies.
+	template<typename Update>
+	struct JacobiSweep
+	{
+		DynamicExtents extents;
+		int zRange;
+		const double *current;
+		double *updated;
+		const double *chargeDensity;
+		double chargeFactor;
+		Update update;
+
+		template<int Dimension, typename Rows, typename Coefficients>
+		double run(const Rows &rows, const Coefficients &coefficients) const
+		{
+			return jacobiSweep<Dimension>(extents, zRange, current, updated, chargeDensity, chargeFactor, rows, coefficients, update);
+		}
+	};
+
+	/**
+	 *\brief finds the active axes of a lattice that wrap round.
+	 *\param conditions conditions on the faces of the lattice.
+	 *\param dimension dimension of the lattice.
+	 *\return whether each of the x, y and z axes is periodic.
+	 */
+	std::array<bool,3> periodicAxes(const BoundaryConditions &conditions, int dimension)
+	{
+		return {{dimension > 0 && conditions.periodic(0), dimension > 1 && conditions.periodic(1), dimension > 2 && conditions.periodic(2)}};
+	}
 
-				convergenceMeasure += std::abs(updatedValue-currentValue);
+	/// Lexicographic SOR sweep in place.
+	struct SorSweep
+	{
+		DynamicExtents extents;
+		int zRange;
+		double *potential;
+		const double *chargeDensity;
+		double chargeFactor;
+		double sorParameter;
+		bool backward;
+		std::array<bool,3> periodic;
+
+		template<int Dimension, typename Rows, typename Coefficients>
+		double run(const Rows &rows, const Coefficients &coefficients) const
+		{
+			return sorSweep<Dimension>(extents, zRange, potential, chargeDensity, chargeFactor, sorParameter, backward, periodic,
+									   rows, coefficients);
+		}
+	};
 
-				lattice(i,j,k) = updatedValue;
+	/// Red-black SOR sweep of one colour in place.
+	struct RedBlackSweep
+	{
+		DynamicExtents extents;
+		int zRange;
+		double *potential;
+		const double *chargeDensity;
+		double chargeFactor;
+		double sorParameter;
+		int parityOffset;
+		int colour;
+
+		template<int Dimension, typename Rows, typename Coefficients>
+		double run(const Rows &rows, const Coefficients &coefficients) const
+		{
+			return redBlackSweep<Dimension>(extents, zRange, potential, chargeDensity, chargeFactor, sorParameter, parityOffset,
+											colour, rows, coefficients);
+		}
+	};
 
-			}
+	/// Line SOR sweep of one colour of lines in place.
+	struct LineSorSweep
+	{
+		DynamicExtents extents;
+		int zRange;
+		double *potential;
+		const double *chargeDensity;
+		double chargeFactor;
+		double sorParameter;
+		int parityOffset;
+		int colour;
+		bool periodic;
+
+		template<int Dimension, typename Rows, typename Coefficients>
+		double run(const Rows &rows, const Coefficients &coefficients) const
+		{
+			return lineSorSweep<Dimension>(extents, zRange, potential, chargeDensity, chargeFactor, sorParameter, parityOffset,
+										   colour, periodic, rows, coefficients);
 		}
+	};
+}
+
+template<typename Sweep>
+double PoissonLattice::dispatch(const Sweep &sweep) const
+{
+	switch(m_dimension)
+	{
+		case 1:
+			return dispatchDimension<1>(sweep);
+
+		case 2:
+			return dispatchDimension<2>(sweep);
+
+		default:
+			return dispatchDimension<3>(sweep);
 	}
+}
 
-	return convergenceMeasure;
+template<int Dimension, typename Sweep>
+double PoissonLattice::dispatchDimension(const Sweep &sweep) const
+{
+	// Sites inside conductors are left out of the spans that are swept.
+	if(hasVariableCoefficients())
+	{
+		FaceCoefficients<Dimension> coefficients = {{m_faces[0].data(), m_faces[1].data(), m_faces[2].data()},
+													{m_lowerWeights[0].data(), m_lowerWeights[1].data(), m_lowerWeights[2].data()},
+													{m_upperWeights[0].data(), m_upperWeights[1].data(), m_upperWeights[2].data()}};
+		return hasConductors() ? sweep.template run<Dimension>(freeRows(), coefficients)
+							   : sweep.template run<Dimension>(WholeRows(), coefficients);
+	}
 
+	return hasConductors() ? sweep.template run<Dimension>(freeRows(), UniformCoefficients<Dimension>())
+						   : sweep.template run<Dimension>(WholeRows(), UniformCoefficients<Dimension>());
 }
 
-double sorUpdate(double sorParameter, PoissonLattice &lattice)
+double PoissonLattice::nextValueJacobi(int i, int j, int k) const
 {
-	// Local variable to measure how much the lattice changes on this update.
-	double convergenceMeasure = 0;
+	int n = index(i, j, k);
+	SiteRelaxation relaxation = {&m_potential[n], m_chargeDensity[n], n, i, j, k, m_xPitch, planeSize(), chargeFactor()};
+	return dispatch(relaxation);
 
-	// Local variable to hold the standard GS update.
-	double updatedGSValue = 0;
+}
 
-	// Local variable to hold current value at given lattice site.
-	double currentValue = 0;
 
-	// Local variable to hold the final update value under the SOR update.
-	double updatedSORValue = 0;
+double jacobiUpdate(PoissonLattice &currentLattice, PoissonLattice &updatedLattice)
+{
+	const double *current = currentLattice.m_potential.data();
+	double *updated = updatedLattice.m_potential.data();
+	const double *chargeDensity = currentLattice.m_chargeDensity.data();
 
-	// Only update from 1 to range-1 since boundaries should be fixed by initial conditions.
-	for(int i = 1; i < lattice.m_xRange-1; ++i)
+	currentLattice.fillHalo();
+
+	// Use the kernel compiled for this size if there is one, they only sweep whole rows with a uniform permittivity.
+	if(3 == currentLattice.m_dimension && !currentLattice.hasConductors() && !currentLattice.hasVariableCoefficients())
 	{
-		for(int j = 1; j < lattice.m_yRange-1; ++j)
+		if(FixedSizeJacobiKernel kernel = fixedSizeJacobiKernel(currentLattice.m_xRange, currentLattice.m_yRange,
+																currentLattice.m_xPitch, currentLattice.m_yPitch))
 		{
-			for(int k = 1; k < lattice.m_zRange-1; ++k)
-			{
-				currentValue = lattice(i,j,k);
+			return kernel(current, updated, chargeDensity, currentLattice.m_zRange, currentLattice.chargeFactor());
+		}
+	}
 
-				updatedGSValue = lattice.nextValueJacobi(i,j,k);
+	// Only need to update from 1 to range-1 since bounaries are fixed, the kernels loop in memory order.
+	JacobiSweep<ReplaceUpdate> sweep = {DynamicExtents(currentLattice.m_xRange, currentLattice.m_yRange, currentLattice.m_xPitch, currentLattice.m_yPitch),
+										currentLattice.m_zRange,
+										current, updated, chargeDensity, currentLattice.chargeFactor(), ReplaceUpdate()};
+	return currentLattice.dispatch(sweep);
 
-				updatedSORValue = (1-sorParameter) * currentValue + sorParameter * updatedGSValue;
+}
 
-				lattice(i,j,k) = updatedSORValue;
+double chebyshevJacobiUpdate(double weight, PoissonLattice &currentLattice, PoissonLattice &updatedLattice)
+{
+	// The first step of the sequence is a plain Jacobi sweep.
+	if(1.0 == weight)
+	{
+		return jacobiUpdate(currentLattice, updatedLattice);
+	}
 
-				convergenceMeasure += std::abs(updatedSORValue-currentValue);
+	currentLattice.fillHalo();
 
-			}
+	ExtrapolatedUpdate update = {weight};
+	JacobiSweep<ExtrapolatedUpdate> sweep = {DynamicExtents(currentLattice.m_xRange, currentLattice.m_yRange,
+															currentLattice.m_xPitch, currentLattice.m_yPitch),
+											 currentLattice.m_zRange, currentLattice.m_potential.data(),
+											 updatedLattice.m_potential.data(), currentLattice.m_chargeDensity.data(),
+											 currentLattice.chargeFactor(), update};
+	return currentLattice.dispatch(sweep);
+
+}
+
+double gaussSeidelUpdate(PoissonLattice &lattice)
+{
+	// Gauss-Seidel is SOR without any over-relaxation.
+	return sorUpdate(1.0, lattice);
+
+}
+
+double sorUpdate(double sorParameter, PoissonLattice &lattice)
+{
+	lattice.fillHalo();
+
+	// Only update from 1 to range-1 since boundaries should be fixed by initial conditions.
+	SorSweep sweep = {DynamicExtents(lattice.m_xRange, lattice.m_yRange, lattice.m_xPitch, lattice.m_yPitch), lattice.m_zRange,
+					  lattice.m_potential.data(), lattice.m_chargeDensity.data(), lattice.chargeFactor(), sorParameter, false,
+					  periodicAxes(lattice.m_boundaryConditions, lattice.m_dimension)};
+	return lattice.dispatch(sweep);
+
+}
+
+double ssorUpdate(double sorParameter, PoissonLattice &lattice)
+{
+	double convergenceMeasure = sorUpdate(sorParameter, lattice);
+
+	// Neumann and periodic halos depend on the sites just updated by the forward sweep, so the backward sweep
+	// starts from the halo of the values the forward sweep wrote.
+	lattice.fillHalo();
+
+	SorSweep sweep = {DynamicExtents(lattice.m_xRange, lattice.m_yRange, lattice.m_xPitch, lattice.m_yPitch), lattice.m_zRange,
+					  lattice.m_potential.data(), lattice.m_chargeDensity.data(), lattice.chargeFactor(), sorParameter, true,
+					  periodicAxes(lattice.m_boundaryConditions, lattice.m_dimension)};
+	return convergenceMeasure + lattice.dispatch(sweep);
+
+}
+
+double redBlackSorUpdate(double sorParameter, PoissonLattice &lattice, int colour)
+{
+	double *potential = lattice.m_potential.data();
+	const double *chargeDensity = lattice.m_chargeDensity.data();
+
+	// Neumann and periodic halos depend on the sites of the other colour updated in the last half sweep.
+	lattice.fillHalo();
+
+	// Use the kernel compiled for this size if there is one, they only sweep whole rows with a uniform permittivity.
+	if(3 == lattice.m_dimension && !lattice.hasConductors() && !lattice.hasVariableCoefficients())
+	{
+		if(FixedSizeRedBlackKernel kernel = fixedSizeRedBlackKernel(lattice.m_xRange, lattice.m_yRange, lattice.m_xPitch, lattice.m_yPitch))
+		{
+			return kernel(potential, chargeDensity, lattice.m_zRange, lattice.m_layerOffset, lattice.chargeFactor(), sorParameter, colour);
 		}
 	}
 
-	return convergenceMeasure;
+	// The layer offset is the global index along the outermost axis, so adding it colours slabs consistently.
+	RedBlackSweep sweep = {DynamicExtents(lattice.m_xRange, lattice.m_yRange, lattice.m_xPitch, lattice.m_yPitch), lattice.m_zRange,
+						   potential, chargeDensity, lattice.chargeFactor(), sorParameter, lattice.m_layerOffset, colour};
+	return lattice.dispatch(sweep);
 
 }
 
+double lineSorUpdate(double sorParameter, PoissonLattice &lattice, int colour)
+{
+	// Neumann and periodic halos depend on the lines of the other colour updated in the last half sweep.
+	lattice.fillHalo();
+
+	// Lines are coloured by their global indices like the sites of red-black SOR. The outermost axis of a 1D
+	// lattice is x, so its line only wraps round within the lattice if the lattice holds both ends of it.
+	bool wholeLines = lattice.m_dimension > 1 || (lattice.m_lowLayerIsBoundary && lattice.m_highLayerIsBoundary);
+	LineSorSweep sweep = {DynamicExtents(lattice.m_xRange, lattice.m_yRange, lattice.m_xPitch, lattice.m_yPitch), lattice.m_zRange,
+						  lattice.m_potential.data(), lattice.m_chargeDensity.data(), lattice.chargeFactor(), sorParameter,
+						  lattice.m_layerOffset, colour, wholeLines && lattice.m_boundaryConditions.periodic(0)};
+	return lattice.dispatch(sweep);
 
+}
 
 
 
 std::array<double,3> PoissonLattice::electricField(int i, int j, int k) const
 {
-	 std::array<double,3> electricField = {-((*this)(i+1,j,k)-(*this)(i-1,j,k))/(2*m_dx),
-								-((*this)(i,j+1,k)-(*this)(i,j-1,k))/(2*m_dx),
-								-((*this)(i,j,k+1)-(*this)(i,j,k-1))/(2*m_dx)};
+	 // Central differences over the distance between the two neighbours, which is 2dx on a uniform grid.
+	 std::array<double,3> electricField = {-((*this)(i+1,j,k)-(*this)(i-1,j,k))/(spacing(0,i-1) + spacing(0,i)),
+								m_dimension > 1 ? -((*this)(i,j+1,k)-(*this)(i,j-1,k))/(spacing(1,j-1) + spacing(1,j)) : 0.0,
+								m_dimension > 2 ? -((*this)(i,j,k+1)-(*this)(i,j,k-1))/(spacing(2,k-1) + spacing(2,k)) : 0.0};
 
 	return electricField;
 }
@@ -168,45 +903,70 @@ std::array<double,3> PoissonLattice::electricField(int i, int j, int k) const
 
 std::ostream& operator<<(std::ostream &out, const PoissonLattice &lattice)
 {
-	// Calculate the centre of the lattice utilising integer division.
-	double xCentre = lattice.m_xRange/2;
-	double yCentre = lattice.m_yRange/2;
-	double zCentre = lattice.m_zRange/2;
+	writeLattice(out, lattice, ElectricField(lattice));
+	return out;
+}
 
+void writeLattice(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field)
+{
+	writeLattice(out, lattice, field, {{0, 0, 0}}, {{lattice.xRange()-1, lattice.yRange()-1, lattice.zRange()-1}});
+}
 
-	std::array<double,3> electricFieldTemp;
-	std::array<double,3> magneticFieldTemp;
-	for(int k = 0; k < lattice.m_zRange; ++k)
+void writeLattice(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field,
+				  const std::array<int,3> &lower, const std::array<int,3> &upper)
+{
+	// The fast formatting only reproduces a stream with default formatting.
+	if(out.precision() != 6 || out.flags() != (std::ios::dec | std::ios::skipws) || out.getloc() != std::locale::classic())
 	{
-		for(int j = 0; j < lattice.m_yRange; ++j)
-		{
-			for(int i = 0; i < lattice.m_xRange; ++i )
-			{
-				// Calculate distance of current point from centre of lattice.
-				double xDistance = xCentre - i;
-				double yDistance = yCentre - j;
-				double zDistance = zCentre - k;
-				double radialDistance = std::sqrt(xDistance*xDistance+yDistance*yDistance+zDistance*zDistance);
+		streamLattice(out, lattice, field, lower, upper);
+		return;
+	}
 
-				double fieldStrength;
+	// Format a plane at a time so the buffer stays small.
+	std::string buffer;
+	for(int k = lower[2]; k <= upper[2]; ++k)
+	{
+		TextFormat::formatLattice(buffer, lattice, field, {{lower[0], lower[1], k}}, {{upper[0], upper[1], k}});
+		out.write(buffer.data(), buffer.size());
+	}
+}
 
+void streamLattice(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field,
+				   const std::array<int,3> &lower, const std::array<int,3> &upper)
+{
+	const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
 
+	// Squared distance of each coordinate from the centre of the lattice, found by integer division.
+	std::array<std::vector<double>,3> squaredDistances;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		double centre = ranges[axis]/2;
+		squaredDistances[axis].resize(ranges[axis]);
+		for(int n = 0; n < ranges[axis]; ++n)
+		{
+			squaredDistances[axis][n] = (centre - n)*(centre - n);
+		}
+	}
 
-				if(i==0 || j==0 || k==0 || i==lattice.m_xRange-1 || j==lattice.m_yRange-1 || k==lattice.m_zRange-1)
-				{
-					electricFieldTemp = std::array<double,3>{0,0,0};
-				}
-				else
-				{
-					electricFieldTemp = lattice.electricField(i, j, k);
-				}
+	const double *potential = lattice.data();
+	const double *fieldX = field.component(0);
+	const double *fieldY = field.component(1);
+	const double *fieldZ = field.component(2);
+	const double *fieldStrength = field.magnitude();
 
-				fieldStrength = std::sqrt(electricFieldTemp[0]*electricFieldTemp[0] + electricFieldTemp[1]*electricFieldTemp[1] + electricFieldTemp[2]*electricFieldTemp[2]);
+	for(int k = lower[2]; k <= upper[2]; ++k)
+	{
+		for(int j = lower[1]; j <= upper[1]; ++j)
+		{
+			int index = lattice.index(lower[0], j, k);
+			for(int i = lower[0]; i <= upper[0]; ++i, ++index)
+			{
+				double radialDistance = std::sqrt(squaredDistances[0][i] + squaredDistances[1][j] + squaredDistances[2][k]);
 
 				out << i << ' ' << j << ' ' << k << ' ' <<
-				radialDistance << ' ' << lattice(i,j,k) <<
-				' ' << electricFieldTemp[0] << ' ' << electricFieldTemp[1] << ' ' << electricFieldTemp[2] <<
-				' ' << fieldStrength << ' ' << '\n';
+				radialDistance << ' ' << potential[index] <<
+				' ' << fieldX[index] << ' ' << fieldY[index] << ' ' << fieldZ[index] <<
+				' ' << fieldStrength[index] << ' ' << '\n';
 			}
 
 			out << '\n';
@@ -214,12 +974,8 @@ std::ostream& operator<<(std::ostream &out, const PoissonLattice &lattice)
 
 		out << '\n';
 	}
-
-	return out;
-
 }
 
-
  void PoissonLattice::setPointChargeDist()
  {
 	     // Utilise integer division to find the centre of the box.
@@ -4,6 +4,14 @@
 #include <random>
 #include <array>
 #include <iostream>
+#include <vector>
+#include "BoundaryConditions.hpp"
+#include "GridSpacing.hpp"
+#include "RegionGeometry.hpp"
+#include "LatticeAllocator.hpp"
+#include "StencilKernels.hpp"
+
+class ElectricField;
 
 /**
  *\file
@@ -11,12 +19,68 @@
  *\brief Lattice for evolving electrostatic potential according to the Poisson equation
  * with a selection of algorithms.
  *
- * 2D lattice consisting of an array of floating points which represent the values of the potential
+ * 3D lattice consisting of an array of floating points which represent the values of the potential
  * at some time t. The lattice can be evolved through computer time with a selection of algorithms to
  * converge on the correct function.
+ *
+ * A lattice with a z range of 1 is 2D and one with a y range of 1 as well is 1D. Those axes have no halo,
+ * the stencil only reaches along the remaining axes, and the lattice is cut into layers along its outermost
+ * axis (z in 3D, y in 2D and x in 1D) when it is decomposed into slabs.
+ *
+ * Rows and planes can be padded so the pitch between them is larger than the range. With power of two ranges
+ * the neighbours a row or a plane away otherwise sit a power of two bytes apart and compete for the same cache
+ * sets, and with the x pitch a whole number of 64 byte cache lines every row starts on a cache line boundary,
+ * since the buffers themselves are at least cache line aligned. Every array held in the order of the potential, such as the
+ * charge density, the conductors or the electric field, shares the padding, and the values in it are never
+ * read. By default there is no padding and the sites are stored contiguously.
+ *
+ * The halo holds the boundary conditions and is filled from them at the start of every sweep, so every
+ * update method supports the same conditions. Interior sites inside conductors are held at a fixed
+ * potential and skipped by the sweeps, which only visit the spans of free sites in each row.
  */
 class PoissonLattice
 {
+public:
+	/// Storage for values on the lattice, allocated according to the current LatticeMemory policy.
+	typedef std::vector<double, LatticeAllocator<double> > LatticeVector;
+
+	/**
+	 *\struct Padding
+	 *\brief Room left at the end of the rows and planes of lattices.
+	 */
+	struct Padding
+	{
+		/// Whether to round the x pitch up to a whole number of cache lines so every row is 64 byte aligned.
+		bool alignRows;
+
+		/// Values added to the end of each row, rounded up to whole cache lines if the rows are aligned.
+		int x;
+
+		/// Rows added to the end of each z plane.
+		int y;
+	};
+
+	/**
+	 *\brief gets the padding new lattices are laid out with.
+	 *\return the default padding.
+	 */
+	static Padding defaultPadding();
+
+	/**
+	 *\brief sets the padding every lattice constructed from now on will use, slabs keep that of their lattice.
+	 *\param padding the new default padding.
+	 */
+	static void setDefaultPadding(const Padding &padding);
+
+	/**
+	 *\brief gets the number of values each array of a new lattice of the given ranges stores with the default padding.
+	 *\param xRange range of x values.
+	 *\param yRange range of y values.
+	 *\param zRange range of z values.
+	 *\return storageSize() of such a lattice.
+	 */
+	static std::size_t paddedSize(int xRange, int yRange, int zRange);
+
 private:
 	/// range of x-values.
 	int m_xRange;
@@ -27,36 +91,245 @@ private:
 	/// Range of z-values.
 	int m_zRange;
 
+	/// Distance between the starts of consecutive rows, at least the x range.
+	int m_xPitch;
+
+	/// Number of rows between the starts of consecutive z planes, at least the y range.
+	int m_yPitch;
+
 	/// Permittivity constant.
 	double m_permativity;
 
 	/// Lattice space discretisation step size.
 	double m_dx;
 
+	/// Number of dimensions, 1, 2 or 3 depending on which ranges are 1.
+	int m_dimension;
+
+	/// Global index along the outermost axis of layer 0, non-zero when the lattice is a slab of a larger lattice.
+	int m_layerOffset;
+
 	/// Charge density for the potential.
-	std::vector<double> m_chargeDensity;
+	LatticeVector m_chargeDensity;
 
 	/// The actual potential on the lattice.
-	std::vector<double> m_potential;
+	LatticeVector m_potential;
+
+	/// Conditions the halo is filled from.
+	BoundaryConditions m_boundaryConditions;
+
+	/// Whether the first layer along the outermost axis is part of the boundary rather than a slab halo.
+	bool m_lowLayerIsBoundary;
+
+	/// Whether the last layer along the outermost axis is part of the boundary rather than a slab halo.
+	bool m_highLayerIsBoundary;
+
+	/// Non-zero for sites held at a fixed potential, empty if there are no conductors.
+	std::vector<unsigned char> m_fixed;
+
+	/// Index into m_freeSpans of the first span of each row j + k*yRange, plus one for the end.
+	std::vector<int> m_spanOffsets;
+
+	/// Spans of free interior sites in each row, swept in place of whole rows when there are conductors.
+	std::vector<RowSpan> m_freeSpans;
+
+	/// Permittivity of the face below each site along each active axis, empty when the coefficients are constant.
+	std::array<LatticeVector,3> m_faces;
+
+	/// Position of each site along each axis, empty when the spacing is dx along every axis.
+	std::array<std::vector<double>,3> m_positions;
+
+	/// Weight of the face below each site along each axis for its coordinate along the axis, 1/(h- * h) where h-
+	/// is the spacing below the site and h the mean of the spacings either side.
+	std::array<std::vector<double>,3> m_lowerWeights;
+
+	/// Weight of the face above each site along each axis for its coordinate along the axis, 1/(h+ * h).
+	std::array<std::vector<double>,3> m_upperWeights;
+
+	/**
+	 *\brief works out the face weights along each axis from the positions of the sites.
+	 */
+	void buildAxisWeights();
+
+	/**
+	 *\brief rebuilds the spans of free sites from the fixed sites.
+	 */
+	void buildFreeSpans();
+
+	/**
+	 *\brief gets the rows policy sweeping only the free sites.
+	 *\return rows policy for the kernels.
+	 */
+	MaskedRows freeRows() const;
+
+	/**
+	 *\brief runs a sweep with the rows and coefficients policies matching the lattice.
+	 *\param sweep sweep with a run<Dimension>(rows, coefficients) member.
+	 *\return result of the sweep.
+	 */
+	template<typename Sweep>
+	double dispatch(const Sweep &sweep) const;
+
+	/**
+	 *\brief runs a sweep for a lattice of known dimension, see dispatch.
+	 */
+	template<int Dimension, typename Sweep>
+	double dispatchDimension(const Sweep &sweep) const;
+
+	/**
+	 *\brief gets the factor the charge density is multiplied by in the update, dx^2/permittivity.
+	 *\return the charge factor.
+	 */
+	double chargeFactor() const;
 
 public:
 	/**
 	 *\brief Constructs a PoissonLattice of the specified size, permittivity and step size.
 	 *
 	 * The actual potential will consist of a cube where each dimension is one larger than specified, and
-	 * we will introduce a halo of sites where \phi = 0 to impose the boundary conditions.
+	 * we will introduce a halo of sites where \phi = 0 to impose the boundary conditions. The zeros are written
+	 * plane by plane in parallel so with first-touch placement each plane lands on the NUMA node of the thread
+	 * that sweeps it under a static schedule. The rows and planes are padded according to defaultPadding().
 	 *
 	 *\param xRange range of x values in lattice.
 	 *\param yRange range of y values in lattice.
-	 *\param zRange range of z values in lattice.
+	 *\param zRange range of z values in lattice, 1 for a 2D lattice.
 	 *\param permittivity permittivity in Poisson equation.
 	 *\param dx spatial discretisation step size.
+	 *\param layerOffset global index of layer 0 when the lattice is a slab of a larger, distributed lattice.
+	 *
+	 */
+	PoissonLattice(int xRange, int yRange, int zRange, double permativity, double dx, int layerOffset = 0);
+
+	/**
+	 *\brief Constructs a slab of an existing lattice consisting of the layers begin to end-1.
+	 *
+	 * The slab gets its own halo, one layer either side of the copied range, which is filled from the
+	 * parent lattice and afterwards has to be kept up to date by the owner of the slab, unless it is part of
+	 * the boundary of the parent lattice. The slab keeps the padding of the lattice, and its memory is
+	 * written by the calling thread so pages are placed on that thread's NUMA node by first touch.
 	 *
+	 *\param lattice lattice to copy the slab from.
+	 *\param begin first layer of the lattice owned by the slab, must be at least 1.
+	 *\param end one past the last layer owned by the slab, must be at most layers()-1.
 	 */
-	PoissonLattice(int xRange, int yRange, int zRange, double permativity, double dx);
+	PoissonLattice(const PoissonLattice &lattice, int begin, int end);
 
 	/**
-	 *\brief Initialises the non-boundary entries in the lattice with a value and some uniformly distributed
+	 *\brief sets the boundary conditions and fills the halo from them.
+	 *\param conditions conditions on each face of the lattice.
+	 *\param lowLayerIsBoundary false if the first layer along the outermost axis is filled by a decomposition.
+	 *\param highLayerIsBoundary false if the last layer along the outermost axis is filled by a decomposition.
+	 */
+	void setBoundaryConditions(const BoundaryConditions &conditions, bool lowLayerIsBoundary = true,
+							   bool highLayerIsBoundary = true);
+
+	/**
+	 *\brief gets the boundary conditions of the lattice.
+	 *\return conditions on each face of the lattice.
+	 */
+	const BoundaryConditions& boundaryConditions() const;
+
+	/**
+	 *\brief fills the halo from the boundary conditions, which every update does before it sweeps.
+	 */
+	void fillHalo();
+
+	/**
+	 *\brief holds the interior sites inside conductors at their potential and stops the sweeps updating them.
+	 *\param geometry conductors in the coordinates of the global lattice, a slab is offset by its layer offset.
+	 */
+	void setConductors(const RegionGeometry &geometry);
+
+	/**
+	 *\brief sets the permittivity of the sites inside dielectrics, the rest keep the permittivity of the lattice.
+	 *
+	 * The sweeps then solve div(eps grad phi) = -rho with the permittivity of each face between two sites the
+	 * harmonic mean of theirs. If the permittivity turns out to be the same everywhere the lattice keeps using
+	 * the constant coefficient kernels.
+	 *
+	 *\param dielectrics regions with their permittivity, in the coordinates of the global lattice.
+	 */
+	void setPermittivity(const RegionGeometry &dielectrics);
+
+	/**
+	 *\brief sets the positions of the sites along each axis, replacing the uniform spacing dx.
+	 *
+	 * The sweeps then use the non-uniform 7 point stencil, weighting each neighbour by the inverse of its
+	 * distance times the mean spacing around the site, and the electric field uses the local spacings.
+	 *
+	 *\param spacing positions of the sites of the global lattice, a slab is offset by its layer offset.
+	 */
+	void setSpacing(const GridSpacing &spacing);
+
+	/**
+	 *\brief checks whether the permittivity or the spacing varies over the lattice.
+	 *\return whether the sweeps use face coefficients.
+	 */
+	bool hasVariableCoefficients() const;
+
+	/**
+	 *\brief checks whether any sites are held at a fixed potential.
+	 *\return whether the lattice has conductors.
+	 */
+	bool hasConductors() const;
+
+	/**
+	 *\brief works out the spectral radius of the Jacobi iteration on a box with a uniform permittivity and spacing.
+	 *
+	 * The slowest mode along an axis of range n, with n-2 free sites, is damped by cos(pi/(n-1)) per sweep when
+	 * the potential is given on both faces, by cos(pi/(2n-3)) when one face is Neumann, and not at all when the
+	 * axis is periodic or Neumann at both ends. The update averages the neighbours along every axis, so the
+	 * radius is the mean of that over the axes.
+	 *
+	 *\param ranges range of x, y and z values of the whole lattice including the boundary.
+	 *\param dimension number of axes used.
+	 *\param conditions conditions on the faces of the whole lattice.
+	 *\return the spectral radius, or zero if it is 1 because no axis holds the potential at either end.
+	 */
+	static double jacobiSpectralRadius(const std::array<int,3> &ranges, int dimension, const BoundaryConditions &conditions);
+
+	/**
+	 *\brief works out the spectral radius of the Jacobi iteration on this lattice from the formula for the box.
+	 *
+	 * Conductors only make the iteration converge faster, so the radius of the box is an upper bound, while
+	 * dielectrics and a non-uniform spacing move it a little either way, which only slows the acceleration.
+	 *
+	 *\return the spectral radius, or zero if it has to be estimated from the sweeps.
+	 */
+	double jacobiSpectralRadius() const;
+
+	/**
+	 *\brief gets the permittivity of the face between a site and its neighbour below it along an axis.
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\param index index of the site in the same order as the potential.
+	 *\return permittivity of the face.
+	 */
+	double facePermittivity(int axis, int index) const;
+
+	/**
+	 *\brief checks whether the first layer is the halo of the whole lattice rather than a copy of a neighbouring slab.
+	 *\return whether the low layer is on the boundary.
+	 */
+	bool lowLayerIsBoundary() const;
+
+	/**
+	 *\brief checks whether the last layer is the halo of the whole lattice rather than a copy of a neighbouring slab.
+	 *\return whether the high layer is on the boundary.
+	 */
+	bool highLayerIsBoundary() const;
+
+	/**
+	 *\brief checks whether a site is held at a fixed potential by a conductor.
+	 *\param i x index.
+	 *\param j y index.
+	 *\param k z index.
+	 *\return whether the site is fixed.
+	 */
+	bool isFixed(int i, int j, int k) const;
+
+	/**
+	 *\brief Initialises the free non-boundary entries in the lattice with a value and some uniformly distributed
 	 * noise of a magnitude specified by the user.
 	 *\param initialValue floating point representing the initial value at each lattice site.
 	 *\param noise magnitude of random noise.
@@ -82,6 +355,177 @@ public:
 	 */
 	const double& operator()(int i, int j, int k) const;
 
+	/**
+	 *\brief gets the number of x values in the lattice, including the halo.
+	 *\return range of x values.
+	 */
+	int xRange() const;
+
+	/**
+	 *\brief gets the number of y values in the lattice, including the halo.
+	 *\return range of y values.
+	 */
+	int yRange() const;
+
+	/**
+	 *\brief gets the number of z planes in the lattice, including the halo.
+	 *\return number of z planes.
+	 */
+	int zRange() const;
+
+	/**
+	 *\brief gets the distance between the starts of consecutive rows, the stride of y.
+	 *\return x pitch, which is the x range unless the lattice is padded.
+	 */
+	int xPitch() const;
+
+	/**
+	 *\brief gets the number of rows between the starts of consecutive z planes.
+	 *\return y pitch, which is the y range unless the lattice is padded.
+	 */
+	int yPitch() const;
+
+	/**
+	 *\brief gets where a site is stored in the potential and every array held in the same order.
+	 *\param i x index.
+	 *\param j y index.
+	 *\param k z index.
+	 *\return index of the site.
+	 */
+	int index(int i, int j, int k) const;
+
+	/**
+	 *\brief gets the number of values stored for each array of the lattice, including any padding.
+	 *\return size of the potential.
+	 */
+	std::size_t storageSize() const;
+
+	/**
+	 *\brief checks whether the rows or planes are padded, otherwise the sites are stored contiguously.
+	 *\return whether the storage has padding.
+	 */
+	bool padded() const;
+
+	/**
+	 *\brief copies the sites of z planes of an array held in the order of the potential, leaving out the padding.
+	 *\param values array in the layout of the lattice, e.g. data() or a component of the electric field.
+	 *\param dense receives xRange*yRange values for each plane, x fastest, then y, then z.
+	 *\param first first z index.
+	 *\param last one past the last z index.
+	 */
+	void packPlanes(const double *values, double *dense, int first, int last) const;
+
+	/**
+	 *\brief copies contiguously stored z planes into an array held in the order of the potential, the reverse of packPlanes.
+	 *\param dense xRange*yRange values for each plane, x fastest, then y, then z.
+	 *\param values array in the layout of the lattice.
+	 *\param first first z index.
+	 *\param last one past the last z index.
+	 */
+	void unpackPlanes(const double *dense, double *values, int first, int last) const;
+
+	/**
+	 *\brief gets the number of dimensions of the lattice.
+	 *\return 3, or 2 if the z range is 1, or 1 if the y range is also 1.
+	 */
+	int dimension() const;
+
+	/**
+	 *\brief gets the number of layers along the outermost axis, including the halo.
+	 *\return range of the outermost axis.
+	 */
+	int layers() const;
+
+	/**
+	 *\brief gets the distance between the starts of consecutive layers, including any padding.
+	 *\return number of values in a layer.
+	 */
+	int layerSize() const;
+
+	/**
+	 *\brief gets the global index of layer 0, which is zero unless the lattice is a slab.
+	 *\return layer offset of the lattice.
+	 */
+	int layerOffset() const;
+
+	/**
+	 *\brief gets the permittivity outside any dielectrics.
+	 *\return permittivity of the lattice.
+	 */
+	double permittivity() const;
+
+	/**
+	 *\brief gets the spatial discretisation step size of the uniform grid.
+	 *\return dx.
+	 */
+	double dx() const;
+
+	/**
+	 *\brief gets the distance between a site and the next one along an axis.
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\param n index of the site along the axis.
+	 *\return the spacing.
+	 */
+	double spacing(int axis, int n) const;
+
+	/**
+	 *\brief gives access to the potential in a single layer, which spans layerSize() values.
+	 *\param n index of the layer along the outermost axis.
+	 *\return pointer to the first site of the layer.
+	 */
+	double* layer(int n);
+
+	/**
+	 *\brief gives access to the potential in a single layer (constant version).
+	 *\param n index of the layer along the outermost axis.
+	 *\return pointer to the first site of the layer.
+	 */
+	const double* layer(int n) const;
+
+	/**
+	 *\brief gets the distance between the starts of consecutive z planes, including any padding.
+	 *\return number of values in a plane.
+	 */
+	int planeSize() const;
+
+	/**
+	 *\brief gives direct access to the potential, stored with x fastest, then y, then z, site (i,j,k) at index(i,j,k).
+	 *\return pointer to the potential at site (0,0,0).
+	 */
+	double* data();
+
+	/**
+	 *\brief gives direct access to the potential (constant version).
+	 *\return pointer to the potential at site (0,0,0).
+	 */
+	const double* data() const;
+
+	/**
+	 *\brief gives direct access to the charge density, stored in the same order as the potential.
+	 *\return pointer to the charge density at site (0,0,0).
+	 */
+	double* chargeDensityData();
+
+	/**
+	 *\brief gives read only access to the charge density, stored in the same order as the potential.
+	 *\return pointer to the charge density at site (0,0,0).
+	 */
+	const double* chargeDensityData() const;
+
+	/**
+	 *\brief gives access to the potential in a single z plane, stored with x fastest and rows xPitch() apart.
+	 *\param k z index of the plane.
+	 *\return pointer to the first site of the plane.
+	 */
+	double* plane(int k);
+
+	/**
+	 *\brief gives access to the potential in a single z plane (constant version).
+	 *\param k z index of the plane.
+	 *\return pointer to the first site of the plane.
+	 */
+	const double* plane(int k) const;
+
 	/**
 	 *\brief gets the charge density at a site.
 	 *\param i x index of site.
@@ -108,6 +552,21 @@ public:
 	 */
 	friend double jacobiUpdate(PoissonLattice &currentLattice, PoissonLattice &updatedLattice);
 
+	/**
+	 *\brief a step of Jacobi relaxation with Chebyshev semi-iterative acceleration.
+	 *
+	 * The updated lattice holds the iterate before the current one and is replaced with
+	 * weight*J(current) + (1-weight)*updated, where J is the Jacobi update, so a sequence of steps with the
+	 * weights of PoissonSolver::chebyshevWeight converges much faster than plain Jacobi. A weight of 1 is a
+	 * plain Jacobi sweep, which starts the sequence.
+	 *
+	 *\param weight weight of the step, at least 1.
+	 *\param currentLattice lattice holding the current iterate.
+	 *\param updatedLattice lattice holding the previous iterate, replaced by the next one.
+	 *\return floating point representing how far the Jacobi update is from the current iterate.
+	 */
+	friend double chebyshevJacobiUpdate(double weight, PoissonLattice &currentLattice, PoissonLattice &updatedLattice);
+
 	/**
 	 *\brief updates the potential based on the GaussSeidel algorithm.
 	 *\param lattice reference to lattice to be updated.
@@ -128,7 +587,53 @@ public:
 	friend double sorUpdate(double sorParameter, PoissonLattice &lattice);
 
 	/**
-	 *\brief Calculates the next value of the potential at that site based on the Jacobi update.
+	 *\brief updates the potential with a symmetric SOR sweep, a forward SOR sweep followed by a backward one.
+	 *
+	 * The backward sweep visits the sites in the reverse order, so errors are carried across the lattice in
+	 * both directions and the iteration is symmetric, which suits it to smoothing and preconditioning. The
+	 * halo is filled again between the two sweeps, and each sweep keeps periodic halos current as it goes, so
+	 * the backward sweep sees every site as the forward sweep left it.
+	 *
+	 *\param sorParameter floating point value representing the SOR-parameter omega.
+	 *\param lattice Poisson lattice to be updated.
+	 *\return floating point representing how close old lattice was to updated one, summed over both sweeps.
+	 */
+	friend double ssorUpdate(double sorParameter, PoissonLattice &lattice);
+
+	/**
+	 *\brief updates a single colour of the lattice with the red-black ordered SOR algorithm.
+	 *
+	 * Sites are coloured by the parity of i+j+k in global coordinates, so slabs of a larger lattice
+	 * colour consistently with the lattice they were taken from. Sites of one colour only depend on
+	 * sites of the other colour, so each half sweep can be done in any order or in parallel.
+	 *
+	 *\param sorParameter floating point value representing the SOR-parameter omega.
+	 *\param lattice Poisson lattice to be updated.
+	 *\param colour 0 to update the red sites and 1 to update the black sites.
+	 *\return floating point representing how close old lattice was to updated one.
+	 */
+	friend double redBlackSorUpdate(double sorParameter, PoissonLattice &lattice, int colour);
+
+	/**
+	 *\brief updates a single colour of lines along x with line SOR.
+	 *
+	 * Each line is solved exactly given its neighbours, which removes the error along x in one go and so
+	 * converges much faster than the pointwise methods when the spacing along x is small compared to the
+	 * other axes. Lines are coloured by the parity of j+k in global coordinates, so lines of one colour only
+	 * depend on lines of the other colour and each half sweep can be done in any order or in parallel. Lines
+	 * of a lattice periodic along x are solved as cyclic systems, while the halo of Neumann faces along x is
+	 * taken from the last sweep and so lags by a half sweep.
+	 *
+	 *\param sorParameter floating point value representing the SOR-parameter omega.
+	 *\param lattice Poisson lattice to be updated.
+	 *\param colour 0 to update the red lines and 1 to update the black lines.
+	 *\return floating point representing how close old lattice was to updated one.
+	 */
+	friend double lineSorUpdate(double sorParameter, PoissonLattice &lattice, int colour);
+
+	/**
+	 *\brief Calculates the next value of the potential at that site based on the Jacobi update, using the
+	 * 7, 5 or 3 point stencil depending on the dimension of the lattice.
 	 *\param i x index.
 	 *\param j y index.
 	 *\param k z index.
@@ -138,7 +643,8 @@ public:
 
 
 	/**
-	 *\brief Calculates the electric field based on the electrostatic equation E = -\grad(\phi).
+	 *\brief Calculates the electric field based on the electrostatic equation E = -\grad(\phi), the
+	 * components along axes beyond the dimension of the lattice are zero.
 	 *\param i x coordinate of point.
 	 *\param j y coordinate of point.
 	 *\param k z coordinate of point.
@@ -151,7 +657,7 @@ public:
 	 *\brief operator overload to print various pieces of data into a single file for efficiency
 	 *
 	 * Will print to file in the form x y z r \phi E where x y z are coordinates r is their magnitude \phi is
-	 * the solution at that point and E is the electric field.
+	 * the solution at that point and E is the electric field, which is worked out for the whole lattice first.
 	 *
 	 *\param out output stream reference to stream to.
 	 *\param lattice Poisson lattice to print from.
@@ -167,4 +673,46 @@ public:
 
 };
 
+// Declarations of the update functions at namespace scope so they can also be called from classes that
+// have member functions of the same name.
+double jacobiUpdate(PoissonLattice &currentLattice, PoissonLattice &updatedLattice);
+double chebyshevJacobiUpdate(double weight, PoissonLattice &currentLattice, PoissonLattice &updatedLattice);
+double gaussSeidelUpdate(PoissonLattice &lattice);
+double sorUpdate(double sorParameter, PoissonLattice &lattice);
+double ssorUpdate(double sorParameter, PoissonLattice &lattice);
+double redBlackSorUpdate(double sorParameter, PoissonLattice &lattice, int colour);
+double lineSorUpdate(double sorParameter, PoissonLattice &lattice, int colour);
+
+/**
+ *\brief prints a lattice in the same form as operator<< with an electric field that has already been worked out.
+ *\param out output stream reference to stream to.
+ *\param lattice Poisson lattice to print from.
+ *\param field electric field of the lattice.
+ */
+void writeLattice(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field);
+
+/**
+ *\brief prints the sites of a box of a lattice in the same form as operator<<.
+ *\param out output stream reference to stream to.
+ *\param lattice Poisson lattice to print from.
+ *\param field electric field of the lattice.
+ *\param lower lowest x, y and z indices to print.
+ *\param upper highest x, y and z indices to print, inclusive.
+ */
+void writeLattice(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field,
+				  const std::array<int,3> &lower, const std::array<int,3> &upper);
+
+/**
+ *\brief prints the sites of a box of a lattice like writeLattice, but through the stream's own formatting
+ * of each value, so it honours the precision and flags of the stream. writeLattice falls back to it for
+ * streams without default formatting.
+ *\param out output stream reference to stream to.
+ *\param lattice Poisson lattice to print from.
+ *\param field electric field of the lattice.
+ *\param lower lowest x, y and z indices to print.
+ *\param upper highest x, y and z indices to print, inclusive.
+ */
+void streamLattice(std::ostream &out, const PoissonLattice &lattice, const ElectricField &field,
+				   const std::array<int,3> &lower, const std::array<int,3> &upper);
+
 #endif /* PoissonLattice_hpp */
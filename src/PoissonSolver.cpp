@@ -0,0 +1,215 @@
+#include "PoissonSolver.hpp"
+#include "DecomposedLattice.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	/// The estimate of the spectral radius has settled once successive ratios differ by less than this fraction.
+	const double radiusTolerance = 1e-3;
+
+	/// Fewest plain Jacobi sweeps before the estimate is taken, while the initial guess is still spreading out.
+	const int minEstimationSweeps = 50;
+
+	/// Most plain Jacobi sweeps spent on the estimate of the spectral radius.
+	const int maxEstimationSweeps = 200;
+
+	/// Largest estimate of the spectral radius, the weights no longer damp the slowest mode at a radius of 1.
+	const double maxSpectralRadius = 1 - 1e-6;
+}
+
+PoissonSolver::PoissonSolver(const Config &config): m_config(config)
+{
+
+}
+
+const PoissonSolver::Config& PoissonSolver::config() const
+{
+	return m_config;
+}
+
+double PoissonSolver::chebyshevWeight(double weight, double spectralRadius)
+{
+	double radiusSquared = spectralRadius*spectralRadius;
+	return 1.0 == weight ? 1/(1 - radiusSquared/2) : 1/(1 - radiusSquared*weight/4);
+}
+
+template<typename Update>
+PoissonSolver::Result PoissonSolver::iterate(Update update) const
+{
+	Result result = {0, 0, false};
+
+	while(true)
+	{
+		// Count the number of times we have to do an update before convergence.
+		++result.iterations;
+
+		result.convergence = update();
+
+		if(m_config.progress && m_config.progressInterval > 0 && 0 == result.iterations%m_config.progressInterval)
+		{
+			m_config.progress(result.iterations, result.convergence);
+		}
+
+		// Check to see if the lattice has converged and if it has stop updating the lattice.
+		if(result.convergence < m_config.precision)
+		{
+			result.converged = true;
+			break;
+		}
+
+		if(m_config.maxIterations > 0 && result.iterations >= m_config.maxIterations)
+		{
+			break;
+		}
+	}
+
+	return result;
+}
+
+template<typename Step>
+PoissonSolver::Result PoissonSolver::iterateChebyshev(double spectralRadius, Step step) const
+{
+	spectralRadius = std::min(spectralRadius, maxSpectralRadius);
+
+	double weight = 1;
+	double previousMeasure = 0;
+	double previousRatio = 0;
+	int estimationSweeps = 0;
+
+	return iterate([&]()
+	{
+		if(spectralRadius > 0)
+		{
+			double measure = step(weight);
+			weight = chebyshevWeight(weight, spectralRadius);
+			return measure;
+		}
+
+		// Once the slowest mode dominates, each plain Jacobi sweep shrinks the convergence measure by the spectral
+		// radius. An estimate that is a little low only slows the acceleration down, but one of 1 or more stalls it.
+		double measure = step(1.0);
+		double ratio = previousMeasure > 0 ? measure/previousMeasure : 0;
+		bool settled = ratio > 0 && ratio < 1 && std::abs(ratio - previousRatio) < radiusTolerance*ratio;
+		if(++estimationSweeps >= maxEstimationSweeps || (settled && estimationSweeps >= minEstimationSweeps))
+		{
+			// The sequence starts again from the current iterate with a plain Jacobi step.
+			spectralRadius = std::min(std::max(ratio, radiusTolerance), maxSpectralRadius);
+		}
+
+		previousMeasure = measure;
+		previousRatio = ratio;
+		return measure;
+	});
+}
+
+PoissonSolver::Result PoissonSolver::solve(PoissonLattice &lattice) const
+{
+	Result result = {0, 0, false};
+
+	switch(m_config.solutionMethod)
+	{
+		case PoissonInputParameters::Jacobi:
+			{
+				// Split the lattice into one slab per thread, each slab holds the current and updated state of its planes.
+				DecomposedLattice decomposedLattice(lattice, m_config.threads);
+
+				result = iterate([&]() { return decomposedLattice.jacobiUpdate(); });
+
+				// Collect the converged potential back into the lattice.
+				decomposedLattice.gather(lattice);
+			}
+			break;
+
+		case PoissonInputParameters::ChebyshevJacobi:
+			{
+				double spectralRadius = m_config.spectralRadius > 0 ? m_config.spectralRadius : lattice.jacobiSpectralRadius();
+
+				// The slabs are the same as for Jacobi, with the updated slabs holding the previous iterate.
+				DecomposedLattice decomposedLattice(lattice, m_config.threads);
+
+				result = iterateChebyshev(spectralRadius, [&](double weight) { return decomposedLattice.chebyshevJacobiUpdate(weight); });
+
+				// Collect the converged potential back into the lattice.
+				decomposedLattice.gather(lattice);
+			}
+			break;
+
+		case PoissonInputParameters::GaussSeidel:
+			result = iterate([&]() { return gaussSeidelUpdate(lattice); });
+			break;
+
+		case PoissonInputParameters::SOR:
+			result = iterate([&]() { return sorUpdate(m_config.sorParameter, lattice); });
+			break;
+
+		case PoissonInputParameters::SSOR:
+			result = iterate([&]() { return ssorUpdate(m_config.sorParameter, lattice); });
+			break;
+
+		case PoissonInputParameters::LineSOR:
+			{
+				// Split the lattice into one slab per thread, the lines of one colour in every slab are independent. A
+				// 1D lattice is a single line, which split between slabs would be relaxed piecewise against lagged
+				// neighbours like block Jacobi and diverge for omega > 1, so it is solved in one piece.
+				DecomposedLattice decomposedLattice(lattice, 1 == lattice.dimension() ? 1 : m_config.threads);
+
+				result = iterate([&]() { return decomposedLattice.lineSorUpdate(m_config.sorParameter); });
+
+				// Collect the converged potential back into the lattice.
+				decomposedLattice.gather(lattice);
+			}
+			break;
+
+		case PoissonInputParameters::RedBlackSOR:
+			{
+				// Split the lattice into one slab per thread.
+				DecomposedLattice decomposedLattice(lattice, m_config.threads);
+
+				result = iterate([&]() { return decomposedLattice.redBlackSorUpdate(m_config.sorParameter); });
+
+				// Collect the converged potential back into the lattice.
+				decomposedLattice.gather(lattice);
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	// The halo is filled before each sweep, so refresh it to match the converged potential.
+	lattice.fillHalo();
+
+	return result;
+}
+
+#ifdef POISSON_MPI
+PoissonSolver::Result PoissonSolver::solve(MpiLattice &lattice) const
+{
+	Result result = {0, 0, false};
+
+	// The convergence measure is summed over every rank so they all stop on the same iteration.
+	if(PoissonInputParameters::RedBlackSOR == m_config.solutionMethod)
+	{
+		result = iterate([&]() { return lattice.redBlackSorUpdate(m_config.sorParameter); });
+	}
+	else if(PoissonInputParameters::LineSOR == m_config.solutionMethod)
+	{
+		result = iterate([&]() { return lattice.lineSorUpdate(m_config.sorParameter); });
+	}
+	else if(PoissonInputParameters::ChebyshevJacobi == m_config.solutionMethod)
+	{
+		double spectralRadius = m_config.spectralRadius > 0 ? m_config.spectralRadius : lattice.jacobiSpectralRadius();
+		result = iterateChebyshev(spectralRadius, [&](double weight) { return lattice.chebyshevJacobiUpdate(weight); });
+	}
+	else
+	{
+		result = iterate([&]() { return lattice.jacobiUpdate(); });
+	}
+
+	// The halo is filled before each sweep, so refresh it to match the converged potential.
+	lattice.fillHalo();
+
+	return result;
+}
+#endif
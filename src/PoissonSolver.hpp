@@ -0,0 +1,134 @@
+#ifndef PoissonSolver_hpp
+#define PoissonSolver_hpp
+#include <functional>
+#include "PoissonLattice.hpp"
+#include "PoissonInputParameters.hpp"
+#ifdef POISSON_MPI
+#include "MpiLattice.hpp"
+#endif
+
+/**
+ *\file
+ *\class PoissonSolver
+ *\brief Iterates a lattice with one of the relaxation methods until it has converged.
+ *
+ * This is the entry point of the solver library. The caller creates a PoissonLattice, sets its charge
+ * density, and solves it in place, so the converged potential is read straight out of the lattice with no
+ * copy being made. The same solver can be reused for any number of lattices.
+ *
+ * The Chebyshev method is Jacobi with semi-iterative acceleration: each step extrapolates from the previous
+ * iterate through the Jacobi update with a weight that depends only on the step number and the spectral
+ * radius of the Jacobi iteration, so it needs no inner products and parallelises like Jacobi while taking
+ * roughly the square root of the number of sweeps. The radius comes from the configuration, from the formula
+ * for the box, or when that has no mode held down at all is estimated from the decay of plain Jacobi sweeps.
+ */
+class PoissonSolver
+{
+public:
+	/**
+	 *\struct Config
+	 *\brief Settings of the solver.
+	 */
+	struct Config
+	{
+		/// Relaxation method used to update the lattice.
+		PoissonInputParameters::SolutionMethod solutionMethod;
+
+		/// Successive over relaxation parameter for the SOR methods.
+		double sorParameter;
+
+		/// Spectral radius of the Jacobi iteration for the Chebyshev method, zero to work it out.
+		double spectralRadius;
+
+		/// The lattice has converged once the convergence measure of a sweep drops below this.
+		double precision;
+
+		/// Number of threads, and hence lattice slabs, for the Jacobi, Chebyshev, red-black SOR and line SOR methods.
+		int threads;
+
+		/// Give up after this many sweeps even if not converged, zero for no limit.
+		int maxIterations;
+
+		/// Number of sweeps between calls to progress.
+		int progressInterval;
+
+		/// Called with the number of sweeps so far and the convergence measure, may be empty.
+		std::function<void(int, double)> progress;
+	};
+
+	/**
+	 *\struct Result
+	 *\brief Outcome of a solve.
+	 */
+	struct Result
+	{
+		/// Number of sweeps done.
+		int iterations;
+
+		/// Convergence measure of the final sweep.
+		double convergence;
+
+		/// Whether the convergence measure dropped below the precision.
+		bool converged;
+	};
+
+private:
+	/// Settings of the solver.
+	Config m_config;
+
+	/**
+	 *\brief repeatedly calls an update until converged or out of iterations, reporting progress on the way.
+	 *\param update callable doing one sweep and returning its convergence measure.
+	 *\return the outcome of the iterations.
+	 */
+	template<typename Update>
+	Result iterate(Update update) const;
+
+	/**
+	 *\brief iterates with Chebyshev accelerated Jacobi, estimating the spectral radius first if it isn't known.
+	 *\param spectralRadius spectral radius of the Jacobi iteration, zero to estimate it.
+	 *\param step callable doing a step with the weight it is passed and returning its convergence measure.
+	 *\return the outcome of the iterations, including any sweeps of the estimate.
+	 */
+	template<typename Step>
+	Result iterateChebyshev(double spectralRadius, Step step) const;
+
+public:
+	/**
+	 *\brief Constructs a solver with the specified settings.
+	 *\param config settings of the solver.
+	 */
+	explicit PoissonSolver(const Config &config);
+
+	/**
+	 *\brief gets the settings of the solver.
+	 *\return the settings.
+	 */
+	const Config& config() const;
+
+	/**
+	 *\brief gets the weight of the next step of Chebyshev accelerated Jacobi.
+	 *\param weight weight of the last step, 1 after the first step.
+	 *\param spectralRadius spectral radius of the Jacobi iteration.
+	 *\return the weight of the next step.
+	 */
+	static double chebyshevWeight(double weight, double spectralRadius);
+
+	/**
+	 *\brief solves the Poisson equation on a lattice in place.
+	 *\param lattice lattice holding the initial guess and charge density, holds the solution afterwards.
+	 *\return the outcome of the solve.
+	 */
+	Result solve(PoissonLattice &lattice) const;
+
+#ifdef POISSON_MPI
+	/**
+	 *\brief solves the Poisson equation on a lattice distributed over MPI ranks, every rank has to call it.
+	 *\param lattice this rank's part of the lattice, only Jacobi, Chebyshev, red-black SOR and line SOR are supported.
+	 *\return the outcome of the solve, which is the same on every rank.
+	 */
+	Result solve(MpiLattice &lattice) const;
+#endif
+};
+
+#endif /* PoissonSolver_hpp */
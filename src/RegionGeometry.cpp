@@ -0,0 +1,173 @@
+#include "RegionGeometry.hpp"
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+bool RegionGeometry::inside(const Shape &shape, int i, int j, int k) const
+{
+	const double *p = shape.parameters;
+	const int site[3] = {i, j, k};
+
+	switch(shape.kind)
+	{
+		case Box:
+			return i >= p[0] && j >= p[1] && k >= p[2] && i <= p[3] && j <= p[4] && k <= p[5];
+
+		case Sphere:
+			return (i-p[0])*(i-p[0]) + (j-p[1])*(j-p[1]) + (k-p[2])*(k-p[2]) <= p[3]*p[3];
+
+		case Cylinder:
+			{
+				double u = site[(shape.axis+1)%3] - p[shape.axis == 1 ? 1 : 0];
+				double v = site[(shape.axis+2)%3] - p[shape.axis == 1 ? 0 : 1];
+				int along = site[shape.axis];
+				return u*u + v*v <= p[2]*p[2] && along >= p[3] && along <= p[4];
+			}
+
+		case Voxels:
+			{
+				const VoxelGrid &grid = m_voxels[shape.voxels];
+				if(i >= grid.xRange || j >= grid.yRange || k >= grid.zRange)
+				{
+					return false;
+				}
+				return 0 != grid.sites[i + static_cast<std::size_t>(grid.xRange)*(j + static_cast<std::size_t>(grid.yRange)*k)];
+			}
+	}
+
+	return false;
+}
+
+void RegionGeometry::addBox(const int lower[3], const int upper[3], double value)
+{
+	Shape shape = {Box, {double(lower[0]), double(lower[1]), double(lower[2]), double(upper[0]), double(upper[1]), double(upper[2])},
+				   0, -1, value};
+	m_shapes.push_back(shape);
+}
+
+void RegionGeometry::addSphere(const double centre[3], double radius, double value)
+{
+	Shape shape = {Sphere, {centre[0], centre[1], centre[2], radius, 0, 0}, 0, -1, value};
+	m_shapes.push_back(shape);
+}
+
+void RegionGeometry::addCylinder(int axis, const double centre[2], double radius, int lower, int upper, double value)
+{
+	Shape shape = {Cylinder, {centre[0], centre[1], radius, double(lower), double(upper), 0}, axis, -1, value};
+	m_shapes.push_back(shape);
+}
+
+void RegionGeometry::addVoxelFile(const std::string &fileName, int xRange, int yRange, int zRange, double value)
+{
+	VoxelGrid grid = {xRange, yRange, zRange, std::vector<unsigned char>(static_cast<std::size_t>(xRange)*yRange*zRange)};
+
+	std::ifstream file(fileName, std::ios::binary);
+	file.read(reinterpret_cast<char*>(grid.sites.data()), grid.sites.size());
+	if(!file || file.peek() != std::ifstream::traits_type::eof())
+	{
+		throw std::runtime_error("Voxel file " + fileName + " can't be read or doesn't hold one byte per lattice site.");
+	}
+
+	m_voxels.push_back(std::move(grid));
+
+	Shape shape = {Voxels, {0, 0, 0, 0, 0, 0}, 0, static_cast<int>(m_voxels.size())-1, value};
+	m_shapes.push_back(shape);
+}
+
+void RegionGeometry::add(const std::string &specification, int xRange, int yRange, int zRange)
+{
+	std::size_t equals = specification.find('=');
+	if(std::string::npos == equals)
+	{
+		throw std::invalid_argument("Region needs the form shape=parameters[:value]: " + specification);
+	}
+
+	std::string kind = specification.substr(0, equals);
+	std::string parameters = specification.substr(equals+1);
+
+	// Split off the optional value, which comes after the last colon.
+	double value = 0;
+	std::size_t colon = parameters.rfind(':');
+	if(std::string::npos != colon)
+	{
+		value = std::stod(parameters.substr(colon+1));
+		parameters = parameters.substr(0, colon);
+	}
+
+	if("voxels" == kind)
+	{
+		addVoxelFile(parameters, xRange, yRange, zRange, value);
+		return;
+	}
+
+	// Every analytic shape has a comma separated list of numbers.
+	std::vector<double> values;
+	std::istringstream stream(parameters);
+	std::string number;
+	while(std::getline(stream, number, ','))
+	{
+		values.push_back(std::stod(number));
+	}
+
+	if("box" == kind && 6 == values.size())
+	{
+		int lower[3] = {int(values[0]), int(values[1]), int(values[2])};
+		int upper[3] = {int(values[3]), int(values[4]), int(values[5])};
+		addBox(lower, upper, value);
+	}
+	else if("sphere" == kind && 4 == values.size())
+	{
+		addSphere(values.data(), values[3], value);
+	}
+	else if(0 == kind.compare(0, 9, "cylinder-") && 10 == kind.size() && kind[9] >= 'x' && kind[9] <= 'z' && 5 == values.size())
+	{
+		addCylinder(kind[9] - 'x', values.data(), values[2], int(values[3]), int(values[4]), value);
+	}
+	else
+	{
+		throw std::invalid_argument("Unknown region: " + specification);
+	}
+}
+
+bool RegionGeometry::empty() const
+{
+	return m_shapes.empty();
+}
+
+bool RegionGeometry::contains(int i, int j, int k, double &value) const
+{
+	int region = find(i, j, k);
+	if(region < 0)
+	{
+		return false;
+	}
+
+	value = m_shapes[region].value;
+	return true;
+}
+
+int RegionGeometry::find(int i, int j, int k) const
+{
+	// Later shapes take precedence so search from the back.
+	for(std::size_t s = m_shapes.size(); s > 0; --s)
+	{
+		if(inside(m_shapes[s-1], i, j, k))
+		{
+			return static_cast<int>(s-1);
+		}
+	}
+
+	return -1;
+}
+
+int RegionGeometry::size() const
+{
+	return static_cast<int>(m_shapes.size());
+}
+
+double RegionGeometry::value(int region) const
+{
+	return m_shapes[region].value;
+}
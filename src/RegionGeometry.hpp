@@ -0,0 +1,178 @@
+#ifndef RegionGeometry_hpp
+#define RegionGeometry_hpp
+#include <string>
+#include <vector>
+
+/**
+ *\file
+ *\class RegionGeometry
+ *\brief Regions inside the domain, such as conductors or dielectrics, each with a value at its sites.
+ *
+ * The geometry is built up from analytic shapes (axis aligned boxes, spheres and cylinders) and voxel files,
+ * each with its own value: the potential a conductor is held at or the permittivity of a dielectric.
+ * Coordinates are lattice indices of the global lattice, including the halo, and where shapes overlap the one
+ * added last wins.
+ */
+class RegionGeometry
+{
+private:
+	/**
+	 *\enum Kind of shape.
+	 */
+	enum Kind
+	{
+		Box,
+		Sphere,
+		Cylinder,
+		Voxels
+	};
+
+	/**
+	 *\struct Shape
+	 *\brief A single shape and the value at its sites.
+	 */
+	struct Shape
+	{
+		/// Kind of shape.
+		Kind kind;
+
+		/// Box corners, sphere centre and radius, or cylinder axis centre, radius and extent along the axis.
+		double parameters[6];
+
+		/// Axis of a cylinder, 0, 1 or 2 for x, y or z.
+		int axis;
+
+		/// Index into m_voxels for a voxel file.
+		int voxels;
+
+		/// Value at the sites inside the shape.
+		double value;
+	};
+
+	/**
+	 *\struct VoxelGrid
+	 *\brief Contents of a voxel file, one byte per site of the global lattice.
+	 */
+	struct VoxelGrid
+	{
+		/// Range of x values of the grid.
+		int xRange;
+
+		/// Range of y values of the grid.
+		int yRange;
+
+		/// Range of z values of the grid.
+		int zRange;
+
+		/// Non-zero bytes mark sites inside the region, stored with x fastest, then y, then z.
+		std::vector<unsigned char> sites;
+	};
+
+	/// Shapes in the order they were added.
+	std::vector<Shape> m_shapes;
+
+	/// Contents of the voxel files.
+	std::vector<VoxelGrid> m_voxels;
+
+	/**
+	 *\brief checks whether a site is inside a shape.
+	 *\return whether the site is inside.
+	 */
+	bool inside(const Shape &shape, int i, int j, int k) const;
+
+public:
+	/**
+	 *\brief adds an axis aligned box including both corners.
+	 *\param lower lowest x, y and z indices of the box.
+	 *\param upper highest x, y and z indices of the box.
+	 *\param value value at the sites inside the box.
+	 */
+	void addBox(const int lower[3], const int upper[3], double value);
+
+	/**
+	 *\brief adds a sphere.
+	 *\param centre x, y and z indices of the centre.
+	 *\param radius radius in sites.
+	 *\param value value at the sites inside the sphere.
+	 */
+	void addSphere(const double centre[3], double radius, double value);
+
+	/**
+	 *\brief adds a cylinder along one of the axes.
+	 *\param axis 0, 1 or 2 for a cylinder along x, y or z.
+	 *\param centre indices of the axis along the other two axes, in the order x, y, z with the axis left out.
+	 *\param radius radius in sites.
+	 *\param lower lowest index along the axis.
+	 *\param upper highest index along the axis.
+	 *\param value value at the sites inside the cylinder.
+	 */
+	void addCylinder(int axis, const double centre[2], double radius, int lower, int upper, double value);
+
+	/**
+	 *\brief adds the region in a voxel file.
+	 *
+	 * The file holds one byte for every site of the global lattice including the halo, with x fastest, then y,
+	 * then z, and non-zero bytes mark sites inside the region.
+	 *
+	 *\param fileName name of the file, throws std::runtime_error if it can't be read or is the wrong size.
+	 *\param xRange range of x values of the global lattice.
+	 *\param yRange range of y values of the global lattice.
+	 *\param zRange range of z values of the global lattice.
+	 *\param value value at the sites inside the region.
+	 */
+	void addVoxelFile(const std::string &fileName, int xRange, int yRange, int zRange, double value);
+
+	/**
+	 *\brief adds a shape from a command line specification of the form shape=parameters[:value].
+	 *
+	 * The shapes are box=x0,y0,z0,x1,y1,z1, sphere=x,y,z,radius, cylinder-x=y,z,radius,x0,x1 (and likewise
+	 * cylinder-y and cylinder-z) and voxels=fileName. The value defaults to zero, for example
+	 * sphere=50,50,50,10:1 or voxels=electrode.raw:-1.
+	 *
+	 *\param specification the specification, throws std::invalid_argument if it can't be parsed.
+	 *\param xRange range of x values of the global lattice, for voxel files.
+	 *\param yRange range of y values of the global lattice, for voxel files.
+	 *\param zRange range of z values of the global lattice, for voxel files.
+	 */
+	void add(const std::string &specification, int xRange, int yRange, int zRange);
+
+	/**
+	 *\brief checks whether there are any regions.
+	 *\return whether the geometry has no shapes.
+	 */
+	bool empty() const;
+
+	/**
+	 *\brief checks whether a site of the global lattice is inside a region.
+	 *\param i x index.
+	 *\param j y index.
+	 *\param k z index.
+	 *\param value set to the value of the region if the site is inside one.
+	 *\return whether the site is inside a region.
+	 */
+	bool contains(int i, int j, int k, double &value) const;
+
+	/**
+	 *\brief finds the region a site of the global lattice is inside, later regions take precedence.
+	 *\param i x index.
+	 *\param j y index.
+	 *\param k z index.
+	 *\return index of the region in the order they were added, -1 if the site isn't inside one.
+	 */
+	int find(int i, int j, int k) const;
+
+	/**
+	 *\brief gets the number of regions.
+	 *\return number of shapes added.
+	 */
+	int size() const;
+
+	/**
+	 *\brief gets the value of a region, such as the potential of a conductor.
+	 *\param region index of the region in the order they were added.
+	 *\return value of the region.
+	 */
+	double value(int region) const;
+};
+
+#endif /* RegionGeometry_hpp */
@@ -0,0 +1,461 @@
+#include "SolverServer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ChunkedWriter.hpp"
+#include "ElectricField.hpp"
+
+namespace
+{
+	/**
+	 *\brief splits a list of numbers separated by commas.
+	 *\param list the list.
+	 *\param count number of numbers expected.
+	 *\param form form of the list for the error message.
+	 *\return the numbers, throws std::invalid_argument if there aren't count of them.
+	 */
+	std::vector<double> parseNumbers(const std::string &list, std::size_t count, const std::string &form)
+	{
+		std::vector<double> numbers;
+		std::istringstream stream(list);
+		std::string number;
+		while(std::getline(stream, number, ','))
+		{
+			numbers.push_back(std::stod(number));
+		}
+
+		if(numbers.size() != count)
+		{
+			throw std::invalid_argument("Expected " + form + ": " + list);
+		}
+		return numbers;
+	}
+
+	/**
+	 *\brief converts the name of a method used in requests to the method.
+	 *\param name jacobi, gauss-seidel, sor or red-black-sor.
+	 *\return the method, throws std::invalid_argument if the name is not recognised.
+	 */
+	PoissonInputParameters::SolutionMethod methodFromString(const std::string &name)
+	{
+		if("jacobi" == name)
+		{
+			return PoissonInputParameters::Jacobi;
+		}
+		if("gauss-seidel" == name)
+		{
+			return PoissonInputParameters::GaussSeidel;
+		}
+		if("sor" == name)
+		{
+			return PoissonInputParameters::SOR;
+		}
+		if("red-black-sor" == name)
+		{
+			return PoissonInputParameters::RedBlackSOR;
+		}
+		if("chebyshev" == name)
+		{
+			return PoissonInputParameters::ChebyshevJacobi;
+		}
+		if("ssor" == name)
+		{
+			return PoissonInputParameters::SSOR;
+		}
+		if("line-sor" == name)
+		{
+			return PoissonInputParameters::LineSOR;
+		}
+		throw std::invalid_argument("Unknown method: " + name);
+	}
+
+	/**
+	 *\brief sends bytes on a connection, without raising SIGPIPE if the client has gone.
+	 *\return whether everything was sent.
+	 */
+	bool sendAll(int connection, const char *bytes, std::size_t size)
+	{
+		while(size > 0)
+		{
+			ssize_t sent = send(connection, bytes, size, MSG_NOSIGNAL);
+			if(sent < 0)
+			{
+				if(EINTR == errno)
+				{
+					continue;
+				}
+				return false;
+			}
+			bytes += sent;
+			size -= sent;
+		}
+		return true;
+	}
+
+	/**
+	 *\brief reads the next line from a connection.
+	 *\param connection descriptor of the connection.
+	 *\param pending bytes read past the end of the previous line.
+	 *\param line set to the line without its newline.
+	 *\return false once the connection is closed.
+	 */
+	bool readLine(int connection, std::string &pending, std::string &line)
+	{
+		std::size_t end;
+		while(std::string::npos == (end = pending.find('\n')))
+		{
+			char bytes[4096];
+			ssize_t received = recv(connection, bytes, sizeof(bytes), 0);
+			if(received < 0 && EINTR == errno)
+			{
+				continue;
+			}
+			if(received <= 0)
+			{
+				return false;
+			}
+			pending.append(bytes, received);
+		}
+
+		line = pending.substr(0, end);
+		pending.erase(0, end + 1);
+		if(!line.empty() && '\r' == line.back())
+		{
+			line.pop_back();
+		}
+		return true;
+	}
+}
+
+SolverServer::Job SolverServer::parseJob(const std::string &request, int defaultThreads)
+{
+	Job job;
+	job.ranges = {{0, 0, 0}};
+	job.dx = 1;
+	job.permittivity = 1;
+	job.initialValue = 0;
+	job.pointCharge = false;
+	job.solver.solutionMethod = PoissonInputParameters::RedBlackSOR;
+	job.solver.sorParameter = 1;
+	job.solver.spectralRadius = 0;
+	job.solver.precision = 0.001;
+	job.solver.threads = defaultThreads;
+	job.solver.maxIterations = 0;
+	job.solver.progressInterval = 0;
+	job.result = "binary";
+
+	std::istringstream stream(request);
+	std::string setting;
+	while(stream >> setting)
+	{
+		std::size_t equals = setting.find('=');
+		if(std::string::npos == equals)
+		{
+			throw std::invalid_argument("Settings need the form key=value: " + setting);
+		}
+		std::string key = setting.substr(0, equals);
+		std::string value = setting.substr(equals + 1);
+
+		if("size" == key)
+		{
+			std::vector<double> ranges = parseNumbers(value, 3, "size=x,y,z");
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				job.ranges[axis] = static_cast<int>(ranges[axis]);
+			}
+		}
+		else if("dx" == key)
+		{
+			job.dx = std::stod(value);
+		}
+		else if("permittivity" == key)
+		{
+			job.permittivity = std::stod(value);
+		}
+		else if("initial" == key)
+		{
+			job.initialValue = std::stod(value);
+		}
+		else if("method" == key)
+		{
+			job.solver.solutionMethod = methodFromString(value);
+		}
+		else if("sor" == key)
+		{
+			job.solver.sorParameter = std::stod(value);
+		}
+		else if("spectral-radius" == key)
+		{
+			job.solver.spectralRadius = std::stod(value);
+		}
+		else if("precision" == key)
+		{
+			job.solver.precision = std::stod(value);
+		}
+		else if("max-iterations" == key)
+		{
+			job.solver.maxIterations = std::stoi(value);
+		}
+		else if("threads" == key)
+		{
+			job.solver.threads = std::max(1, std::stoi(value));
+		}
+		else if("boundary" == key)
+		{
+			job.boundaryConditions.set(value);
+		}
+		else if("charge" == key)
+		{
+			if("point" == value)
+			{
+				job.pointCharge = true;
+			}
+			else
+			{
+				std::vector<double> charge = parseNumbers(value, 4, "charge=i,j,k,q");
+				job.charges.push_back({{charge[0], charge[1], charge[2], charge[3]}});
+			}
+		}
+		else if("result" == key)
+		{
+			if("binary" != value && 0 != value.compare(0, 4, "raw:") && 0 != value.compare(0, 5, "text:"))
+			{
+				throw std::invalid_argument("Result needs to be binary, raw:path or text:path: " + value);
+			}
+			job.result = value;
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown setting: " + key);
+		}
+	}
+
+	// Unused axes have a single site, used ones need at least one interior site.
+	const int dimension = job.ranges[2] > 1 ? 3 : (job.ranges[1] > 1 ? 2 : 1);
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		if(axis < dimension ? job.ranges[axis] < 3 : job.ranges[axis] != 1)
+		{
+			throw std::invalid_argument("Size needs at least 3 sites along each used axis and 1 along the others.");
+		}
+	}
+
+	for(const std::array<double,4> &charge : job.charges)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			if(charge[axis] < 0 || charge[axis] >= job.ranges[axis])
+			{
+				throw std::invalid_argument("Charge outside the lattice.");
+			}
+		}
+	}
+
+	// Like the command line, a job without any charge solves for the point charge.
+	if(job.charges.empty())
+	{
+		job.pointCharge = true;
+	}
+
+	return job;
+}
+
+SolverServer::SolverServer(const Config &config) : m_config(config), m_listener(-1), m_stopping(false)
+{
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(config.socketPath.size() >= sizeof(address.sun_path))
+	{
+		throw std::runtime_error("Socket path is too long: " + config.socketPath);
+	}
+	std::strcpy(address.sun_path, config.socketPath.c_str());
+
+	m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(config.socketPath.c_str());
+	if(m_listener < 0 || bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(m_listener, 64) < 0)
+	{
+		std::string error = std::strerror(errno);
+		if(m_listener >= 0)
+		{
+			close(m_listener);
+		}
+		throw std::runtime_error("Can't listen on " + config.socketPath + ": " + error);
+	}
+}
+
+SolverServer::~SolverServer()
+{
+	close(m_listener);
+	unlink(m_config.socketPath.c_str());
+}
+
+void SolverServer::run()
+{
+	std::vector<std::thread> workers;
+	for(int n = 0; n < std::max(1, m_config.workers); ++n)
+	{
+		workers.emplace_back(&SolverServer::work, this);
+	}
+
+	while(true)
+	{
+		int connection = accept(m_listener, nullptr, nullptr);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_stopping)
+		{
+			if(connection >= 0)
+			{
+				close(connection);
+			}
+			break;
+		}
+		if(connection >= 0)
+		{
+			m_connections.push_back(connection);
+			m_ready.notify_one();
+		}
+	}
+
+	for(std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void SolverServer::stop()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stopping = true;
+
+	// Wakes the accept in run.
+	shutdown(m_listener, SHUT_RDWR);
+	m_ready.notify_all();
+}
+
+void SolverServer::work()
+{
+	// Kept from one job to the next so jobs of the same shape reuse its memory.
+	std::unique_ptr<PoissonLattice> lattice;
+
+	while(true)
+	{
+		int connection;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_ready.wait(lock, [this]{ return m_stopping || !m_connections.empty(); });
+			if(m_connections.empty())
+			{
+				return;
+			}
+			connection = m_connections.front();
+			m_connections.pop_front();
+		}
+
+		serve(connection, lattice);
+		close(connection);
+	}
+}
+
+void SolverServer::serve(int connection, std::unique_ptr<PoissonLattice> &lattice)
+{
+	const int defaultThreads = std::max(1, m_config.threads/std::max(1, m_config.workers));
+
+	std::string pending;
+	std::string request;
+	while(readLine(connection, pending, request))
+	{
+		if(request.empty())
+		{
+			continue;
+		}
+
+		if("shutdown" == request)
+		{
+			sendAll(connection, "ok\n", 3);
+			stop();
+			return;
+		}
+
+		try
+		{
+			solve(connection, parseJob(request, defaultThreads), lattice);
+		}
+		catch(const std::exception &exception)
+		{
+			std::string answer = std::string("error ") + exception.what() + '\n';
+			if(!sendAll(connection, answer.data(), answer.size()))
+			{
+				return;
+			}
+		}
+	}
+}
+
+void SolverServer::solve(int connection, const Job &job, std::unique_ptr<PoissonLattice> &lattice)
+{
+	const std::size_t sites = static_cast<std::size_t>(job.ranges[0])*job.ranges[1]*job.ranges[2];
+	if(lattice && lattice->xRange() == job.ranges[0] && lattice->yRange() == job.ranges[1] && lattice->zRange() == job.ranges[2]
+	   && lattice->dx() == job.dx && lattice->permittivity() == job.permittivity)
+	{
+		// A reused lattice still holds the last job's charges, everything else is set again below.
+		std::fill(lattice->chargeDensityData(), lattice->chargeDensityData() + lattice->storageSize(), 0.0);
+	}
+	else
+	{
+		// Free the old lattice before allocating the new one.
+		lattice.reset();
+		lattice.reset(new PoissonLattice(job.ranges[0], job.ranges[1], job.ranges[2], job.permittivity, job.dx));
+	}
+
+	std::default_random_engine generator;
+	lattice->initialise(job.initialValue, 0, generator);
+	lattice->setBoundaryConditions(job.boundaryConditions);
+	if(job.pointCharge)
+	{
+		lattice->setPointChargeDist();
+	}
+	for(const std::array<double,4> &charge : job.charges)
+	{
+		lattice->setChargeDensity(static_cast<int>(charge[0]), static_cast<int>(charge[1]), static_cast<int>(charge[2]), charge[3]);
+	}
+
+	PoissonSolver::Result result = PoissonSolver(job.solver).solve(*lattice);
+
+	bool binary = "binary" == job.result;
+	if(0 == job.result.compare(0, 4, "raw:"))
+	{
+		ChunkedWriter(job.result.substr(4)).writePlanes(*lattice, lattice->data(), 0);
+	}
+	else if(0 == job.result.compare(0, 5, "text:"))
+	{
+		ChunkedWriter(job.result.substr(5)).writeLattice(*lattice, ElectricField(*lattice));
+	}
+
+	std::ostringstream answer;
+	answer.precision(17);
+	answer << "ok iterations=" << result.iterations << " convergence=" << result.convergence << " converged=" << result.converged
+		   << " bytes=" << (binary ? sites*sizeof(double) : 0) << '\n';
+	std::string header = answer.str();
+	if(sendAll(connection, header.data(), header.size()) && binary)
+	{
+		// A padded lattice is packed first so the client always gets the sites contiguously.
+		std::vector<double> packed;
+		const double *potential = lattice->data();
+		if(lattice->padded())
+		{
+			packed.resize(sites);
+			lattice->packPlanes(lattice->data(), packed.data(), 0, lattice->zRange());
+			potential = packed.data();
+		}
+		sendAll(connection, reinterpret_cast<const char*>(potential), sites*sizeof(double));
+	}
+}
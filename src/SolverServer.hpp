@@ -0,0 +1,172 @@
+#ifndef SolverServer_hpp
+#define SolverServer_hpp
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "PoissonLattice.hpp"
+#include "PoissonSolver.hpp"
+#include "BoundaryConditions.hpp"
+
+/**
+ *\file
+ *\class SolverServer
+ *\brief Long running solver that takes jobs over a Unix domain socket and solves them on a pool of workers.
+ *
+ * Each request is one line of space separated key=value settings, and a connection may send any number of
+ * requests one after another, each answered before the next is read. Connections are queued and handed to
+ * the first free worker, and each worker keeps the lattice of its last job and reuses it for the next job
+ * of the same shape, so a stream of similar solves allocates nothing.
+ *
+ * The settings are, with their defaults:
+ *
+ *     size=x,y,z            range of the lattice including the boundary, required, 1 along unused axes
+ *     dx=1                  spatial discretisation step
+ *     permittivity=1        permittivity
+ *     initial=0             initial value of the interior
+ *     method=red-black-sor  jacobi, gauss-seidel, sor, red-black-sor, chebyshev, ssor or line-sor
+ *     sor=1                 successive over relaxation parameter
+ *     spectral-radius=0     spectral radius of the Jacobi iteration for chebyshev, zero to work it out
+ *     precision=0.001       precision of convergence
+ *     max-iterations=0      sweeps before giving up, zero for no limit
+ *     threads=              threads of the solve, by default the server's threads shared between the workers
+ *     boundary=faces=type[:value]   as --boundary, may be repeated
+ *     charge=i,j,k,q        charge density at a site, may be repeated, or charge=point for the point charge
+ *                           at the centre, which is also used when no charge is given
+ *     result=binary         binary sends the potential back, raw:path writes it to a file as raw doubles and
+ *                           text:path writes it with the field in the layout of poissonOutput.dat
+ *
+ * The answer is a line "ok iterations=n convergence=c converged=0|1 bytes=b" followed by b bytes of the
+ * whole potential including the boundary as doubles with x fastest, then y, then z, or "error message" if the
+ * job couldn't be run. The request "shutdown" stops the server once the jobs in progress have finished.
+ */
+class SolverServer
+{
+public:
+	/**
+	 *\struct Config
+	 *\brief Settings of the server.
+	 */
+	struct Config
+	{
+		/// Path of the Unix domain socket to listen on.
+		std::string socketPath;
+
+		/// Number of jobs solved at once.
+		int workers;
+
+		/// Threads shared between the workers by jobs that don't ask for a number.
+		int threads;
+	};
+
+	/**
+	 *\struct Job
+	 *\brief One parsed request.
+	 */
+	struct Job
+	{
+		/// Range of x, y and z values of the lattice.
+		std::array<int,3> ranges;
+
+		/// Spatial discretisation step.
+		double dx;
+
+		/// Permittivity.
+		double permittivity;
+
+		/// Initial value of the interior.
+		double initialValue;
+
+		/// Conditions on the faces of the lattice.
+		BoundaryConditions boundaryConditions;
+
+		/// Sites i, j and k and their charge density.
+		std::vector<std::array<double,4> > charges;
+
+		/// Whether to place the point charge at the centre.
+		bool pointCharge;
+
+		/// Settings of the solver.
+		PoissonSolver::Config solver;
+
+		/// Where the result goes, binary, raw:path or text:path.
+		std::string result;
+	};
+
+	/**
+	 *\brief parses a request.
+	 *\param request the request line.
+	 *\param defaultThreads threads of the solve if the request doesn't say.
+	 *\return the job, throws std::invalid_argument if the request can't be parsed.
+	 */
+	static Job parseJob(const std::string &request, int defaultThreads);
+
+private:
+	/// Settings of the server.
+	Config m_config;
+
+	/// Descriptor of the listening socket.
+	int m_listener;
+
+	/// Accepted connections waiting for a worker.
+	std::deque<int> m_connections;
+
+	/// Set once the server is shutting down.
+	bool m_stopping;
+
+	/// Guards the connections and the stopping flag.
+	std::mutex m_mutex;
+
+	/// Signalled when a connection is queued or the server is stopping.
+	std::condition_variable m_ready;
+
+	/**
+	 *\brief takes connections off the queue and serves them until the server stops.
+	 */
+	void work();
+
+	/**
+	 *\brief answers the requests of one connection until it closes.
+	 *\param connection descriptor of the connection.
+	 *\param lattice lattice of the worker's last job, replaced when a job has a different shape.
+	 */
+	void serve(int connection, std::unique_ptr<PoissonLattice> &lattice);
+
+	/**
+	 *\brief solves a job and sends the answer.
+	 *\param connection descriptor of the connection.
+	 *\param job the job.
+	 *\param lattice lattice of the worker's last job, replaced when the job has a different shape.
+	 */
+	void solve(int connection, const Job &job, std::unique_ptr<PoissonLattice> &lattice);
+
+	/**
+	 *\brief stops accepting connections and wakes the workers.
+	 */
+	void stop();
+
+public:
+	/**
+	 *\brief Constructs a server listening on a socket, replacing any file already at its path.
+	 *\param config settings of the server, throws std::runtime_error if the socket can't be created.
+	 */
+	explicit SolverServer(const Config &config);
+
+	/**
+	 *\brief closes the socket and removes it.
+	 */
+	~SolverServer();
+
+	SolverServer(const SolverServer&) = delete;
+	SolverServer& operator=(const SolverServer&) = delete;
+
+	/**
+	 *\brief accepts connections and serves them until a shutdown request arrives.
+	 */
+	void run();
+};
+
+#endif /* SolverServer_hpp */
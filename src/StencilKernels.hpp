@@ -0,0 +1,731 @@
+#ifndef StencilKernels_hpp
+#define StencilKernels_hpp
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+/**
+ *\file
+ *\brief Sweep kernels shared by every solution method, templated on the dimension of the lattice and on
+ * whether its extents are known at compile time.
+ *
+ * A lattice of dimension 2 has a z range of 1 and a lattice of dimension 1 also has a y range of 1. Axes
+ * beyond the dimension have no halo and are not looped over, and the stencil only reaches along the active
+ * axes: 7 points in 3D, 5 points in 2D and 3 points in 1D. The kernels work on raw pointers to site (0,0,0)
+ * and loop in memory order with x innermost, stepping between rows and planes by the pitches of the extents,
+ * which are larger than the ranges if the lattice is padded.
+ *
+ * Which sites of a row are swept is set by a rows policy. WholeRows sweeps every interior site, while
+ * MaskedRows sweeps precomputed spans of free sites so fixed sites, such as conductors, are skipped without
+ * a branch per site.
+ *
+ * The coefficients policy relaxes a site. UniformCoefficients is the plain average of the neighbours for a
+ * uniform permittivity and spacing, while FaceCoefficients weights each neighbour by the permittivity of the
+ * face between them and the spacing around it, solving div(eps grad phi) = -rho on a non-uniform grid.
+ *
+ * Line SOR solves whole lines along x at once, so the coefficients policies also split the stencil of a site
+ * into its coupling to the neighbours along x and a source from the neighbours along the other axes.
+ *
+ * The update policy of the Jacobi sweep combines the relaxed value with what the updated lattice held before.
+ * ReplaceUpdate is plain Jacobi, while ExtrapolatedUpdate is a step of Chebyshev accelerated Jacobi, for which
+ * the updated lattice holds the iterate before the current one.
+ */
+
+/**
+ *\struct Stencil
+ *\brief Sum over the nearest neighbours of a site along the active axes.
+ */
+template<int Dimension>
+struct Stencil;
+
+template<>
+struct Stencil<1>
+{
+	static double neighbourSum(const double *site, int, int)
+	{
+		return site[1] + site[-1];
+	}
+
+	static double transverseSum(const double *, int, int)
+	{
+		return 0;
+	}
+};
+
+template<>
+struct Stencil<2>
+{
+	static double neighbourSum(const double *site, int yStride, int)
+	{
+		return site[1] + site[-1] + site[yStride] + site[-yStride];
+	}
+
+	static double transverseSum(const double *site, int yStride, int)
+	{
+		return site[yStride] + site[-yStride];
+	}
+};
+
+template<>
+struct Stencil<3>
+{
+	static double neighbourSum(const double *site, int yStride, int zStride)
+	{
+		return site[1] + site[-1] + site[yStride] + site[-yStride] + site[zStride] + site[-zStride];
+	}
+
+	static double transverseSum(const double *site, int yStride, int zStride)
+	{
+		return site[yStride] + site[-yStride] + site[zStride] + site[-zStride];
+	}
+};
+
+/**
+ *\struct LineEquation
+ *\brief Equation of a site on a line along x, diagonal*x[i] - lower*x[i-1] - upper*x[i+1] = source.
+ */
+struct LineEquation
+{
+	double lower;
+	double diagonal;
+	double upper;
+	double source;
+};
+
+/**
+ *\struct UniformCoefficients
+ *\brief Coefficients policy for a uniform permittivity, chargeFactor is dx^2/permittivity.
+ */
+template<int Dimension>
+struct UniformCoefficients
+{
+	double relax(const double *site, double charge, int, int, int, int, int yStride, int zStride, double chargeFactor) const
+	{
+		return (Stencil<Dimension>::neighbourSum(site, yStride, zStride) + chargeFactor*charge)/(2.0*Dimension);
+	}
+
+	LineEquation line(const double *site, double charge, int, int, int, int, int yStride, int zStride, double chargeFactor) const
+	{
+		return LineEquation{1, 2.0*Dimension, 1, Stencil<Dimension>::transverseSum(site, yStride, zStride) + chargeFactor*charge};
+	}
+};
+
+/**
+ *\struct FaceCoefficients
+ *\brief Coefficients policy for a permittivity or spacing varying from site to site, chargeFactor is 1.
+ *
+ * m_faces[a][index] is the permittivity of the face between a site and its neighbour below it along axis a,
+ * so the face above it is at index plus the stride of the axis. The weights depend only on the coordinate
+ * along the axis, m_lowerWeights[a][n] is 1/(h- * h) with h- the spacing below the site and h the mean of
+ * the spacings either side, and likewise m_upperWeights with the spacing above.
+ */
+template<int Dimension>
+struct FaceCoefficients
+{
+	/// Face permittivities along each active axis.
+	const double *m_faces[3];
+
+	/// Weight of the face below a site along each active axis, indexed by the coordinate along the axis.
+	const double *m_lowerWeights[3];
+
+	/// Weight of the face above a site along each active axis, indexed by the coordinate along the axis.
+	const double *m_upperWeights[3];
+
+	double relax(const double *site, double charge, int index, int i, int j, int k, int yStride, int zStride,
+				 double chargeFactor) const
+	{
+		const int strides[3] = {1, yStride, zStride};
+		const int coordinates[3] = {i, j, k};
+		double weightedSum = 0;
+		double diagonal = 0;
+
+		for(int axis = 0; axis < Dimension; ++axis)
+		{
+			double below = m_faces[axis][index] * m_lowerWeights[axis][coordinates[axis]];
+			double above = m_faces[axis][index + strides[axis]] * m_upperWeights[axis][coordinates[axis]];
+
+			weightedSum += below*site[-strides[axis]] + above*site[strides[axis]];
+			diagonal += below + above;
+		}
+
+		return (weightedSum + chargeFactor*charge)/diagonal;
+	}
+
+	LineEquation line(const double *site, double charge, int index, int i, int j, int k, int yStride, int zStride,
+					  double chargeFactor) const
+	{
+		const int strides[3] = {1, yStride, zStride};
+		const int coordinates[3] = {i, j, k};
+		LineEquation equation = {m_faces[0][index] * m_lowerWeights[0][i], 0, m_faces[0][index + 1] * m_upperWeights[0][i],
+								 chargeFactor*charge};
+		equation.diagonal = equation.lower + equation.upper;
+
+		for(int axis = 1; axis < Dimension; ++axis)
+		{
+			double below = m_faces[axis][index] * m_lowerWeights[axis][coordinates[axis]];
+			double above = m_faces[axis][index + strides[axis]] * m_upperWeights[axis][coordinates[axis]];
+
+			equation.source += below*site[-strides[axis]] + above*site[strides[axis]];
+			equation.diagonal += below + above;
+		}
+
+		return equation;
+	}
+};
+
+/**
+ *\struct DynamicExtents
+ *\brief x and y ranges and pitches of a lattice known only at runtime.
+ */
+struct DynamicExtents
+{
+	/// Range of x values.
+	int m_xRange;
+
+	/// Range of y values.
+	int m_yRange;
+
+	/// Distance between the starts of consecutive rows.
+	int m_xPitch;
+
+	/// Number of rows between the starts of consecutive z planes.
+	int m_yPitch;
+
+	DynamicExtents(int xRange, int yRange, int xPitch, int yPitch) : m_xRange(xRange), m_yRange(yRange), m_xPitch(xPitch), m_yPitch(yPitch) {}
+
+	int xRange() const { return m_xRange; }
+	int yRange() const { return m_yRange; }
+	int yStride() const { return m_xPitch; }
+	int zStride() const { return m_xPitch*m_yPitch; }
+};
+
+/**
+ *\struct FixedExtents
+ *\brief x and y ranges and pitches of a lattice known at compile time, so the strides and loop bounds are constants.
+ */
+template<int XRange, int YRange, int XPitch = XRange, int YPitch = YRange>
+struct FixedExtents
+{
+	constexpr int xRange() const { return XRange; }
+	constexpr int yRange() const { return YRange; }
+	constexpr int yStride() const { return XPitch; }
+	constexpr int zStride() const { return XPitch*YPitch; }
+};
+
+/**
+ *\struct ReplaceUpdate
+ *\brief Update policy of plain Jacobi, the updated site takes the relaxed value.
+ */
+struct ReplaceUpdate
+{
+	double apply(double value, double) const { return value; }
+};
+
+/**
+ *\struct ExtrapolatedUpdate
+ *\brief Update policy of Chebyshev accelerated Jacobi, the updated site goes from the previous iterate towards the
+ * relaxed value and beyond it by the weight of the step.
+ */
+struct ExtrapolatedUpdate
+{
+	/// Weight of the relaxed value, at least 1.
+	double m_weight;
+
+	double apply(double value, double previous) const { return m_weight*value + (1 - m_weight)*previous; }
+};
+
+/**
+ *\struct RowSpan
+ *\brief Run of consecutive x indices in a row that are swept, from begin to end-1.
+ */
+struct RowSpan
+{
+	/// First x index of the run.
+	int begin;
+
+	/// One past the last x index of the run.
+	int end;
+};
+
+/**
+ *\struct WholeRows
+ *\brief Rows policy sweeping every interior site, a single span from 1 to xRange-2.
+ */
+struct WholeRows
+{
+	int spans(int, int) const { return 1; }
+	RowSpan span(int, int, int, int xRange) const { return RowSpan{1, xRange-1}; }
+};
+
+/**
+ *\struct MaskedRows
+ *\brief Rows policy sweeping the spans of free sites stored for each row, rows are indexed by j + k*yRange.
+ */
+struct MaskedRows
+{
+	/// Index into m_spans of the first span of each row, with one extra entry for the end of the last row.
+	const int *m_offsets;
+
+	/// Spans of every row in order.
+	const RowSpan *m_spans;
+
+	/// Range of y values, used to index the rows.
+	int m_yRange;
+
+	int spans(int j, int k) const { return m_offsets[j + k*m_yRange + 1] - m_offsets[j + k*m_yRange]; }
+	RowSpan span(int j, int k, int n, int) const { return m_spans[m_offsets[j + k*m_yRange] + n]; }
+};
+
+/**
+ *\brief gets the first index of the interior along an axis, the halo is only present on active axes.
+ *\param active whether the axis is one of the dimensions of the lattice.
+ *\return first interior index.
+ */
+inline int interiorBegin(bool active)
+{
+	return active ? 1 : 0;
+}
+
+/**
+ *\brief gets one past the last index of the interior along an axis.
+ *\param active whether the axis is one of the dimensions of the lattice.
+ *\param range range of the axis including the halo.
+ *\return one past the last interior index.
+ */
+inline int interiorEnd(bool active, int range)
+{
+	return active ? range-1 : 1;
+}
+
+/**
+ *\brief Jacobi sweep of the interior from current into updated.
+ *\param chargeFactor dx^2/permittivity, or 1 for FaceCoefficients, multiplying the charge density in the update.
+ *\param update combines the relaxed value of a site with the value updated held before.
+ *\return floating point representing how far the relaxed values are from the current ones.
+ */
+template<int Dimension, typename Extents, typename Rows = WholeRows, typename Coefficients = UniformCoefficients<Dimension>,
+		 typename Update = ReplaceUpdate>
+double jacobiSweep(const Extents &extents, int zRange, const double *current, double *updated,
+				   const double *chargeDensity, double chargeFactor, const Rows &rows = Rows(),
+				   const Coefficients &coefficients = Coefficients(), const Update &update = Update())
+{
+	const int yStride = extents.yStride();
+	const int zStride = extents.zStride();
+
+	double convergenceMeasure = 0;
+
+	for(int k = interiorBegin(Dimension > 2); k < interiorEnd(Dimension > 2, zRange); ++k)
+	{
+		for(int j = interiorBegin(Dimension > 1); j < interiorEnd(Dimension > 1, extents.yRange()); ++j)
+		{
+			const int row = j*yStride + k*zStride;
+			const double *site = current + row;
+			const double *charge = chargeDensity + row;
+			double *updatedSite = updated + row;
+
+			for(int n = 0; n < rows.spans(j, k); ++n)
+			{
+				const RowSpan span = rows.span(j, k, n, extents.xRange());
+
+				#pragma omp simd reduction(+:convergenceMeasure)
+				for(int i = span.begin; i < span.end; ++i)
+				{
+					double value = coefficients.relax(site + i, charge[i], row + i, i, j, k, yStride, zStride, chargeFactor);
+
+					convergenceMeasure += std::abs(value - site[i]);
+					updatedSite[i] = update.apply(value, updatedSite[i]);
+				}
+			}
+		}
+	}
+
+	return convergenceMeasure;
+}
+
+/**
+ *\brief lexicographic Gauss-Seidel sweep of the interior with successive over-relaxation.
+ *
+ * The halo of a periodic axis is a copy of the interior at the other end, filled before the sweep. The first
+ * sites visited along that axis are copied into it again as soon as they are updated, so the last sites read
+ * their wrapped neighbours from this sweep rather than the last one, as they would without a halo. Reading
+ * them lagged makes the wrap a Jacobi coupling, which diverges at large omega.
+ *
+ *\param chargeFactor dx^2/permittivity, or 1 for FaceCoefficients, multiplying the charge density in the update.
+ *\param sorParameter over-relaxation parameter, 1 for plain Gauss-Seidel.
+ *\param backward whether to sweep from the last site to the first, the second half of a symmetric SOR sweep.
+ *\param periodic whether each of the x, y and z axes is periodic.
+ *\return floating point representing how close old lattice was to updated one.
+ */
+template<int Dimension, typename Extents, typename Rows = WholeRows, typename Coefficients = UniformCoefficients<Dimension> >
+double sorSweep(const Extents &extents, int zRange, double *potential, const double *chargeDensity,
+				double chargeFactor, double sorParameter, bool backward = false,
+				const std::array<bool,3> &periodic = std::array<bool,3>(), const Rows &rows = Rows(),
+				const Coefficients &coefficients = Coefficients())
+{
+	const int yStride = extents.yStride();
+	const int zStride = extents.zStride();
+	const int kBegin = interiorBegin(Dimension > 2);
+	const int kEnd = interiorEnd(Dimension > 2, zRange);
+	const int jBegin = interiorBegin(Dimension > 1);
+	const int jEnd = interiorEnd(Dimension > 1, extents.yRange());
+	const int xRange = extents.xRange();
+
+	// First interior site, row and plane visited along each axis, and the halo at the other end that copies it.
+	const int iWrap = backward ? xRange-2 : 1;
+	const int iHalo = backward ? 0 : xRange-1;
+	const int jWrap = backward ? jEnd-1 : jBegin;
+	const int jHalo = backward ? 0 : jEnd;
+	const int kWrap = backward ? kEnd-1 : kBegin;
+	const int kHalo = backward ? 0 : kEnd;
+
+	double convergenceMeasure = 0;
+
+	// A backward sweep visits the same sites in the reverse order by reflecting each loop counter.
+	for(int kk = kBegin; kk < kEnd; ++kk)
+	{
+		const int k = backward ? kBegin + kEnd - 1 - kk : kk;
+
+		for(int jj = jBegin; jj < jEnd; ++jj)
+		{
+			const int j = backward ? jBegin + jEnd - 1 - jj : jj;
+			const int row = j*yStride + k*zStride;
+			double *site = potential + row;
+			const double *charge = chargeDensity + row;
+			const int spans = rows.spans(j, k);
+
+			for(int nn = 0; nn < spans; ++nn)
+			{
+				const RowSpan span = rows.span(j, k, backward ? spans - 1 - nn : nn, extents.xRange());
+
+				// Each site depends on the one before it so this loop can't be vectorised.
+				for(int ii = span.begin; ii < span.end; ++ii)
+				{
+					const int i = backward ? span.begin + span.end - 1 - ii : ii;
+
+					double currentValue = site[i];
+					double gsValue = coefficients.relax(site + i, charge[i], row + i, i, j, k, yStride, zStride, chargeFactor);
+					double sorValue = (1-sorParameter) * currentValue + sorParameter * gsValue;
+
+					site[i] = sorValue;
+					convergenceMeasure += std::abs(sorValue - currentValue);
+
+					if(periodic[0] && i == iWrap)
+					{
+						site[iHalo] = sorValue;
+					}
+				}
+			}
+
+			if(Dimension > 1 && periodic[1] && j == jWrap)
+			{
+				std::copy(site + 1, site + xRange-1, potential + jHalo*yStride + k*zStride + 1);
+			}
+		}
+
+		if(Dimension > 2 && periodic[2] && k == kWrap)
+		{
+			for(int j = jBegin; j < jEnd; ++j)
+			{
+				std::copy(potential + j*yStride + k*zStride + 1, potential + j*yStride + k*zStride + xRange-1,
+						  potential + j*yStride + kHalo*zStride + 1);
+			}
+		}
+	}
+
+	return convergenceMeasure;
+}
+
+/**
+ *\brief SOR sweep of the interior sites of one colour, with sites coloured by the parity of i+j+k.
+ *\param chargeFactor dx^2/permittivity, or 1 for FaceCoefficients, multiplying the charge density in the update.
+ *\param parityOffset added to i+j+k so slabs colour consistently with the lattice they were taken from.
+ *\param colour 0 to update the red sites and 1 to update the black sites.
+ *\return floating point representing how close old lattice was to updated one.
+ */
+template<int Dimension, typename Extents, typename Rows = WholeRows, typename Coefficients = UniformCoefficients<Dimension> >
+double redBlackSweep(const Extents &extents, int zRange, double *potential, const double *chargeDensity,
+					 double chargeFactor, double sorParameter, int parityOffset, int colour, const Rows &rows = Rows(),
+					 const Coefficients &coefficients = Coefficients())
+{
+	const int yStride = extents.yStride();
+	const int zStride = extents.zStride();
+
+	double convergenceMeasure = 0;
+
+	for(int k = interiorBegin(Dimension > 2); k < interiorEnd(Dimension > 2, zRange); ++k)
+	{
+		for(int j = interiorBegin(Dimension > 1); j < interiorEnd(Dimension > 1, extents.yRange()); ++j)
+		{
+			const int row = j*yStride + k*zStride;
+			double *site = potential + row;
+			const double *charge = chargeDensity + row;
+
+			for(int n = 0; n < rows.spans(j, k); ++n)
+			{
+				const RowSpan span = rows.span(j, k, n, extents.xRange());
+
+				// First site in this span with parity of i+j+k (in global coordinates) equal to the colour.
+				int iStart = span.begin + ((span.begin + j + k + parityOffset + colour) & 1);
+
+				// Sites of the same colour never neighbour each other so the updates are independent.
+				#pragma omp simd reduction(+:convergenceMeasure)
+				for(int i = iStart; i < span.end; i += 2)
+				{
+					double currentValue = site[i];
+					double gsValue = coefficients.relax(site + i, charge[i], row + i, i, j, k, yStride, zStride, chargeFactor);
+					double sorValue = (1-sorParameter) * currentValue + sorParameter * gsValue;
+
+					site[i] = sorValue;
+					convergenceMeasure += std::abs(sorValue - currentValue);
+				}
+			}
+		}
+	}
+
+	return convergenceMeasure;
+}
+
+/// Number of lines solved together by lineSorSweep, with the elimination vectorised across them.
+const int lineLanes = 8;
+
+/**
+ *\brief zebra line SOR sweep of the lines along x of one colour, with lines coloured by the parity of j+k.
+ *
+ * Each line is solved exactly with the Thomas algorithm for the current values of the lines around it and
+ * the halo at its ends, and the solution is over-relaxed. Lines of one colour don't neighbour each other, so
+ * lineLanes of them are eliminated at once with the sites stored lane innermost and the loops over the lanes
+ * vectorised. Sites outside the free spans of the rows policy are held at their value by the trivial equation
+ * x[i] = value, so every line is the whole interior of its row.
+ *
+ * A periodic line couples its first and last sites, which makes the system cyclic tridiagonal. The corners
+ * are taken out as a rank one update, the tridiagonal remainder is solved for the source and for the update
+ * vector at once, and the two solutions are combined with the Sherman-Morrison formula.
+ *
+ *\param chargeFactor dx^2/permittivity, or 1 for FaceCoefficients, multiplying the charge density in the update.
+ *\param sorParameter over-relaxation parameter, 1 for plain line Gauss-Seidel.
+ *\param parityOffset added to j+k so slabs colour consistently with the lattice they were taken from.
+ *\param colour 0 to update the red lines and 1 to update the black lines.
+ *\param periodic whether the lines wrap round, the halo at each end being a copy of the site at the other end.
+ *\return floating point representing how close old lattice was to updated one.
+ */
+template<int Dimension, typename Extents, typename Rows = WholeRows, typename Coefficients = UniformCoefficients<Dimension> >
+double lineSorSweep(const Extents &extents, int zRange, double *potential, const double *chargeDensity,
+					double chargeFactor, double sorParameter, int parityOffset, int colour, bool periodic,
+					const Rows &rows = Rows(), const Coefficients &coefficients = Coefficients())
+{
+	const int yStride = extents.yStride();
+	const int zStride = extents.zStride();
+	const int xRange = extents.xRange();
+	const int jBegin = interiorBegin(Dimension > 1);
+	const int jEnd = interiorEnd(Dimension > 1, extents.yRange());
+
+	// Sites 1 to xRange-2 of each line, site i of lane l at (i-1)*lineLanes + l.
+	const int length = xRange - 2;
+	std::vector<double> lower(length*lineLanes), diagonal(length*lineLanes), upper(length*lineLanes), source(length*lineLanes);
+
+	// Solution for the update vector of a cyclic line, and the weight of its last site in the correction.
+	const bool cyclic = periodic && length > 2;
+	std::vector<double> correction(cyclic ? length*lineLanes : 0);
+	double wrapWeight[lineLanes];
+
+	double convergenceMeasure = 0;
+
+	for(int k = interiorBegin(Dimension > 2); k < interiorEnd(Dimension > 2, zRange); ++k)
+	{
+		// First line in this plane with parity of j+k (in global coordinates) equal to the colour.
+		const int jStart = jBegin + ((jBegin + k + parityOffset + colour) & 1);
+
+		for(int jFirst = jStart; jFirst < jEnd; jFirst += 2*lineLanes)
+		{
+			const int lanes = std::min(lineLanes, (jEnd - jFirst + 1)/2);
+
+			// Lanes past the last line solve x = 0 so the loops over the lanes always have the same length.
+			std::fill(lower.begin(), lower.end(), 0.0);
+			std::fill(diagonal.begin(), diagonal.end(), 1.0);
+			std::fill(upper.begin(), upper.end(), 0.0);
+			std::fill(source.begin(), source.end(), 0.0);
+
+			for(int l = 0; l < lanes; ++l)
+			{
+				const int j = jFirst + 2*l;
+				const int row = j*yStride + k*zStride;
+				const double *site = potential + row;
+				const double *charge = chargeDensity + row;
+
+				for(int i = 1; i < xRange-1; ++i)
+				{
+					source[(i-1)*lineLanes + l] = site[i];
+				}
+
+				for(int n = 0; n < rows.spans(j, k); ++n)
+				{
+					const RowSpan span = rows.span(j, k, n, xRange);
+
+					#pragma omp simd
+					for(int i = span.begin; i < span.end; ++i)
+					{
+						const LineEquation equation = coefficients.line(site + i, charge[i], row + i, i, j, k, yStride, zStride, chargeFactor);
+						const int entry = (i-1)*lineLanes + l;
+						lower[entry] = equation.lower;
+						diagonal[entry] = equation.diagonal;
+						upper[entry] = equation.upper;
+						source[entry] = equation.source;
+					}
+				}
+
+				// The halo at the ends of the line is known, so its coupling moves to the source.
+				if(!cyclic)
+				{
+					source[l] += lower[l]*site[0];
+					lower[l] = 0;
+					source[(length-1)*lineLanes + l] += upper[(length-1)*lineLanes + l]*site[xRange-1];
+					upper[(length-1)*lineLanes + l] = 0;
+				}
+			}
+
+			// Take the corners out as the rank one update u v^T with u = (gamma, 0, ..., 0, -upper[last]) and
+			// v = (1, 0, ..., 0, lower[0]/diagonal[0]), where gamma = -diagonal[0].
+			if(cyclic)
+			{
+				std::fill(correction.begin(), correction.end(), 0.0);
+
+				#pragma omp simd
+				for(int l = 0; l < lineLanes; ++l)
+				{
+					const int last = (length-1)*lineLanes + l;
+					const double gamma = -diagonal[l];
+
+					wrapWeight[l] = lower[l]/diagonal[l];
+					correction[l] = gamma;
+					correction[last] = -upper[last];
+					diagonal[l] -= gamma;
+					diagonal[last] -= lower[l]*upper[last]/gamma;
+					lower[l] = 0;
+					upper[last] = 0;
+				}
+			}
+
+			// Forward elimination, leaving m in diagonal[i], upper[i]/m in upper[i] and
+			// (source[i] + lower[i]*source[i-1])/m in source[i].
+			#pragma omp simd
+			for(int l = 0; l < lineLanes; ++l)
+			{
+				upper[l] /= diagonal[l];
+				source[l] /= diagonal[l];
+			}
+
+			for(int i = 1; i < length; ++i)
+			{
+				const double *lowerSite = &lower[i*lineLanes];
+				double *diagonalSite = &diagonal[i*lineLanes];
+				double *upperSite = &upper[i*lineLanes];
+				double *sourceSite = &source[i*lineLanes];
+
+				#pragma omp simd
+				for(int l = 0; l < lineLanes; ++l)
+				{
+					diagonalSite[l] -= lowerSite[l]*upperSite[l - lineLanes];
+					upperSite[l] /= diagonalSite[l];
+					sourceSite[l] = (sourceSite[l] + lowerSite[l]*sourceSite[l - lineLanes])/diagonalSite[l];
+				}
+			}
+
+			// Back substitution leaves the solution of each line in source.
+			for(int i = length-2; i >= 0; --i)
+			{
+				const double *upperSite = &upper[i*lineLanes];
+				double *sourceSite = &source[i*lineLanes];
+
+				#pragma omp simd
+				for(int l = 0; l < lineLanes; ++l)
+				{
+					sourceSite[l] += upperSite[l]*sourceSite[l + lineLanes];
+				}
+			}
+
+			if(cyclic)
+			{
+				// The update vector goes through the same factorisation, m being left in diagonal.
+				#pragma omp simd
+				for(int l = 0; l < lineLanes; ++l)
+				{
+					correction[l] /= diagonal[l];
+				}
+
+				for(int i = 1; i < length; ++i)
+				{
+					const double *lowerSite = &lower[i*lineLanes];
+					const double *diagonalSite = &diagonal[i*lineLanes];
+					double *correctionSite = &correction[i*lineLanes];
+
+					#pragma omp simd
+					for(int l = 0; l < lineLanes; ++l)
+					{
+						correctionSite[l] = (correctionSite[l] + lowerSite[l]*correctionSite[l - lineLanes])/diagonalSite[l];
+					}
+				}
+
+				for(int i = length-2; i >= 0; --i)
+				{
+					const double *upperSite = &upper[i*lineLanes];
+					double *correctionSite = &correction[i*lineLanes];
+
+					#pragma omp simd
+					for(int l = 0; l < lineLanes; ++l)
+					{
+						correctionSite[l] += upperSite[l]*correctionSite[l + lineLanes];
+					}
+				}
+
+				// Sherman-Morrison: x = y - (v.y)/(1 + v.z) z.
+				double factor[lineLanes];
+
+				#pragma omp simd
+				for(int l = 0; l < lineLanes; ++l)
+				{
+					const int last = (length-1)*lineLanes + l;
+					factor[l] = (source[l] + wrapWeight[l]*source[last])/(1 + correction[l] + wrapWeight[l]*correction[last]);
+				}
+
+				for(int i = 0; i < length; ++i)
+				{
+					const double *correctionSite = &correction[i*lineLanes];
+					double *sourceSite = &source[i*lineLanes];
+
+					#pragma omp simd
+					for(int l = 0; l < lineLanes; ++l)
+					{
+						sourceSite[l] -= factor[l]*correctionSite[l];
+					}
+				}
+			}
+
+			// Only the free sites are relaxed, so sites held at a potential keep exactly their value.
+			for(int l = 0; l < lanes; ++l)
+			{
+				const int j = jFirst + 2*l;
+				double *site = potential + j*yStride + k*zStride;
+
+				for(int n = 0; n < rows.spans(j, k); ++n)
+				{
+					const RowSpan span = rows.span(j, k, n, xRange);
+
+					#pragma omp simd reduction(+:convergenceMeasure)
+					for(int i = span.begin; i < span.end; ++i)
+					{
+						double currentValue = site[i];
+						double sorValue = (1-sorParameter) * currentValue + sorParameter * source[(i-1)*lineLanes + l];
+
+						site[i] = sorValue;
+						convergenceMeasure += std::abs(sorValue - currentValue);
+					}
+				}
+			}
+		}
+	}
+
+	return convergenceMeasure;
+}
+
+#endif /* StencilKernels_hpp */
@@ -0,0 +1,255 @@
+#include "TextFormat.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	/// Powers of ten that doubles hold exactly.
+	const double powersOfTen[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+									1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	/// Range of decimal exponents the fast path handles, one in from the ends so an adjustment stays in the table.
+	const int minExponent = -16;
+	const int maxExponent = 26;
+
+	/// Number of significant figures of a stream with default formatting.
+	const int significantFigures = 6;
+
+	/**
+	 *\brief multiplies by a power of ten with a single rounding.
+	 *\param value the value.
+	 *\param power power of ten between -22 and 22.
+	 *\return value*10^power.
+	 */
+	double scale(double value, int power)
+	{
+		return power >= 0 ? value*powersOfTen[power] : value/powersOfTen[-power];
+	}
+
+	/**
+	 *\brief writes a double with snprintf, for the values the fast path can't be sure of.
+	 */
+	char* formatWithPrintf(char *out, double value)
+	{
+		return out + std::snprintf(out, TextFormat::maxNumberLength, "%g", value);
+	}
+}
+
+char* TextFormat::formatInteger(char *out, int value)
+{
+	unsigned int magnitude = value < 0 ? 0u - static_cast<unsigned int>(value) : static_cast<unsigned int>(value);
+	if(value < 0)
+	{
+		*out++ = '-';
+	}
+
+	char digits[10];
+	int count = 0;
+	do
+	{
+		digits[count++] = static_cast<char>('0' + magnitude%10);
+		magnitude /= 10;
+	}
+	while(magnitude > 0);
+
+	while(count > 0)
+	{
+		*out++ = digits[--count];
+	}
+	return out;
+}
+
+char* TextFormat::formatDouble(char *out, double value)
+{
+	if(!std::isfinite(value))
+	{
+		return formatWithPrintf(out, value);
+	}
+
+	if(0 == value)
+	{
+		if(std::signbit(value))
+		{
+			*out++ = '-';
+		}
+		*out++ = '0';
+		return out;
+	}
+
+	const double magnitude = std::fabs(value);
+
+	// The decimal exponent is either this estimate from the binary exponent or one more.
+	int binaryExponent;
+	std::frexp(magnitude, &binaryExponent);
+	int exponent = static_cast<int>(std::floor((binaryExponent - 1)*0.30102999566398120));
+	if(exponent < minExponent || exponent > maxExponent)
+	{
+		return formatWithPrintf(out, value);
+	}
+
+	// Bring the six significant figures in front of the decimal point.
+	double scaled = scale(magnitude, significantFigures - 1 - exponent);
+	if(scaled < 1e5)
+	{
+		--exponent;
+		scaled = scale(magnitude, significantFigures - 1 - exponent);
+	}
+	else if(scaled >= 1e6)
+	{
+		++exponent;
+		scaled = scale(magnitude, significantFigures - 1 - exponent);
+	}
+
+	// Scaling is off by a few ulps at most, so only values within a hair of halfway could round either way.
+	double whole = std::floor(scaled);
+	double fraction = scaled - whole;
+	if(std::fabs(fraction - 0.5) < 1e-6)
+	{
+		return formatWithPrintf(out, value);
+	}
+
+	std::uint32_t digits = static_cast<std::uint32_t>(whole) + (fraction > 0.5 ? 1 : 0);
+	if(1000000 == digits)
+	{
+		digits = 100000;
+		++exponent;
+	}
+
+	// Split into single digits and drop the trailing zeros, as %g does.
+	char figures[significantFigures];
+	for(int n = significantFigures - 1; n >= 0; --n)
+	{
+		figures[n] = static_cast<char>('0' + digits%10);
+		digits /= 10;
+	}
+	int used = significantFigures;
+	while(used > 1 && '0' == figures[used-1])
+	{
+		--used;
+	}
+
+	if(value < 0)
+	{
+		*out++ = '-';
+	}
+
+	if(exponent >= -4 && exponent < significantFigures)
+	{
+		if(exponent >= 0)
+		{
+			for(int n = 0; n <= exponent; ++n)
+			{
+				*out++ = n < used ? figures[n] : '0';
+			}
+			if(used > exponent + 1)
+			{
+				*out++ = '.';
+				for(int n = exponent + 1; n < used; ++n)
+				{
+					*out++ = figures[n];
+				}
+			}
+		}
+		else
+		{
+			*out++ = '0';
+			*out++ = '.';
+			for(int n = 0; n < -exponent - 1; ++n)
+			{
+				*out++ = '0';
+			}
+			for(int n = 0; n < used; ++n)
+			{
+				*out++ = figures[n];
+			}
+		}
+	}
+	else
+	{
+		*out++ = figures[0];
+		if(used > 1)
+		{
+			*out++ = '.';
+			for(int n = 1; n < used; ++n)
+			{
+				*out++ = figures[n];
+			}
+		}
+		*out++ = 'e';
+		*out++ = exponent < 0 ? '-' : '+';
+		int exponentMagnitude = exponent < 0 ? -exponent : exponent;
+		*out++ = static_cast<char>('0' + exponentMagnitude/10);
+		*out++ = static_cast<char>('0' + exponentMagnitude%10);
+	}
+	return out;
+}
+
+void TextFormat::formatLattice(std::string &buffer, const PoissonLattice &lattice, const ElectricField &field,
+							   const std::array<int,3> &lower, const std::array<int,3> &upper)
+{
+	const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
+	const std::size_t rows = static_cast<std::size_t>(upper[1] - lower[1] + 1)*(upper[2] - lower[2] + 1);
+	const std::size_t sites = rows*(upper[0] - lower[0] + 1);
+
+	// Room for the longest possible text, cut down to what was written at the end.
+	buffer.resize(sites*maxSiteLength + rows + (upper[2] - lower[2] + 1));
+	char *out = &buffer[0];
+
+	// Squared distance of each coordinate from the centre of the lattice, found by integer division.
+	std::array<std::vector<double>,3> squaredDistances;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		double centre = ranges[axis]/2;
+		squaredDistances[axis].resize(ranges[axis]);
+		for(int n = 0; n < ranges[axis]; ++n)
+		{
+			squaredDistances[axis][n] = (centre - n)*(centre - n);
+		}
+	}
+
+	const double *potential = lattice.data();
+	const double *fieldX = field.component(0);
+	const double *fieldY = field.component(1);
+	const double *fieldZ = field.component(2);
+	const double *fieldStrength = field.magnitude();
+
+	for(int k = lower[2]; k <= upper[2]; ++k)
+	{
+		for(int j = lower[1]; j <= upper[1]; ++j)
+		{
+			int index = lattice.index(lower[0], j, k);
+			for(int i = lower[0]; i <= upper[0]; ++i, ++index)
+			{
+				double radialDistance = std::sqrt(squaredDistances[0][i] + squaredDistances[1][j] + squaredDistances[2][k]);
+
+				out = formatInteger(out, i);
+				*out++ = ' ';
+				out = formatInteger(out, j);
+				*out++ = ' ';
+				out = formatInteger(out, k);
+				*out++ = ' ';
+				out = formatDouble(out, radialDistance);
+				*out++ = ' ';
+				out = formatDouble(out, potential[index]);
+				*out++ = ' ';
+				out = formatDouble(out, fieldX[index]);
+				*out++ = ' ';
+				out = formatDouble(out, fieldY[index]);
+				*out++ = ' ';
+				out = formatDouble(out, fieldZ[index]);
+				*out++ = ' ';
+				out = formatDouble(out, fieldStrength[index]);
+				*out++ = ' ';
+				*out++ = '\n';
+			}
+
+			*out++ = '\n';
+		}
+
+		*out++ = '\n';
+	}
+
+	buffer.resize(out - buffer.data());
+}
@@ -0,0 +1,56 @@
+#ifndef TextFormat_hpp
+#define TextFormat_hpp
+#include <array>
+#include <cstddef>
+#include <string>
+#include "PoissonLattice.hpp"
+#include "ElectricField.hpp"
+
+/**
+ *\file
+ *\class TextFormat
+ *\brief Formats numbers and whole lattices into character buffers without going through iostreams.
+ *
+ * Doubles come out exactly as a stream with default formatting writes them, which is printf's %g with six
+ * significant figures. The six digits are found with one multiplication or division by an exact power of
+ * ten and a rounding, and the few values too close to halfway between two roundings for that to be certain,
+ * or too large or small for the table of powers, are handed to snprintf. Integers are written digit by digit.
+ */
+class TextFormat
+{
+public:
+	/// Most characters a formatted int or double takes, including the sign.
+	static const std::size_t maxNumberLength = 16;
+
+	/// Most characters one site of the lattice output takes, nine numbers, their separators and the newline.
+	static const std::size_t maxSiteLength = 9*(maxNumberLength + 1) + 1;
+
+	/**
+	 *\brief writes an integer in decimal.
+	 *\param out where to write, at least maxNumberLength characters.
+	 *\param value the integer.
+	 *\return pointer one past the last character written.
+	 */
+	static char* formatInteger(char *out, int value);
+
+	/**
+	 *\brief writes a double the way a stream with default formatting does.
+	 *\param out where to write, at least maxNumberLength characters.
+	 *\param value the double.
+	 *\return pointer one past the last character written.
+	 */
+	static char* formatDouble(char *out, double value);
+
+	/**
+	 *\brief formats the sites of a box of a lattice in the same form as operator<<.
+	 *\param buffer replaced with the text, its capacity is reused.
+	 *\param lattice Poisson lattice to print from.
+	 *\param field electric field of the lattice.
+	 *\param lower lowest x, y and z indices to print.
+	 *\param upper highest x, y and z indices to print, inclusive.
+	 */
+	static void formatLattice(std::string &buffer, const PoissonLattice &lattice, const ElectricField &field,
+							  const std::array<int,3> &lower, const std::array<int,3> &upper);
+};
+
+#endif /* TextFormat_hpp */
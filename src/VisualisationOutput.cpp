@@ -0,0 +1,279 @@
+#include "VisualisationOutput.hpp"
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "ChunkedWriter.hpp"
+
+namespace
+{
+	/**
+	 *\brief gets the position of every site along an axis, starting from zero.
+	 *\param lattice the lattice.
+	 *\param axis 0, 1 or 2 for x, y or z.
+	 *\return the positions.
+	 */
+	std::vector<double> positions(const PoissonLattice &lattice, int axis)
+	{
+		const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
+		std::vector<double> coordinates(ranges[axis], 0.0);
+		for(int n = 1; n < ranges[axis]; ++n)
+		{
+			coordinates[n] = coordinates[n-1] + lattice.spacing(axis, n-1);
+		}
+		return coordinates;
+	}
+
+	/**
+	 *\brief writes an appended VTK array, its size in bytes followed by the values.
+	 *\return offset just past the array.
+	 */
+	std::uint64_t writeAppended(ChunkedWriter &file, const double *values, std::size_t count, std::uint64_t offset)
+	{
+		std::uint64_t bytes = count*sizeof(double);
+		file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes), offset);
+		file.writeValues(values, count, offset + sizeof(bytes));
+		return offset + sizeof(bytes) + bytes;
+	}
+
+	/**
+	 *\brief writes an array held in the layout of a lattice as an appended VTK array, leaving out any padding.
+	 *\return offset just past the array.
+	 */
+	std::uint64_t writeAppendedPlanes(ChunkedWriter &file, const PoissonLattice &lattice, const double *values, std::uint64_t offset)
+	{
+		std::uint64_t bytes = static_cast<std::uint64_t>(lattice.xRange())*lattice.yRange()*lattice.zRange()*sizeof(double);
+		file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes), offset);
+		file.writePlanes(lattice, values, offset + sizeof(bytes));
+		return offset + sizeof(bytes) + bytes;
+	}
+
+	/**
+	 *\brief writes the field components interleaved as vectors, each thread staging and writing its own planes.
+	 */
+	void writeVectors(ChunkedWriter &file, const PoissonLattice &lattice, const ElectricField &field, std::uint64_t offset)
+	{
+		const int xRange = lattice.xRange();
+		const int yRange = lattice.yRange();
+		std::string error;
+
+		#pragma omp parallel
+		{
+			std::vector<double> plane(3*static_cast<std::size_t>(xRange)*yRange);
+
+			#pragma omp for schedule(static)
+			for(int k = 0; k < lattice.zRange(); ++k)
+			{
+				for(int axis = 0; axis < 3; ++axis)
+				{
+					for(int j = 0; j < yRange; ++j)
+					{
+						const double *component = field.component(axis) + lattice.index(0, j, k);
+						double *vectors = &plane[3*static_cast<std::size_t>(j)*xRange];
+						for(int i = 0; i < xRange; ++i)
+						{
+							vectors[3*i + axis] = component[i];
+						}
+					}
+				}
+
+				try
+				{
+					file.write(reinterpret_cast<const char*>(plane.data()), plane.size()*sizeof(double),
+							   offset + static_cast<std::uint64_t>(k)*plane.size()*sizeof(double));
+				}
+				catch(const std::exception &exception)
+				{
+					#pragma omp critical
+					error = exception.what();
+				}
+			}
+		}
+
+		if(!error.empty())
+		{
+			throw std::runtime_error(error);
+		}
+	}
+}
+
+bool VisualisationOutput::uniform(const PoissonLattice &lattice)
+{
+	const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
+	for(int axis = 0; axis < lattice.dimension(); ++axis)
+	{
+		for(int n = 0; n < ranges[axis]-1; ++n)
+		{
+			if(lattice.spacing(axis, n) != lattice.dx())
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void VisualisationOutput::writeVtk(const std::string &fileName, const PoissonLattice &lattice, const ElectricField &field)
+{
+	const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
+	const std::uint64_t sites = static_cast<std::uint64_t>(ranges[0])*ranges[1]*ranges[2];
+	const std::uint64_t scalarBytes = sites*sizeof(double);
+	const bool image = uniform(lattice);
+	const std::string type = image ? "ImageData" : "RectilinearGrid";
+	const std::string extent = "0 " + std::to_string(ranges[0]-1) + " 0 " + std::to_string(ranges[1]-1) + " 0 " + std::to_string(ranges[2]-1);
+
+	// Each appended array is preceded by its size in bytes, so offsets step over that too.
+	std::uint64_t offset = 0;
+	std::ostringstream out;
+	out.precision(17);
+	out << "<?xml version=\"1.0\"?>\n"
+		<< "<VTKFile type=\"" << type << "\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n";
+
+	if(image)
+	{
+		out << "  <ImageData WholeExtent=\"" << extent << "\" Origin=\"0 0 0\" Spacing=\"" << lattice.dx() << ' '
+			<< lattice.dx() << ' ' << lattice.dx() << "\">\n";
+	}
+	else
+	{
+		out << "  <RectilinearGrid WholeExtent=\"" << extent << "\">\n";
+	}
+	out << "    <Piece Extent=\"" << extent << "\">\n"
+		<< "      <PointData Scalars=\"potential\" Vectors=\"E\">\n"
+		<< "        <DataArray type=\"Float64\" Name=\"potential\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+	offset += sizeof(std::uint64_t) + scalarBytes;
+	out << "        <DataArray type=\"Float64\" Name=\"E\" NumberOfComponents=\"3\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+	offset += sizeof(std::uint64_t) + 3*scalarBytes;
+	out << "        <DataArray type=\"Float64\" Name=\"|E|\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+	offset += sizeof(std::uint64_t) + scalarBytes;
+	out << "      </PointData>\n";
+
+	if(!image)
+	{
+		out << "      <Coordinates>\n";
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			out << "        <DataArray type=\"Float64\" Name=\"" << char('x' + axis) << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+			offset += sizeof(std::uint64_t) + ranges[axis]*sizeof(double);
+		}
+		out << "      </Coordinates>\n";
+	}
+
+	out << "    </Piece>\n"
+		<< "  </" << type << ">\n"
+		<< "  <AppendedData encoding=\"raw\">\n"
+		<< "   _";
+
+	// The XML goes first, then each array is written by every thread at the offset worked out above.
+	const std::string header = out.str();
+	ChunkedWriter file(fileName);
+	file.write(header.data(), header.size(), 0);
+	offset = header.size();
+
+	offset = writeAppendedPlanes(file, lattice, lattice.data(), offset);
+
+	const std::uint64_t vectorBytes = 3*scalarBytes;
+	file.write(reinterpret_cast<const char*>(&vectorBytes), sizeof(vectorBytes), offset);
+	writeVectors(file, lattice, field, offset + sizeof(vectorBytes));
+	offset += sizeof(vectorBytes) + vectorBytes;
+
+	offset = writeAppendedPlanes(file, lattice, field.magnitude(), offset);
+
+	if(!image)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			std::vector<double> coordinates = positions(lattice, axis);
+			offset = writeAppended(file, coordinates.data(), coordinates.size(), offset);
+		}
+	}
+
+	const std::string footer = "\n  </AppendedData>\n</VTKFile>\n";
+	file.write(footer.data(), footer.size(), offset);
+}
+
+void VisualisationOutput::writeXdmf(const std::string &baseName, const PoissonLattice &lattice, const ElectricField &field)
+{
+	const int ranges[3] = {lattice.xRange(), lattice.yRange(), lattice.zRange()};
+	const std::size_t sites = static_cast<std::size_t>(ranges[0])*ranges[1]*ranges[2];
+	const bool image = uniform(lattice);
+
+	// XDMF lists dimensions slowest first.
+	const std::string dimensions = std::to_string(ranges[2]) + ' ' + std::to_string(ranges[1]) + ' ' + std::to_string(ranges[0]);
+
+	// The raw file holds the potential, Ex, Ey, Ez and |E| one after another, then the coordinates if the grid isn't uniform.
+	std::string rawName = baseName + ".raw";
+	ChunkedWriter raw(rawName);
+	std::uint64_t offset = 0;
+	raw.writePlanes(lattice, lattice.data(), offset);
+	offset += sites*sizeof(double);
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		raw.writePlanes(lattice, field.component(axis), offset);
+		offset += sites*sizeof(double);
+	}
+	raw.writePlanes(lattice, field.magnitude(), offset);
+	offset += sites*sizeof(double);
+	if(!image)
+	{
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			std::vector<double> coordinates = positions(lattice, axis);
+			raw.writeValues(coordinates.data(), coordinates.size(), offset);
+			offset += coordinates.size()*sizeof(double);
+		}
+	}
+
+	// The description refers to the raw file by name relative to itself.
+	std::string rawFile = rawName.substr(rawName.find_last_of('/') + 1);
+	std::size_t seek = 0;
+
+	std::ofstream out(baseName + ".xmf");
+	out.precision(17);
+	out << "<?xml version=\"1.0\" ?>\n"
+		<< "<Xdmf Version=\"3.0\">\n"
+		<< "  <Domain>\n"
+		<< "    <Grid Name=\"lattice\" GridType=\"Uniform\">\n";
+
+	if(image)
+	{
+		out << "      <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\"" << dimensions << "\"/>\n"
+			<< "      <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n"
+			<< "        <DataItem Dimensions=\"3\" Format=\"XML\">0 0 0</DataItem>\n"
+			<< "        <DataItem Dimensions=\"3\" Format=\"XML\">" << lattice.dx() << ' ' << lattice.dx() << ' ' << lattice.dx() << "</DataItem>\n"
+			<< "      </Geometry>\n";
+	}
+	else
+	{
+		std::size_t coordinateSeek = 5*sites*sizeof(double);
+		out << "      <Topology TopologyType=\"3DRectMesh\" Dimensions=\"" << dimensions << "\"/>\n"
+			<< "      <Geometry GeometryType=\"VXVYVZ\">\n";
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			out << "        <DataItem Dimensions=\"" << ranges[axis] << "\" NumberType=\"Float\" Precision=\"8\" Format=\"Binary\" Endian=\"Little\" Seek=\""
+				<< coordinateSeek << "\">" << rawFile << "</DataItem>\n";
+			coordinateSeek += ranges[axis]*sizeof(double);
+		}
+		out << "      </Geometry>\n";
+	}
+
+	const char *names[5] = {"potential", "Ex", "Ey", "Ez", "|E|"};
+	for(int n = 0; n < 5; ++n)
+	{
+		out << "      <Attribute Name=\"" << names[n] << "\" AttributeType=\"Scalar\" Center=\"Node\">\n"
+			<< "        <DataItem Dimensions=\"" << dimensions << "\" NumberType=\"Float\" Precision=\"8\" Format=\"Binary\" Endian=\"Little\" Seek=\""
+			<< seek << "\">" << rawFile << "</DataItem>\n"
+			<< "      </Attribute>\n";
+		seek += sites*sizeof(double);
+	}
+
+	out << "    </Grid>\n"
+		<< "  </Domain>\n"
+		<< "</Xdmf>\n";
+
+	if(!out)
+	{
+		throw std::runtime_error("XDMF file " + baseName + ".xmf can't be written.");
+	}
+}
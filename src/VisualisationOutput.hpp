@@ -0,0 +1,47 @@
+#ifndef VisualisationOutput_hpp
+#define VisualisationOutput_hpp
+#include <string>
+#include "PoissonLattice.hpp"
+#include "ElectricField.hpp"
+
+/**
+ *\file
+ *\class VisualisationOutput
+ *\brief Writers of the potential and electric field in formats ParaView and VisIt read directly.
+ *
+ * The VTK writer produces a single XML file with the arrays appended as raw binary, as image data for a
+ * uniform grid or a rectilinear grid when the spacing varies. The XDMF writer produces a small XML file
+ * describing the arrays and a raw binary file holding them one after another. Both write the potential,
+ * the field components and the field strength straight from the lattice and ElectricField arrays, one plane
+ * at a time where the layout on disk differs from memory, so writing needs no copy of the lattice. The
+ * offset of every array is known before any data is written, so each is written by every thread at once
+ * through a ChunkedWriter.
+ */
+class VisualisationOutput
+{
+public:
+	/**
+	 *\brief writes a VTK XML file with appended binary data.
+	 *\param fileName name of the file, conventionally ending .vti for a uniform grid or .vtr otherwise.
+	 *\param lattice solved lattice.
+	 *\param field electric field of the lattice.
+	 */
+	static void writeVtk(const std::string &fileName, const PoissonLattice &lattice, const ElectricField &field);
+
+	/**
+	 *\brief writes an XDMF description and the raw binary arrays it refers to.
+	 *\param baseName name of the files without extension, baseName.xmf and baseName.raw are written.
+	 *\param lattice solved lattice.
+	 *\param field electric field of the lattice.
+	 */
+	static void writeXdmf(const std::string &baseName, const PoissonLattice &lattice, const ElectricField &field);
+
+	/**
+	 *\brief checks whether the spacing is the same along every axis and everywhere, so the grid is an image.
+	 *\param lattice the lattice.
+	 *\return whether the grid is uniform.
+	 */
+	static bool uniform(const PoissonLattice &lattice);
+};
+
+#endif /* VisualisationOutput_hpp */
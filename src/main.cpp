@@ -8,12 +8,34 @@
 #include <cmath> // For any maths functions.
 #include <iomanip> // For manipulating output.
 #include <string> // For naming output directory.
+#include <cstdio> // For parsing the pool pre-warming sizes and the lattice padding.
 #include <fstream> // For file output.
 #include <algorithm> // For swapping the lattices.
+#include <vector> // For the boundary condition specifications.
 #include "Timer.hpp" // For custom timer.
 #include "makeDirectory.hpp" // For making directories.
 #include "PoissonInputParameters.hpp" // For neatly packaging together input parameters.
-#include "PoissonLattice.hpp"
+#include "PoissonLattice.hpp" // For the lattice holding the potential.
+#include "BoundaryConditions.hpp" // For the conditions on each face of the domain.
+#include "RegionGeometry.hpp" // For conductors and dielectrics inside the domain.
+#include "GridSpacing.hpp" // For non-uniform spacing.
+#include "PoissonSolver.hpp" // For solving the lattice.
+#include "ElectricField.hpp" // For the field written out with the potential.
+#include "DerivedQuantities.hpp" // For the energy, flux and capacitance.
+#include "OutputSelection.hpp" // For writing parts of the lattice.
+#include "LatticeCompression.hpp" // For compressed output.
+#include "VisualisationOutput.hpp" // For VTK and XDMF output.
+#include "ChunkedWriter.hpp" // For writing the output from every thread at once.
+#include <omp.h> // For the default number of threads.
+#include "LatticeAllocator.hpp" // For placing the lattice memory on NUMA nodes.
+#include "pinThreads.hpp" // For pinning the worker threads to CPUs.
+#include "FixedSizeKernels.hpp" // For turning off the kernels compiled for specific lattice sizes.
+#ifdef POISSON_MPI
+#include "MpiLattice.hpp" // For distributing the lattice across MPI ranks.
+#else
+#include "AmrHierarchy.hpp" // For refining the mesh around the charge.
+#include "SolverServer.hpp" // For serving solve requests from a socket.
+#endif
 
 
 int main(int argc, char const *argv[])
@@ -21,12 +43,30 @@ int main(int argc, char const *argv[])
 /*************************************************************************************************************************
 ************************************************* Preparations **********************************************************
 *************************************************************************************************************************/
+    // Only the root process creates output files and prints, which is every process without MPI.
+    bool isRoot = true;
+
+#ifdef POISSON_MPI
+    MPI_Init(&argc, const_cast<char***>(&argv));
+
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    isRoot = (0 == rank);
+#endif
+
     // Start the clock so execution time can be calculated.
     Timer timer;
 
     // Seed the pseudo random number generator using the system clock.
     unsigned int seed = static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
 
+#ifdef POISSON_MPI
+    // Give each rank a different stream of random numbers.
+    seed += static_cast<unsigned int>(rank);
+#endif
+
     // Create a generator that can be fed to any distribution to produce pseudo random numbers according to that distribution.
     std::default_random_engine generator(seed);
 
@@ -53,6 +93,12 @@ int main(int argc, char const *argv[])
     // Precision of convergence.
     double precision;
 
+    // Maximum number of sweeps, zero for no limit.
+    int maxIterations;
+
+    // Number of dimensions of the lattice domain.
+    int dimension;
+
     // Number of x values in cubic lattice domain.
     int xRange;
 
@@ -68,6 +114,78 @@ int main(int argc, char const *argv[])
     // SOR update parameter.
     double sorParameter;
 
+    // Spectral radius of the Jacobi iteration for the Chebyshev method.
+    double spectralRadius;
+
+    // Number of threads for the parallel solution methods.
+    int threads;
+
+    // Placement of the lattice memory on the NUMA nodes.
+    std::string memoryPlacement;
+
+    // Node to place the lattice memory on for single node placement.
+    int numaNode;
+
+    // Huge pages to back the lattice memory with.
+    std::string hugePages;
+
+    // Padding of the lattice rows and planes, none or x,y.
+    std::string latticePadding;
+
+    // Pinning of the worker threads to CPUs.
+    std::string threadAffinity;
+
+    // Boundary conditions of the form faces=type[:value], applied in order.
+    std::vector<std::string> boundarySpecifications;
+
+    // Conductors of the form shape=parameters[:potential], later ones take precedence where they overlap.
+    std::vector<std::string> conductorSpecifications;
+
+    // Dielectric regions of the form shape=parameters:permittivity, later ones take precedence where they overlap.
+    std::vector<std::string> dielectricSpecifications;
+
+    // Non-uniform spacing of the form axes=stretch:ratio or axes=file:name.
+    std::vector<std::string> spacingSpecifications;
+
+    // Levels of mesh refinement around the charge, zero for none.
+    int amrLevels;
+
+    // Size of the blocks the refinement is made of.
+    int amrBlockSize;
+
+    // Fraction of the largest charge density or gradient that is refined.
+    double amrThreshold;
+
+    // Sites around each refined site that are also refined.
+    int amrBuffer;
+
+    // Maximum number of cycles between the refinement levels.
+    int amrCycles;
+
+    // Boxes of the form x0,y0,z0,x1,y1,z1 to compute the flux out of.
+    std::vector<std::string> fluxSpecifications;
+
+    // Parts of the lattice to write out of the form kind=parameters.
+    std::vector<std::string> selectionSpecifications;
+
+    // Most megabytes of idle lattice buffers kept for reuse, zero for no buffer pool.
+    double bufferPool;
+
+    // Lattice sizes x,y,z:count to map buffers into the pool for at startup.
+    std::vector<std::string> poolPrewarmSpecifications;
+
+    // Unix domain socket to serve solve requests on instead of running a single solve.
+    std::string serveSocket;
+
+    // Number of requests served at once.
+    int serveWorkers;
+
+    // Compression of the potential output, none, lossless or lossy.
+    std::string compression;
+
+    // Largest error of lossy compression, zero to use the precision.
+    double compressionTolerance;
+
     // Set up optional command line argument.
     boost::program_options::options_description desc("Options for Poisson simulation");
 
@@ -77,14 +195,51 @@ int main(int argc, char const *argv[])
         ("initial-value,v", boost::program_options::value<double>(&initialValue)->default_value(0), "Initial value of order parameter.")
         ("noise,n",boost::program_options::value<double>(&noise)->default_value(0.0), "Maximum magnitude of initial noise.")
         ("precision,d", boost::program_options::value<double>(&precision)->default_value(0.001),"Precision of convergence.")
+        ("max-iterations,m", boost::program_options::value<int>(&maxIterations)->default_value(0),"Maximum number of sweeps before giving up, zero for no limit. A run that gives up says so in results.txt and exits with status 1.")
+        ("dimension",boost::program_options::value<int>(&dimension)->default_value(3),"Number of dimensions of the domain, 2 ignores the z-range and 1 also ignores the y-range.")
         ("x-range,r", boost::program_options::value<int>(&xRange)->default_value(100),"Total number of x points in domain of simulation domain.")
         ("y-range,c", boost::program_options::value<int>(&yRange)->default_value(100),"Total number of y points in domain of simulation domain.")
         ("z-range,t", boost::program_options::value<int>(&zRange)->default_value(100),"Total number of z points in domain of simulation domain.")
         ("output,o",boost::program_options::value<std::string>(&outputName)->default_value(getTimeStamp()), "Name of output directory to save output files into.")
         ("sor-parameter,w",boost::program_options::value<double>(&sorParameter)->default_value(1),"Parameter for the successive over-relaxation algorithm.")
+        ("spectral-radius",boost::program_options::value<double>(&spectralRadius)->default_value(0),"Spectral radius of the Jacobi iteration for --Chebyshev, between 0 and 1. Zero works it out for a box with the potential given on every face and estimates it from the first sweeps otherwise.")
+        ("threads,j",boost::program_options::value<int>(&threads)->default_value(omp_get_max_threads()),"Number of threads (and lattice slabs) for the Jacobi, Chebyshev, red-black SOR and line SOR methods.")
+        ("memory-placement",boost::program_options::value<std::string>(&memoryPlacement)->default_value("first-touch"),"Placement of lattice memory on NUMA nodes: first-touch, interleaved or single-node.")
+        ("numa-node",boost::program_options::value<int>(&numaNode)->default_value(0),"NUMA node to place lattice memory on with single-node placement.")
+        ("huge-pages",boost::program_options::value<std::string>(&hugePages)->default_value("none"),"Huge pages for lattice memory: none, transparent (madvise) or explicit (hugetlbfs, falls back to transparent).")
+        ("lattice-padding",boost::program_options::value<std::string>(&latticePadding)->default_value("none"),"Padding of the lattice: none, or x,y to align every row to a 64 byte cache line, add x values to each row and y rows to each plane. 8,1 avoids cache set conflicts for power of two sizes.")
+        ("affinity",boost::program_options::value<std::string>(&threadAffinity)->default_value("none"),"Pinning of threads to CPUs: none, compact or scatter.")
+        ("boundary,b",boost::program_options::value<std::vector<std::string> >(&boundarySpecifications)->composing(),"Boundary condition faces=type[:value], may be repeated. faces is x-low, x-high, y-low, y-high, z-low, z-high, an axis x, y or z, or all, and type is dirichlet (potential), neumann (outward flux) or periodic. Unset faces are dirichlet:0.")
+        ("conductor",boost::program_options::value<std::vector<std::string> >(&conductorSpecifications)->composing(),"Conductor held at a fixed potential shape=parameters[:potential], may be repeated. Shapes in lattice indices are box=x0,y0,z0,x1,y1,z1, sphere=x,y,z,r, cylinder-z=x,y,r,z0,z1 (likewise cylinder-x and cylinder-y) and voxels=file with one byte per site, non-zero inside.")
+        ("dielectric",boost::program_options::value<std::vector<std::string> >(&dielectricSpecifications)->composing(),"Region with its own permittivity shape=parameters:permittivity, may be repeated, with the same shapes as --conductor. The rest of the domain has the --permittivity.")
+        ("spacing",boost::program_options::value<std::vector<std::string> >(&spacingSpecifications)->composing(),"Non-uniform spacing along an axis, may be repeated. axes=stretch:ratio grows the spacing by ratio per site away from the centre starting from the spatial discretisation, axes=file:name reads range-1 spacings. axes is x, y, z or all.")
+        ("amr-levels",boost::program_options::value<int>(&amrLevels)->default_value(0),"Levels of block-structured mesh refinement, each halving the spacing, placed where the charge density or potential gradient is large. Zero for none, and not with --conductor, --dielectric or --spacing.")
+        ("amr-block",boost::program_options::value<int>(&amrBlockSize)->default_value(8),"Size in sites of the blocks that are refined.")
+        ("amr-threshold",boost::program_options::value<double>(&amrThreshold)->default_value(0.1),"Sites whose charge density or potential difference to their neighbours is at least this fraction of the maximum are refined.")
+        ("amr-buffer",boost::program_options::value<int>(&amrBuffer)->default_value(2),"Number of sites around each refined site that are refined too.")
+        ("amr-cycles",boost::program_options::value<int>(&amrCycles)->default_value(10),"Maximum number of cycles passing the solution between the refinement levels.")
+        ("energy","Compute the electrostatic energy of the solution.")
+        ("flux",boost::program_options::value<std::vector<std::string> >(&fluxSpecifications)->composing(),"Compute the flux out of a box of sites x0,y0,z0,x1,y1,z1 (inclusive), which is the charge inside it. May be repeated.")
+        ("capacitance","Compute the charge on each conductor, its capacitance and, for two conductors, their mutual capacitance.")
+        ("select",boost::program_options::value<std::vector<std::string> >(&selectionSpecifications)->composing(),"Write part of the lattice into selection<n>.dat instead of every site, may be repeated. plane=axis:index, line=axis:a,b through the other two coordinates in xyz order, box=x0,y0,z0,x1,y1,z1 or radial=width for the potential binned by distance from the centre.")
+        ("compress",boost::program_options::value<std::string>(&compression)->default_value("none"),"Write the potential compressed into poissonPotential.pcz instead of the full output: none, lossless or lossy (every value within --compress-tolerance). Read it back with poisson-reader.")
+        ("compress-tolerance",boost::program_options::value<double>(&compressionTolerance)->default_value(0),"Largest absolute error of lossy compression, zero to use the precision of convergence.")
+        ("vtk","Write the potential and field as VTK XML with appended binary data into poissonOutput.vti, or poissonOutput.vtr for non-uniform spacing, instead of the full output.")
+        ("xdmf","Write the potential and field as XDMF into poissonOutput.xmf describing the raw binary poissonOutput.raw, instead of the full output.")
+        ("stream-output","Write poissonOutput.dat from one thread formatting each value through iostreams, the old writer, to compare against.")
+        ("full-output","Write every site into poissonOutput.dat even when parts of the lattice are selected or it is written in another format.")
+        ("no-fixed-size-kernels","Use the generic kernels even for lattice sizes (64, 128 or 256 in x and y) with specialised ones.")
         ("Jacobi","Use Jacobi relaxation method")
         ("Gauss-Seidel","Use Gauss-Seidel relaxation method (will take precedence over Gauss-Seidel")
-        ("SOR","Use successive over relaxation method with Gauss-Seidel algorithm, will take overall precedence")
+        ("SOR","Use successive over relaxation method with Gauss-Seidel algorithm, will take precedence over Gauss-Seidel")
+        ("Chebyshev","Use Jacobi relaxation with Chebyshev semi-iterative acceleration in parallel, will take precedence over Jacobi")
+        ("SSOR","Use symmetric successive over relaxation, a forward then a backward SOR sweep, will take precedence over SOR")
+        ("Line-SOR","Use successive over relaxation solving whole lines along x at once, with the lines in red-black order in parallel, will take precedence over SSOR. Suits a spacing along x much smaller than along the other axes")
+        ("Red-Black-SOR","Use successive over relaxation method with red-black ordering in parallel, will take overall precedence")
+        ("buffer-pool",boost::program_options::value<double>(&bufferPool)->default_value(0),"Recycle lattice buffers between solves through a pool keeping at most this many megabytes of idle buffers, zero for none. Mostly useful with --serve.")
+        ("pool-prewarm",boost::program_options::value<std::vector<std::string> >(&poolPrewarmSpecifications)->composing(),"Map and fault in count buffers the size of one array of an x,y,z lattice into the buffer pool at startup, x,y,z:count, may be repeated.")
+        ("serve",boost::program_options::value<std::string>(&serveSocket),"Keep running and solve requests sent to this Unix domain socket, see SolverServer.hpp for the requests. The lattice settings on the command line are ignored.")
+        ("serve-workers",boost::program_options::value<int>(&serveWorkers)->default_value(1),"Number of requests solved at once by --serve, sharing --threads between them.")
         ("help,h","Display help message.");
 
 
@@ -95,12 +250,30 @@ int main(int argc, char const *argv[])
     // If the user asks for help display it then exit.
     if(vm.count("help"))
     {
-        std::cout << desc << "\n";
+        if(isRoot)
+        {
+            std::cout << desc << "\n";
+        }
+#ifdef POISSON_MPI
+        MPI_Finalize();
+#endif
         return 1;
     }
 
     // If the user asks for specific algorithm use it.
-    if(vm.count("SOR"))
+    if(vm.count("Red-Black-SOR"))
+    {
+        solutionMethod = PoissonInputParameters::RedBlackSOR;
+    }
+    else if(vm.count("Line-SOR"))
+    {
+        solutionMethod = PoissonInputParameters::LineSOR;
+    }
+    else if(vm.count("SSOR"))
+    {
+        solutionMethod = PoissonInputParameters::SSOR;
+    }
+    else if(vm.count("SOR"))
     {
         solutionMethod = PoissonInputParameters::SOR;
     }
@@ -108,11 +281,110 @@ int main(int argc, char const *argv[])
     {
         solutionMethod = PoissonInputParameters::GaussSeidel;
     }
+    else if(vm.count("Chebyshev"))
+    {
+        solutionMethod = PoissonInputParameters::ChebyshevJacobi;
+    }
     else
     {
         solutionMethod = PoissonInputParameters::Jacobi;
     }
 
+#ifdef POISSON_MPI
+    // The default output name is a time stamp which can differ between ranks, so everyone uses the root's.
+    {
+        int nameLength = static_cast<int>(outputName.size());
+        MPI_Bcast(&nameLength, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        outputName.resize(nameLength);
+        MPI_Bcast(&outputName[0], nameLength, MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+
+    // Every rank needs at least one plane of the lattice and only the parallel methods can be distributed.
+    if(dimension != 3 || zRange - 2 < size || (solutionMethod != PoissonInputParameters::Jacobi && solutionMethod != PoissonInputParameters::ChebyshevJacobi
+                                                   && solutionMethod != PoissonInputParameters::RedBlackSOR && solutionMethod != PoissonInputParameters::LineSOR) || amrLevels > 0
+       || !selectionSpecifications.empty() || vm.count("full-output") || vm.count("stream-output") || vm.count("vtk") || vm.count("xdmf")
+       || vm.count("serve"))
+    {
+        if(isRoot)
+        {
+            std::cerr << "MPI runs need a 3D domain, --Jacobi, --Chebyshev, --Red-Black-SOR or --Line-SOR, a z-range of at least the number of ranks plus two, no mesh refinement, no output selections, no VTK or XDMF output, no --full-output or --stream-output and no --serve. They write the potential to poissonPotential.bin, or poissonPotential.pcz with --compress.\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+#endif
+
+    // The patches of a refined mesh only take the charge density and a uniform permittivity and spacing from the
+    // lattice below, so they would solve straight through conductors, dielectrics and a non-uniform spacing.
+    if(amrLevels > 0 && (!conductorSpecifications.empty() || !dielectricSpecifications.empty() || !spacingSpecifications.empty()))
+    {
+        std::cerr << "Mesh refinement can't be combined with --conductor, --dielectric or --spacing.\n";
+#ifdef POISSON_MPI
+        MPI_Finalize();
+#endif
+        return 1;
+    }
+
+    // Lower dimensional domains are lattices with a single site along the unused axes.
+    if(dimension < 3)
+    {
+        zRange = 1;
+    }
+    if(dimension < 2)
+    {
+        yRange = 1;
+    }
+
+    // Later specifications override earlier ones for the faces they share.
+    BoundaryConditions boundaryConditions;
+    for(const std::string &specification : boundarySpecifications)
+    {
+        boundaryConditions.set(specification);
+    }
+    boundaryConditions.validate();
+
+    RegionGeometry conductors;
+    for(const std::string &specification : conductorSpecifications)
+    {
+        conductors.add(specification, xRange, yRange, zRange);
+    }
+
+    GridSpacing spacing(xRange, yRange, zRange, spaceStep);
+    for(const std::string &specification : spacingSpecifications)
+    {
+        spacing.set(specification);
+    }
+
+    DerivedQuantities::Config derivedConfig = {vm.count("energy") > 0, vm.count("capacitance") > 0, {}};
+    for(const std::string &specification : fluxSpecifications)
+    {
+        derivedConfig.fluxBoxes.push_back(DerivedQuantities::parseBox(specification));
+    }
+
+    OutputSelection selection(xRange, yRange, zRange);
+    for(const std::string &specification : selectionSpecifications)
+    {
+        selection.add(specification);
+    }
+
+    bool compressed = "none" != compression;
+    LatticeCompression::Mode compressionMode = compressed ? LatticeCompression::modeFromString(compression) : LatticeCompression::Lossless;
+    if(0 == compressionTolerance)
+    {
+        compressionTolerance = precision;
+    }
+
+#ifndef POISSON_MPI
+    // Selecting parts of the lattice or writing it in another format replaces the full output unless it is asked for as well.
+    bool fullOutput = (selection.empty() && !compressed && !vm.count("vtk") && !vm.count("xdmf")) || vm.count("full-output");
+#endif
+
+    RegionGeometry dielectrics;
+    for(const std::string &specification : dielectricSpecifications)
+    {
+        dielectrics.add(specification, xRange, yRange, zRange);
+    }
+
     // Construct an input parameter object, this just makes printing a lot cleaner.
     PoissonInputParameters inputParameters
     {
@@ -122,173 +394,296 @@ int main(int argc, char const *argv[])
         initialValue,
         noise,
         precision,
+        maxIterations,
+        dimension,
         xRange,
         yRange,
         zRange,
         outputName,
-        sorParameter
+        sorParameter,
+        spectralRadius,
+        threads,
+        memoryPlacement,
+        hugePages,
+        latticePadding,
+        threadAffinity,
+        boundaryConditions,
+        conductorSpecifications,
+        dielectricSpecifications,
+        spacing,
+        amrLevels,
+        amrBlockSize,
+        amrThreshold,
+        amrBuffer,
+        amrCycles,
+        vm.count("energy") > 0,
+        fluxSpecifications,
+        vm.count("capacitance") > 0,
+        selectionSpecifications,
+        compression,
+        compressionTolerance
     };
 
+    // Pin the worker threads before any lattice is allocated so first touch places pages next to them.
+    pinThreads(threadAffinity, threads);
 
-/*************************************************************************************************************************
-************************************************* Create Output Files ***************************************************
-*************************************************************************************************************************/
-
-    // Create an output directory from either the default time stamp or the user defined string.
-    makeDirectory(outputName);
+    // Sizes with specialised kernels use them unless the user asks otherwise, e.g. to compare the two.
+    setFixedSizeKernelsEnabled(!vm.count("no-fixed-size-kernels"));
 
-    // Create output file for the input parameters.
-    std::fstream inputParameterOutput(outputName+"/input.txt", std::ios::out);
+    // Every lattice allocated from here on uses the requested placement.
+    LatticeMemory::Policy memoryPolicy = {LatticeMemory::placementFromString(memoryPlacement), numaNode,
+                                          LatticeMemory::hugePagesFromString(hugePages)};
+    LatticeMemory::setDefaultPolicy(memoryPolicy);
 
-    // Create single output file for lattice so we can print the potential and anything else at the same time
-    // which is quicker than iterating through 3D lattice multiple times.
-    std::fstream poissonOutput(outputName+"/poissonOutput.dat", std::ios::out);
+    // Every lattice constructed from here on is laid out with the requested padding.
+    if("none" != latticePadding)
+    {
+        PoissonLattice::Padding padding = {true, 0, 0};
+        if(2 != std::sscanf(latticePadding.c_str(), "%d,%d", &padding.x, &padding.y) || padding.x < 0 || padding.y < 0)
+        {
+            std::cerr << "Lattice padding needs to be none or the form x,y: " << latticePadding << '\n';
+#ifdef POISSON_MPI
+            MPI_Finalize();
+#endif
+            return 1;
+        }
+        PoissonLattice::setDefaultPadding(padding);
+    }
 
-    // Output file to hold any statistical results e.g. number of iterations until convergence.
-    std::fstream outputResults(outputName+"/results.txt", std::ios::out);
+    // Buffers are recycled from here on, with any expected sizes mapped up front.
+    LatticeMemory::setPoolLimit(static_cast<std::size_t>(bufferPool*1024*1024));
+    for(const std::string &specification : poolPrewarmSpecifications)
+    {
+        int x, y, z, count = 1;
+        if(std::sscanf(specification.c_str(), "%d,%d,%d:%d", &x, &y, &z, &count) < 3)
+        {
+            std::cerr << "Pool pre-warming needs the form x,y,z:count: " << specification << '\n';
+#ifdef POISSON_MPI
+            MPI_Finalize();
+#endif
+            return 1;
+        }
+        LatticeMemory::prewarmPool(PoissonLattice::paddedSize(x, y, z)*sizeof(double), count, memoryPolicy);
+    }
 
-    // Print input parameters to command line.
-    std::cout << inputParameters << '\n';
+#ifndef POISSON_MPI
+    // A server takes its lattices from the requests and writes no output directory of its own.
+    if(vm.count("serve"))
+    {
+        SolverServer::Config serverConfig = {serveSocket, serveWorkers, threads};
+        SolverServer server(serverConfig);
+        std::cout << "Serving on " << serveSocket << " with " << serveWorkers << " workers." << std::endl;
+        server.run();
 
-    // Print input parameters to file.
-    inputParameterOutput << inputParameters << '\n';
+        if(LatticeMemory::poolStatistics().enabled)
+        {
+            std::cout << LatticeMemory::poolStatistics();
+        }
+        return 0;
+    }
+#endif
 
 /*************************************************************************************************************************
-************************************************* The Simulation ********************************************************
+************************************************* Create Output Files ***************************************************
 *************************************************************************************************************************/
 
-// There will be three possible algorithm choices and the structure of the simulation will depend on which is used so here
-// the program takes three possible branches.
-
-// Create a lattice to hold the current state of the potential.
-    PoissonLattice currentLattice(xRange, yRange, zRange, permittivity, spaceStep);
+    // Create output file for the input parameters.
+    std::fstream inputParameterOutput;
 
-// Initialise the lattice with some value and random noise.
-    currentLattice.initialise(initialValue, noise, generator);
+    // Output file to hold any statistical results e.g. number of iterations until convergence.
+    std::fstream outputResults;
 
-// Initialise the charge density.
-// By default boundary will be zero so no need to expicily set boundary conditions.
-    currentLattice.setPointChargeDist();
+    if(isRoot)
+    {
+        // Create an output directory from either the default time stamp or the user defined string.
+        makeDirectory(outputName);
 
+        inputParameterOutput.open(outputName+"/input.txt", std::ios::out);
+        outputResults.open(outputName+"/results.txt", std::ios::out);
 
+        // Print input parameters to command line.
+        std::cout << inputParameters << '\n';
 
-// Create a lattice to hold the updated state of the lattice.
-    PoissonLattice  updatedLattice = currentLattice;
+        // Print input parameters to file.
+        inputParameterOutput << inputParameters << '\n';
+    }
 
-// Create a counter to calculate the number of iterations required for convergence.
-    int counter = 0;
+#ifdef POISSON_MPI
+    // Nobody can write into the output directory until the root has created it.
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
 
-// Create a variable to hold how ``converged'' the lattice is relative to the user defined precision.
-    double convergence;
+/*************************************************************************************************************************
+************************************************* The Simulation ********************************************************
+*************************************************************************************************************************/
 
-switch(solutionMethod)
-{
-    // The case the user specifies to use the Jacobi update rule.
-    case PoissonInputParameters::Jacobi:
+// The solver does the iterating, all that is left here is creating the lattice and reporting progress.
+    PoissonSolver::Config solverConfig;
+    solverConfig.solutionMethod = solutionMethod;
+    solverConfig.sorParameter = sorParameter;
+    solverConfig.spectralRadius = spectralRadius;
+    solverConfig.precision = precision;
+    solverConfig.threads = threads;
+    solverConfig.maxIterations = maxIterations;
+    solverConfig.progressInterval = 1000;
+    solverConfig.progress = [isRoot](int iterations, double convergence)
+    {
+        if(isRoot)
         {
-            while(true)
-            {
-                // Count the number of times we have to do an update before convergence.
-                ++counter;
-                // Update the lattice based on its current state.
-                convergence = jacobiUpdate(currentLattice, updatedLattice);
-
-                // Swap the lattices so the current lattice becomes the updated one and the updated one the one will update into.
-                std::swap(currentLattice, updatedLattice);
+            std::cout << iterations << ' ' << convergence << '\n';
+        }
+    };
 
-                if(0==counter%1000)
-                {
-                    std::cout << counter << ' ' << convergence << '\n';
-                }
+    PoissonSolver solver(solverConfig);
 
-                // Check to see if the lattice has converged and if it has stop updating the lattice.
-                if(convergence < precision)
-                {
-                    break;
-                }
+#ifdef POISSON_MPI
+// Each rank only creates its own slab of the lattice, the global lattice is never held in one place.
+    MpiLattice currentLattice(xRange, yRange, zRange, permittivity, spaceStep, MPI_COMM_WORLD);
+#else
+// Create a lattice to hold the current state of the potential.
+    PoissonLattice currentLattice(xRange, yRange, zRange, permittivity, spaceStep);
+#endif
 
+// Initialise the lattice with some value and random noise.
+    currentLattice.initialise(initialValue, noise, generator);
 
-            }
+// The halo is filled from the boundary conditions, by default the boundary is held at zero.
+    currentLattice.setBoundaryConditions(boundaryConditions);
 
-        }
+// Hold the sites inside conductors at their potential.
+    currentLattice.setConductors(conductors);
 
-        break;
+// Give the dielectrics their permittivity.
+    currentLattice.setPermittivity(dielectrics);
 
-    // The case the user specifies to use the Gauss Seidel algorithm.
-    case PoissonInputParameters::GaussSeidel:
-            {
-                while(true)
-                {
-                    // Count the number of times we have to do an update before convergence.
-                    ++counter;
+// Place the sites along each axis.
+    currentLattice.setSpacing(spacing);
 
-                    // Update the lattice based on the GaussSeidal algorithm
-                    convergence = gaussSeidelUpdate(currentLattice);
+// Initialise the charge density.
+    currentLattice.setPointChargeDist();
 
-                    if(0==counter%1000)
-                    {
-                        std::cout << counter << ' ' << convergence << '\n';
-                    }
+// Solve the lattice in place.
+#ifdef POISSON_MPI
+    PoissonSolver::Result result = solver.solve(currentLattice);
+#else
+// With mesh refinement the lattice holds the coarsest level of the composite solution.
+    AmrHierarchy::Config amrConfig = {amrLevels, amrBlockSize, amrThreshold, amrBuffer, amrCycles};
+    AmrHierarchy amr(currentLattice, amrConfig);
+    PoissonSolver::Result result = amrLevels > 0 ? amr.solve(solver) : solver.solve(currentLattice);
+#endif
 
-                    // Check to see if the lattice has converged and if it has stop updating the lattice.
-                    if(convergence < precision)
-                    {
-                        break;
-                    }
+/*************************************************************************************************************************
+***********************************************  Output/Clean Up ********************************************************
+*************************************************************************************************************************/
 
-                }
-            }
+#ifdef POISSON_MPI
+    // Every rank writes its own planes of the potential into a single binary or compressed file.
+    if(compressed)
+    {
+        currentLattice.writeCompressed(outputName+"/poissonPotential.pcz", compressionMode, compressionTolerance);
+    }
+    else
+    {
+        currentLattice.writePotential(outputName+"/poissonPotential.bin");
+    }
+#else
+    // Work the field out in one parallel pass so writing the file only has to format it.
+    ElectricField field(currentLattice);
 
-            break;
+    // Save the potential and field to a single file, which every thread writes its own planes of.
+    if(fullOutput && vm.count("stream-output"))
+    {
+        std::ofstream poissonOutput(outputName+"/poissonOutput.dat");
+        streamLattice(poissonOutput, currentLattice, field, {{0, 0, 0}},
+                      {{currentLattice.xRange()-1, currentLattice.yRange()-1, currentLattice.zRange()-1}});
+    }
+    else if(fullOutput)
+    {
+        ChunkedWriter poissonOutput(outputName+"/poissonOutput.dat");
+        poissonOutput.writeLattice(currentLattice, field);
+    }
 
-    // The case the user specifies to use the successive over-relaxation algorithm.
-    case PoissonInputParameters::SOR:
-            {
-                while(true)
-                {
-                    // Count the number of times we have to do an update before convergence.
-                    ++counter;
+    // Save the selected parts of the lattice.
+    selection.write(outputName, currentLattice, field);
 
-                    // Update the lattice based on the GaussSeidal algorithm
-                    convergence = sorUpdate(sorParameter, currentLattice);
+    if(compressed)
+    {
+        LatticeCompression::write(outputName+"/poissonPotential.pcz", currentLattice, compressionMode, compressionTolerance);
+    }
 
-                    if(0==counter%1000)
-                    {
-                        std::cout << counter << ' ' << convergence << '\n';
-                    }
+    // Files for visualisation tools.
+    if(vm.count("vtk"))
+    {
+        VisualisationOutput::writeVtk(outputName + (VisualisationOutput::uniform(currentLattice) ? "/poissonOutput.vti" : "/poissonOutput.vtr"),
+                                      currentLattice, field);
+    }
+    if(vm.count("xdmf"))
+    {
+        VisualisationOutput::writeXdmf(outputName+"/poissonOutput", currentLattice, field);
+    }
 
-                    // Check to see if the lattice has converged and if it has stop updating the lattice.
-                    if(convergence < precision)
-                    {
-                        break;
-                    }
+    // Each refined patch goes into its own file alongside.
+    if(amrLevels > 0)
+    {
+        amr.write(outputName);
+    }
+#endif
 
-                }
-            }
+    // Integrals of the solution are reduced in place rather than from the output file.
+    DerivedQuantities derivedQuantities(derivedConfig, conductors);
+#ifdef POISSON_MPI
+    DerivedQuantities::Result derived = currentLattice.derivedQuantities(derivedQuantities);
+#else
+    DerivedQuantities::Result derived = derivedQuantities.compute(currentLattice);
+#endif
 
-            break;
+    // Report how many iterations the program took and how long the program took to execute in time and save that data to file.
+    double runTime = timer.elapsed();
 
-    // Default statement to stop compiler throwing warning-doesn't actually do anything.
-    default:
-        break;
+    if(isRoot)
+    {
+        // A run that hit --max-iterations says so rather than reporting its sweeps as the ones it took to converge.
+        if(result.converged)
+        {
+            std::cout << std::setw(30) << std::setfill(' ') << std::left << "Number-of-iterations-until-convergence: " << std::right << result.iterations << std::endl;
+            outputResults << std::setw(30) << std::setfill(' ') << std::left << "Number-of-iterations-until-convergence: " << std::right << result.iterations << std::endl;
+        }
+        else
+        {
+            std::cerr << "Did not converge within " << result.iterations << " iterations, the final convergence measure was " << result.convergence << ".\n";
 
-}
+            std::cout << std::setw(30) << std::setfill(' ') << std::left << "Did-not-converge-after-iterations: " << std::right << result.iterations << std::endl;
+            std::cout << std::setw(30) << std::setfill(' ') << std::left << "Final-convergence-measure: " << std::right << result.convergence << std::endl;
+            outputResults << std::setw(30) << std::setfill(' ') << std::left << "Did-not-converge-after-iterations: " << std::right << result.iterations << std::endl;
+            outputResults << std::setw(30) << std::setfill(' ') << std::left << "Final-convergence-measure: " << std::right << result.convergence << std::endl;
+        }
 
-/*************************************************************************************************************************
-***********************************************  Output/Clean Up ********************************************************
-*************************************************************************************************************************/
+        std::cout << std::setw(30) << std::setfill(' ') << std::left << "Time-take-to-execute(s): " << std::right << runTime << std::endl << std::endl;
+        outputResults << std::setw(30) << std::setfill(' ') << std::left << "Time-take-to-execute(s): " << std::right << runTime << std::endl << std::endl;
 
-    // Save the potential and field to a file.
-    poissonOutput << currentLattice;
+        derivedQuantities.print(std::cout, derived);
+        derivedQuantities.print(outputResults, derived);
 
-    // Report how many iterations the program took and how long the program took to execute in time and save that data to file.
-    double runTime = timer.elapsed();
-    std::cout << std::setw(30) << std::setfill(' ') << std::left << "Number-of-iterations-until-convergence: " << std::right << counter << std::endl;
-    std::cout << std::setw(30) << std::setfill(' ') << std::left << "Time-take-to-execute(s): " << std::right << runTime << std::endl << std::endl;
+        // Let the user know if the explicit huge pages they asked for weren't available.
+        if(LatticeMemory::explicitHugePageFallbacks() > 0)
+        {
+            std::cout << std::setw(30) << std::setfill(' ') << std::left << "Huge-page-fallbacks: " << std::right << LatticeMemory::explicitHugePageFallbacks() << std::endl;
+            outputResults << std::setw(30) << std::setfill(' ') << std::left << "Huge-page-fallbacks: " << std::right << LatticeMemory::explicitHugePageFallbacks() << std::endl;
+        }
 
-    outputResults << std::setw(30) << std::setfill(' ') << std::left << "Number-of-iterations-until-convergence: " << std::right << counter << std::endl;
-    outputResults << std::setw(30) << std::setfill(' ') << std::left << "Time-take-to-execute(s): " << std::right << runTime << std::endl << std::endl;
+        // How much the buffer pool held, to size its limit and pre-warming with.
+        LatticeMemory::PoolStatistics poolStatistics = LatticeMemory::poolStatistics();
+        if(poolStatistics.enabled)
+        {
+            std::cout << poolStatistics;
+            outputResults << poolStatistics;
+        }
+    }
 
+#ifdef POISSON_MPI
+    MPI_Finalize();
+#endif
 
-    return 0;
+    // The output is still written so a capped run can be inspected, but scripts can tell it apart.
+    return result.converged ? 0 : 1;
 }
@@ -0,0 +1,71 @@
+#include "pinThreads.hpp"
+#include <stdexcept>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <numa.h>
+
+void pinThreads(const std::string &affinity, int threads)
+{
+	if("none" == affinity)
+	{
+		return;
+	}
+
+	if("compact" != affinity && "scatter" != affinity)
+	{
+		throw std::invalid_argument("Unknown thread affinity: " + affinity);
+	}
+
+	// Only use the CPUs the process is allowed to run on.
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+
+	// Group the CPUs by NUMA node, everything is on one node if the machine isn't NUMA.
+	int nodes = numa_available() >= 0 ? numa_max_node() + 1 : 1;
+	std::vector<std::vector<int> > nodeCpus(nodes);
+	for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+	{
+		if(CPU_ISSET(cpu, &allowed))
+		{
+			int node = nodes > 1 ? numa_node_of_cpu(cpu) : 0;
+			nodeCpus[node < 0 ? 0 : node].push_back(cpu);
+		}
+	}
+
+	// Order the CPUs in the order threads should take them.
+	std::vector<int> cpus;
+	if("compact" == affinity)
+	{
+		for(int node = 0; node < nodes; ++node)
+		{
+			cpus.insert(cpus.end(), nodeCpus[node].begin(), nodeCpus[node].end());
+		}
+	}
+	else
+	{
+		for(std::size_t index = 0; cpus.size() < static_cast<std::size_t>(CPU_COUNT(&allowed)); ++index)
+		{
+			for(int node = 0; node < nodes; ++node)
+			{
+				if(index < nodeCpus[node].size())
+				{
+					cpus.push_back(nodeCpus[node][index]);
+				}
+			}
+		}
+	}
+
+	#pragma omp parallel num_threads(threads)
+	{
+		#pragma omp for schedule(static)
+		for(int thread = 0; thread < threads; ++thread)
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpus[thread % cpus.size()], &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#ifndef pinThreads_hpp
+#define pinThreads_hpp
+
+#include <string>
+
+/**
+ *\file
+ *\brief function to pin the OpenMP worker threads to CPUs.
+ *\param affinity one of none, compact (fill the CPUs of one NUMA node before moving to the next) or scatter
+ * (spread consecutive threads round robin over the NUMA nodes), throws std::invalid_argument otherwise.
+ *\param threads number of threads in the parallel regions that should be pinned.
+ *
+ * OpenMP reuses the same worker threads for parallel regions of the same size, so threads pinned here stay
+ * pinned for the sweeps and keep using the memory they first touched.
+ */
+void pinThreads(const std::string &affinity, int threads);
+
+#endif /* pinThreads_hpp */
@@ -0,0 +1,41 @@
+#ifndef poisson_hpp
+#define poisson_hpp
+
+/**
+ *\file
+ *\brief Single header to include when using the solver as a library.
+ *
+ * Create a PoissonLattice, set its charge density and solve it in place with a PoissonSolver:
+ *
+ *     PoissonLattice lattice(64, 64, 64, 1.0, 1.0);
+ *     lattice.setPointChargeDist();
+ *
+ *     PoissonSolver::Config config;
+ *     config.solutionMethod = PoissonInputParameters::RedBlackSOR;
+ *     config.sorParameter = 1.9;
+ *     config.spectralRadius = 0;
+ *     config.precision = 1e-3;
+ *     config.threads = 4;
+ *     config.maxIterations = 0;
+ *     config.progressInterval = 0;
+ *
+ *     PoissonSolver::Result result = PoissonSolver(config).solve(lattice);
+ *     const double *potential = lattice.data();
+ *
+ *     ElectricField field(lattice);
+ *     const double *fieldStrength = field.magnitude();
+ *
+ * Link with libpoisson.a or libpoisson.so, -fopenmp, -lnuma and -lz.
+ */
+
+#include "LatticeAllocator.hpp"
+#include "PoissonLattice.hpp"
+#include "PoissonSolver.hpp"
+#include "ElectricField.hpp"
+#include "DerivedQuantities.hpp"
+#include "LatticeCompression.hpp"
+#include "VisualisationOutput.hpp"
+#include "ChunkedWriter.hpp"
+#include "SolverServer.hpp"
+
+#endif /* poisson_hpp */
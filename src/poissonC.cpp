@@ -0,0 +1,136 @@
+#include "poissonC.h"
+#include <exception>
+#include <string>
+#include "PoissonLattice.hpp"
+#include "PoissonSolver.hpp"
+
+// The handle is the lattice itself, the struct only exists to give C an incomplete type.
+struct poisson_lattice : public PoissonLattice
+{
+	poisson_lattice(int xRange, int yRange, int zRange, double permittivity, double dx) : PoissonLattice(xRange, yRange, zRange, permittivity, dx) {}
+};
+
+namespace
+{
+	/// Message describing the last error on each thread.
+	thread_local std::string lastError;
+
+	/**
+	 *\brief fills in the shape and strides of a lattice, in the order x, y, z.
+	 */
+	void describe(const PoissonLattice &lattice, int64_t shape[3], int64_t strides[3])
+	{
+		if(shape)
+		{
+			shape[0] = lattice.xRange();
+			shape[1] = lattice.yRange();
+			shape[2] = lattice.zRange();
+		}
+
+		if(strides)
+		{
+			strides[0] = sizeof(double);
+			strides[1] = static_cast<int64_t>(sizeof(double)) * lattice.xPitch();
+			strides[2] = static_cast<int64_t>(sizeof(double)) * lattice.planeSize();
+		}
+	}
+}
+
+poisson_lattice* poisson_lattice_create(int xRange, int yRange, int zRange, double permittivity, double dx)
+{
+	// Unused axes have a single site, used ones need at least one interior site.
+	const int ranges[3] = {xRange, yRange, zRange};
+	const int dimension = zRange > 1 ? 3 : (yRange > 1 ? 2 : 1);
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		if(axis < dimension ? ranges[axis] < 3 : ranges[axis] != 1)
+		{
+			lastError = "Lattice needs at least 3 sites along each used axis and 1 along the others";
+			return nullptr;
+		}
+	}
+
+	if(!(dx > 0) || !(permittivity > 0))
+	{
+		lastError = "Lattice needs a positive dx and permittivity";
+		return nullptr;
+	}
+
+	try
+	{
+		return new poisson_lattice(xRange, yRange, zRange, permittivity, dx);
+	}
+	catch(const std::exception &exception)
+	{
+		lastError = exception.what();
+		return nullptr;
+	}
+}
+
+void poisson_lattice_destroy(poisson_lattice *lattice)
+{
+	delete lattice;
+}
+
+double* poisson_lattice_potential(poisson_lattice *lattice, int64_t shape[3], int64_t strides[3])
+{
+	describe(*lattice, shape, strides);
+	return lattice->data();
+}
+
+double* poisson_lattice_charge_density(poisson_lattice *lattice, int64_t shape[3], int64_t strides[3])
+{
+	describe(*lattice, shape, strides);
+	return lattice->chargeDensityData();
+}
+
+void poisson_lattice_set_point_charge(poisson_lattice *lattice)
+{
+	lattice->setPointChargeDist();
+}
+
+int poisson_solve(poisson_lattice *lattice, int method, double sorParameter, double precision, int threads,
+				  int maxIterations, int *iterations, double *convergence)
+{
+	if(method < POISSON_JACOBI || method > POISSON_LINE_SOR)
+	{
+		lastError = "Unknown solution method";
+		return -1;
+	}
+
+	try
+	{
+		PoissonSolver::Config config;
+		config.solutionMethod = static_cast<PoissonInputParameters::SolutionMethod>(method);
+		config.sorParameter = sorParameter;
+		config.spectralRadius = 0;
+		config.precision = precision;
+		config.threads = threads;
+		config.maxIterations = maxIterations;
+		config.progressInterval = 0;
+
+		PoissonSolver::Result result = PoissonSolver(config).solve(*lattice);
+
+		if(iterations)
+		{
+			*iterations = result.iterations;
+		}
+
+		if(convergence)
+		{
+			*convergence = result.convergence;
+		}
+
+		return result.converged ? 0 : 1;
+	}
+	catch(const std::exception &exception)
+	{
+		lastError = exception.what();
+		return -1;
+	}
+}
+
+const char* poisson_last_error(void)
+{
+	return lastError.c_str();
+}
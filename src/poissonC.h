@@ -0,0 +1,105 @@
+#ifndef poissonC_h
+#define poissonC_h
+
+/**
+ *\file
+ *\brief C interface to the solver library, for calling it from C or from other languages through an FFI.
+ *
+ * Lattices are opaque handles. The potential and charge density are exposed as pointers into the lattice
+ * together with their shape and strides, indexed as [i][j][k] with the strides in bytes, so they can be
+ * wrapped as arrays (e.g. by NumPy) without copying. The pointers stay valid until the lattice is destroyed.
+ * No function throws; failures are reported through return values and poisson_last_error.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Opaque handle to a PoissonLattice.
+typedef struct poisson_lattice poisson_lattice;
+
+/// Solution methods, matching PoissonInputParameters::SolutionMethod.
+enum poisson_method
+{
+	POISSON_JACOBI = 0,
+	POISSON_GAUSS_SEIDEL = 1,
+	POISSON_SOR = 2,
+	POISSON_RED_BLACK_SOR = 3,
+	POISSON_CHEBYSHEV_JACOBI = 4,
+	POISSON_SSOR = 5,
+	POISSON_LINE_SOR = 6
+};
+
+/**
+ *\brief creates a lattice with a zero potential and charge density.
+ *
+ * Used axes need at least 3 sites and unused ones exactly 1, so a 2D lattice has a z range of 1 and a 1D
+ * lattice a y range of 1 as well.
+ *
+ *\param xRange range of x values in lattice, including the boundary.
+ *\param yRange range of y values in lattice, including the boundary.
+ *\param zRange range of z values in lattice, including the boundary.
+ *\param permittivity permittivity in Poisson equation.
+ *\param dx spatial discretisation step size, positive like the permittivity.
+ *\return handle to the lattice or NULL on failure, with the reason in poisson_last_error().
+ */
+poisson_lattice* poisson_lattice_create(int xRange, int yRange, int zRange, double permittivity, double dx);
+
+/**
+ *\brief destroys a lattice, invalidating every pointer into it.
+ *\param lattice handle to the lattice, may be NULL.
+ */
+void poisson_lattice_destroy(poisson_lattice *lattice);
+
+/**
+ *\brief gives access to the potential of a lattice.
+ *\param lattice handle to the lattice.
+ *\param shape filled with the number of sites along x, y and z, may be NULL.
+ *\param strides filled with the distance in bytes between neighbouring sites along x, y and z, may be NULL.
+ *\return pointer to the potential at site (0,0,0).
+ */
+double* poisson_lattice_potential(poisson_lattice *lattice, int64_t shape[3], int64_t strides[3]);
+
+/**
+ *\brief gives access to the charge density of a lattice, with the same shape and strides as the potential.
+ *\param lattice handle to the lattice.
+ *\param shape filled with the number of sites along x, y and z, may be NULL.
+ *\param strides filled with the distance in bytes between neighbouring sites along x, y and z, may be NULL.
+ *\return pointer to the charge density at site (0,0,0).
+ */
+double* poisson_lattice_charge_density(poisson_lattice *lattice, int64_t shape[3], int64_t strides[3]);
+
+/**
+ *\brief sets a unit point charge at the centre of the lattice.
+ *\param lattice handle to the lattice.
+ */
+void poisson_lattice_set_point_charge(poisson_lattice *lattice);
+
+/**
+ *\brief solves the Poisson equation on a lattice in place.
+ *\param lattice handle to the lattice.
+ *\param method one of the poisson_method values.
+ *\param sorParameter successive over relaxation parameter for the SOR methods.
+ *\param precision the lattice has converged once the convergence measure of a sweep drops below this.
+ *\param threads number of threads for the Jacobi, Chebyshev, red-black SOR and line SOR methods.
+ *\param maxIterations give up after this many sweeps, zero for no limit.
+ *\param iterations filled with the number of sweeps done, may be NULL.
+ *\param convergence filled with the convergence measure of the final sweep, may be NULL.
+ *\return 0 if converged, 1 if the iteration limit was hit and -1 on error.
+ */
+int poisson_solve(poisson_lattice *lattice, int method, double sorParameter, double precision, int threads,
+				  int maxIterations, int *iterations, double *convergence);
+
+/**
+ *\brief gets a description of the last error on the calling thread.
+ *\return null terminated message, empty if there has been no error.
+ */
+const char* poisson_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* poissonC_h */
@@ -0,0 +1,56 @@
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "LatticeCompression.hpp"
+#include "PoissonLattice.hpp"
+#include "ElectricField.hpp"
+#include "ChunkedWriter.hpp"
+
+/**
+ *\file
+ *\brief Decompresses a poissonPotential.pcz file written with --compress.
+ *
+ * The potential is written either as raw doubles of the whole lattice in memory order, the same layout as
+ * the binary output of the MPI backend, or in the text layout of poissonOutput.dat with the electric field
+ * worked out again from the potential. The field assumes the uniform spacing stored in the file.
+ *
+ *     poisson-reader --binary poissonPotential.pcz poissonPotential.bin
+ *     poisson-reader --text poissonPotential.pcz poissonOutput.dat
+ */
+int main(int argc, char **argv)
+{
+    if(argc != 4 || (0 != std::strcmp(argv[1], "--binary") && 0 != std::strcmp(argv[1], "--text")))
+    {
+        std::cerr << "Usage: " << argv[0] << " --binary|--text input.pcz output\n";
+        return 1;
+    }
+
+    try
+    {
+        LatticeCompression::Header header;
+        std::vector<double> potential = LatticeCompression::read(argv[2], header);
+
+        ChunkedWriter output(argv[3]);
+        if(0 == std::strcmp(argv[1], "--binary"))
+        {
+            output.writeValues(potential.data(), potential.size(), 0);
+        }
+        else
+        {
+            // Rebuild the lattice so the field and the text layout come out exactly as the solver writes them.
+            PoissonLattice lattice(header.ranges[0], header.ranges[1], header.ranges[2], 1.0, header.dx);
+            std::copy(potential.begin(), potential.end(), lattice.data());
+
+            output.writeLattice(lattice, ElectricField(lattice));
+        }
+    }
+    catch(const std::exception &error)
+    {
+        std::cerr << error.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}